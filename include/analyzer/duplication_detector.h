@@ -2,6 +2,7 @@
 #define DUPLICATION_DETECTOR_H
 
 #include "cqanalyzer.h"
+#include "analyzer/source_lexer.h"
 
 /**
  * @file duplication_detector.h
@@ -20,6 +21,26 @@
  */
 CQError detect_file_duplication(const char *filepath, double *duplication_ratio);
 
+/**
+ * @brief Detect code duplication in file contents
+ *
+ * @param text File contents (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param duplication_ratio Output duplication ratio (0.0 to 1.0)
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError detect_duplication_from_buffer(const char *text, size_t length, double *duplication_ratio);
+
+/**
+ * @brief Detect code duplication in a lexed token stream
+ *
+ * @param tokens Tokens from source_lex()
+ * @param token_count Number of tokens
+ * @param duplication_ratio Output duplication ratio (0.0 to 1.0)
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError detect_duplication_from_tokens(const SourceToken *tokens, int token_count, double *duplication_ratio);
+
 /**
  * @brief Detect code duplication across multiple files
  *
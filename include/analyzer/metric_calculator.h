@@ -2,6 +2,7 @@
 #define METRIC_CALCULATOR_H
 
 #include "cqanalyzer.h"
+#include "analyzer/source_lexer.h"
 #include "data/ast_types.h"
 
 /**
@@ -32,6 +33,19 @@ int calculate_cyclomatic_complexity(void *ast_data);
 CQError calculate_lines_of_code(const char *filepath, int *physical_loc,
                                 int *logical_loc, int *comment_loc);
 
+/**
+ * @brief Calculate lines of code metrics from file contents
+ *
+ * @param text File contents (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param physical_loc Physical lines of code
+ * @param logical_loc Logical lines of code
+ * @param comment_loc Comment lines of code
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError calculate_lines_of_code_from_buffer(const char *text, size_t length, int *physical_loc,
+                                            int *logical_loc, int *comment_loc);
+
 /**
  * @brief Halstead complexity metrics
  */
@@ -56,6 +70,61 @@ typedef struct {
  */
 CQError calculate_halstead_metrics(const char *filepath, HalsteadMetrics *metrics);
 
+/**
+ * @brief Calculate Halstead complexity metrics from file contents
+ *
+ * @param text File contents (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param metrics Output Halstead metrics
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError calculate_halstead_metrics_from_buffer(const char *text, size_t length, HalsteadMetrics *metrics);
+
+/**
+ * @brief Calculate Halstead complexity metrics from a lexed token stream
+ *
+ * Operators and control-flow keywords count as operators; identifiers,
+ * numbers and literals as operands.
+ *
+ * @param tokens Tokens from source_lex()
+ * @param token_count Number of tokens
+ * @param metrics Output Halstead metrics
+ */
+void calculate_halstead_metrics_from_tokens(const SourceToken *tokens, int token_count, HalsteadMetrics *metrics);
+
+/**
+ * @brief Text-level metrics of one source file
+ */
+typedef struct {
+    int physical_loc;          // Physical lines of code
+    int logical_loc;           // Logical lines of code
+    int comment_loc;           // Comment lines of code
+    HalsteadMetrics halstead;  // Halstead complexity metrics
+    double duplication_ratio;  // Duplicated token ratio (0.0 to 1.0)
+} TextMetrics;
+
+/**
+ * @brief Calculate all text-level metrics from a single lexer pass
+ *
+ * @param text File contents (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param metrics Output metrics
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError calculate_text_metrics_from_buffer(const char *text, size_t length, TextMetrics *metrics);
+
+/**
+ * @brief Calculate all text-level metrics of a file from a single read
+ *
+ * Maps the file once and computes the lines of code, Halstead and
+ * duplication metrics from one token stream.
+ *
+ * @param filepath Source file path
+ * @param metrics Output metrics
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError calculate_text_metrics(const char *filepath, TextMetrics *metrics);
+
 /**
  * @brief Calculate maintainability index
  *
@@ -0,0 +1,102 @@
+#ifndef SOURCE_LEXER_H
+#define SOURCE_LEXER_H
+
+#include "cqanalyzer.h"
+
+/**
+ * @file source_lexer.h
+ * @brief Single-pass lexer for text-level metrics
+ *
+ * Splits C-like source text into classified tokens and categorizes each
+ * line as blank, comment or code in one pass, so that lines of code,
+ * Halstead and duplication metrics can all be computed from the same
+ * token stream. Comments produce no tokens.
+ */
+
+typedef enum
+{
+    SOURCE_TOKEN_IDENTIFIER,
+    SOURCE_TOKEN_KEYWORD,     // Control-flow keyword (if, while, return, ...)
+    SOURCE_TOKEN_NUMBER,
+    SOURCE_TOKEN_STRING,      // String or character literal
+    SOURCE_TOKEN_OPERATOR,
+    SOURCE_TOKEN_PUNCTUATION  // ; , ( ) { } [ ] # and unknown characters
+} SourceTokenKind;
+
+/**
+ * @brief Token of the stream; the text itself is represented by its hash
+ */
+typedef struct
+{
+    unsigned long hash;
+    SourceTokenKind kind;
+} SourceToken;
+
+/**
+ * @brief Tokens and line categories of a source text
+ */
+typedef struct
+{
+    SourceToken *tokens;  // NULL unless tokens were requested
+    int token_count;
+    int token_capacity;
+    int physical_lines;
+    int code_lines;       // Lines with at least one token
+    int comment_lines;    // Lines with comment text but no token
+    int blank_lines;
+} SourceLexResult;
+
+/**
+ * @brief Line categories of a source text
+ */
+typedef struct
+{
+    int physical_lines;
+    int code_lines;       // Lines with at least one token
+    int comment_lines;    // Lines with comment text but no token
+    int blank_lines;
+} SourceLineCounts;
+
+/**
+ * @brief Lex a source text
+ *
+ * @param text Source text (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param collect_tokens Whether to store the tokens, or only count lines
+ * @param result Output result, to free with source_lex_result_free()
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError source_lex(const char *text, size_t length, bool collect_tokens, SourceLexResult *result);
+
+/**
+ * @brief Free the tokens of a lex result
+ *
+ * @param result Result filled by source_lex()
+ */
+void source_lex_result_free(SourceLexResult *result);
+
+/**
+ * @brief Categorize the lines of a source text without lexing tokens
+ *
+ * Gives the same counts as source_lex(). Scans 32-byte chunks with SSE2 or
+ * AVX2 when the build targets them: chunks without comment or literal
+ * delimiters are classified from byte masks, others with the scalar path.
+ *
+ * @param text Source text (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param counts Output line counts
+ * @return CQ_SUCCESS on success, CQ_ERROR_INVALID_ARGUMENT on bad arguments
+ */
+CQError source_count_lines(const char *text, size_t length, SourceLineCounts *counts);
+
+/**
+ * @brief Scalar reference implementation of source_count_lines()
+ *
+ * @param text Source text (need not be NUL-terminated)
+ * @param length Length of text in bytes
+ * @param counts Output line counts
+ * @return CQ_SUCCESS on success, CQ_ERROR_INVALID_ARGUMENT on bad arguments
+ */
+CQError source_count_lines_scalar(const char *text, size_t length, SourceLineCounts *counts);
+
+#endif // SOURCE_LEXER_H
@@ -0,0 +1,134 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include "cqanalyzer.h"
+#include "data/ast_types.h"
+
+/**
+ * @file analysis_cache.h
+ * @brief Persistent per-file cache of extracted AST records
+ *
+ * Stores the FileInfo, FunctionInfo, ClassInfo, VariableInfo and CallEdge
+ * records (including their metrics) extracted from each source file, keyed by
+ * path, modification time, size and content hash. Unchanged files can be
+ * restored from the cache instead of being parsed again.
+ *
+ * Keys are made by the parse workers from the contents they parse, so the
+ * cache never reads source files itself. Files the records also came from,
+ * such as included headers, are stored with each entry and only checked
+ * with stat(), once per loaded cache.
+ */
+
+typedef struct AnalysisCache AnalysisCache;
+
+/**
+ * @brief Identity of a file's contents at analysis time
+ */
+typedef struct
+{
+    int64_t mtime_ns;       // Modification time (nanoseconds since the epoch)
+    int64_t size;           // Size in bytes
+    uint64_t content_hash;  // Hash of the file contents (valid if has_hash)
+    bool has_hash;          // Whether content_hash has been computed
+} AnalysisCacheKey;
+
+/**
+ * @brief Another file a cached file's records were extracted from, such as an included header
+ */
+typedef struct
+{
+    const char *path;
+    int64_t mtime_ns;       // Modification time when the file was parsed
+    int64_t size;           // Size in bytes when the file was parsed
+} AnalysisCacheDependency;
+
+/**
+ * @brief Load a cache file, or create an empty cache if it is missing or stale
+ *
+ * @param cache_path Path of the cache file
+ * @param variant Parser settings the records depend on (e.g. the analysis
+ *                profile); a cache written with another variant is discarded
+ * @return New cache, or NULL on allocation failure
+ */
+AnalysisCache *analysis_cache_load(const char *cache_path, uint32_t variant);
+
+/**
+ * @brief Save the cache, keeping only entries stored or retained this run
+ *
+ * @param cache Cache
+ * @param cache_path Path of the cache file
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError analysis_cache_save(AnalysisCache *cache, const char *cache_path);
+
+/**
+ * @brief Destroy a cache
+ *
+ * @param cache Cache to destroy
+ */
+void analysis_cache_destroy(AnalysisCache *cache);
+
+/**
+ * @brief Start the key of file contents read at a known modification time
+ *
+ * @param key Output key (content hash is not computed)
+ * @param mtime_ns Modification time reported by the fstat() the contents were read after
+ * @param length Length of the contents in bytes
+ */
+void analysis_cache_key_init(AnalysisCacheKey *key, int64_t mtime_ns, size_t length);
+
+/**
+ * @brief Compute the content hash of a key, if it does not have one yet
+ *
+ * @param key Key from analysis_cache_key_init()
+ * @param contents The contents the key was made for (key->size bytes)
+ */
+void analysis_cache_key_hash(AnalysisCacheKey *key, const char *contents);
+
+/**
+ * @brief Look up a file and restore its records if it is unchanged
+ *
+ * A matching modification time and size is a hit. Otherwise the content
+ * hash is computed from contents (and stored in key) and compared. Either
+ * way, every dependency stored with the entry must still have its recorded
+ * modification time and size. Does not modify the cache entries, so it may
+ * be called concurrently from parse workers.
+ *
+ * @param cache Cache
+ * @param filepath File path
+ * @param key Key from analysis_cache_key_init(); may gain a content hash
+ * @param contents The contents the key was made for (key->size bytes)
+ * @return Newly allocated per-file project on a hit, NULL on a miss
+ */
+Project *analysis_cache_lookup(const AnalysisCache *cache, const char *filepath, AnalysisCacheKey *key,
+                               const char *contents);
+
+/**
+ * @brief Store the records of a freshly parsed file
+ *
+ * @param cache Cache
+ * @param filepath File path
+ * @param key Key of the contents that were parsed, with its content hash
+ * @param project Per-file project produced by the parser
+ * @param dependencies Other files the records came from, as they were parsed (may be NULL if count is 0)
+ * @param dependency_count Number of dependencies
+ * @return CQ_SUCCESS on success, CQ_ERROR_INVALID_ARGUMENT if the key has no hash, error code on failure
+ */
+CQError analysis_cache_store(AnalysisCache *cache, const char *filepath, const AnalysisCacheKey *key,
+                             const Project *project, const AnalysisCacheDependency *dependencies,
+                             uint32_t dependency_count);
+
+/**
+ * @brief Keep an existing entry for a file that was restored from the cache
+ *
+ * The entry's modification time and size are refreshed from key so that a
+ * touched but unchanged file is matched without hashing on the next run.
+ *
+ * @param cache Cache
+ * @param filepath File path
+ * @param key Key used for the lookup, or NULL to keep the stored key
+ * @return CQ_SUCCESS on success, CQ_ERROR_INVALID_ARGUMENT if not cached
+ */
+CQError analysis_cache_retain(AnalysisCache *cache, const char *filepath, const AnalysisCacheKey *key);
+
+#endif // ANALYSIS_CACHE_H
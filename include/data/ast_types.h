@@ -4,6 +4,7 @@
 #include "cqanalyzer.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "utils/memory.h"
 
 // Forward declaration for DependencyGraph to avoid circular dependency
 typedef struct DependencyGraph DependencyGraph;
@@ -18,23 +19,44 @@ typedef struct DependencyGraph DependencyGraph;
 
 // Forward declarations
 typedef struct StringPool StringPool;
+typedef struct StringPoolSync StringPoolSync;
 typedef struct SymbolTable SymbolTable;
 typedef struct FunctionArray FunctionArray;
 typedef struct ClassArray ClassArray;
 typedef struct VariableArray VariableArray;
 typedef struct FileArray FileArray;
+typedef struct CallEdgeArray CallEdgeArray;
+
+/**
+ * @brief Lookup slot of a string pool, keeping the full hash to skip string compares
+ */
+typedef struct
+{
+    uint32_t hash;            // Hash of the string
+    uint32_t id;              // String ID, or UINT32_MAX for an empty slot
+} StringPoolSlot;
 
 /**
  * @brief String interning pool for memory-efficient string storage
+ *
+ * Characters are packed into arena blocks rather than allocated per
+ * string. The lookup table is rehashed to twice its size once it is
+ * three quarters full.
+ *
+ * After string_pool_enable_concurrent(), the lookup table is split into
+ * shards with a lock each, and strings that are already interned are
+ * found without taking a lock. The fields below must then only be read
+ * once no thread is interning.
  */
 struct StringPool
 {
-    char **strings;           // Array of interned strings
-    uint32_t *hashes;         // Hash values for fast lookup
+    const char **strings;     // Interned strings by ID, stored in arena
     uint32_t count;           // Number of strings
     uint32_t capacity;        // Allocated capacity
-    uint32_t *hash_table;     // Hash table for string lookup
-    uint32_t hash_table_size; // Size of hash table
+    StringPoolSlot *slots;    // Open-addressing lookup table
+    uint32_t slot_count;      // Size of the lookup table, a power of two
+    MemoryArena arena;        // Characters of the interned strings
+    StringPoolSync *sync;     // Shards of the concurrent mode, NULL otherwise
 };
 
 /**
@@ -61,6 +83,9 @@ typedef struct
     uint32_t offset;
 } SourceLocation;
 
+// class_id of functions that are not class members
+#define CLASS_ID_NONE UINT32_MAX
+
 /**
  * @brief Function information (optimized structure)
  */
@@ -74,7 +99,7 @@ typedef struct
     uint32_t parameter_count;
     uint32_t return_type_id;  // Interned string ID
     uint32_t usage_count;     // Number of times called
-    uint32_t class_id;        // Parent class ID (if method)
+    uint32_t class_id;        // Parent class ID, or CLASS_ID_NONE for free functions
 } FunctionInfo;
 
 /**
@@ -87,6 +112,33 @@ struct FunctionArray
     uint32_t capacity;
 };
 
+/**
+ * @brief Function metrics stored column-wise by FunctionColumns
+ */
+typedef enum
+{
+    FUNCTION_METRIC_COMPLEXITY,
+    FUNCTION_METRIC_NESTING_DEPTH,
+    FUNCTION_METRIC_LINES_OF_CODE,
+    FUNCTION_METRIC_PARAMETER_COUNT,
+    FUNCTION_METRIC_COUNT
+} FunctionMetric;
+
+/**
+ * @brief Structure-of-arrays view of the metrics of a FunctionArray
+ *
+ * Holds one contiguous array per FunctionMetric, indexed like the
+ * FunctionArray it was built from, so that filters and aggregations over a
+ * metric read only that metric. It is a snapshot: rebuild it after the
+ * functions change.
+ */
+typedef struct
+{
+    uint32_t *columns[FUNCTION_METRIC_COUNT]; // Metric values by function index
+    uint32_t count;           // Functions in the view
+    uint32_t capacity;        // Functions the columns have room for
+} FunctionColumns;
+
 /**
  * @brief Class/struct information (optimized)
  */
@@ -133,6 +185,26 @@ struct VariableArray
     uint32_t capacity;
 };
 
+/**
+ * @brief Call from a function to a named callee
+ */
+typedef struct
+{
+    uint32_t caller_index;    // Index into function array
+    uint32_t callee_name_id;  // Interned name of the called function
+    uint32_t line;            // Line of the call expression
+} CallEdge;
+
+/**
+ * @brief Dynamic array of call edges
+ */
+struct CallEdgeArray
+{
+    CallEdge *calls;
+    uint32_t count;
+    uint32_t capacity;
+};
+
 /**
  * @brief File information (optimized)
  */
@@ -172,6 +244,7 @@ typedef struct
     FunctionArray functions;
     ClassArray classes;
     VariableArray variables;
+    CallEdgeArray calls;      // Call edges extracted from function bodies
     StringPool string_pool;
     SymbolTable symbol_table;
     DependencyGraph *dependency_graph; // Code dependency relationships
@@ -197,6 +270,31 @@ void string_pool_destroy(StringPool *pool);
 uint32_t string_pool_intern(StringPool *pool, const char *str);
 const char *string_pool_get(const StringPool *pool, uint32_t id);
 
+/**
+ * @brief Look up the ID of a string without interning it
+ *
+ * Lock-free in the concurrent mode, where a string being interned at the
+ * same time may not be found yet.
+ *
+ * @param pool String pool
+ * @param str String to look up
+ * @param id Output ID of the string
+ * @return true if the string is interned
+ */
+bool string_pool_find(const StringPool *pool, const char *str, uint32_t *id);
+
+/**
+ * @brief Make a string pool safe to use from several threads
+ *
+ * Afterwards string_pool_intern() and string_pool_get() may be called
+ * concurrently. Existing IDs are kept. Must be called before any other
+ * thread uses the pool.
+ *
+ * @param pool String pool
+ * @return CQ_SUCCESS on success, error code on failure (pool unchanged)
+ */
+CQError string_pool_enable_concurrent(StringPool *pool);
+
 CQError symbol_table_init(SymbolTable *table, uint32_t initial_capacity);
 void symbol_table_destroy(SymbolTable *table);
 CQError symbol_table_add(SymbolTable *table, uint32_t symbol_id, uint32_t file_index);
@@ -207,6 +305,45 @@ void function_array_destroy(FunctionArray *array);
 CQError function_array_add(FunctionArray *array, const FunctionInfo *func);
 FunctionInfo *function_array_get(FunctionArray *array, uint32_t index);
 
+/**
+ * @brief Build or refresh the column view of a function array
+ *
+ * Reuses the columns of a view built before when they are large enough.
+ *
+ * @param columns View to fill; zero-initialize it before the first build
+ * @param array Functions to copy the metrics of
+ * @return CQ_SUCCESS on success, error code on failure (view left empty)
+ */
+CQError function_columns_build(FunctionColumns *columns, const FunctionArray *array);
+
+/**
+ * @brief Free the columns of a view
+ *
+ * @param columns View to free (may be NULL)
+ */
+void function_columns_destroy(FunctionColumns *columns);
+
+/**
+ * @brief Find the functions whose metric exceeds a threshold
+ *
+ * @param columns View to scan
+ * @param metric Metric to compare
+ * @param threshold Values above it are selected
+ * @param indices Output function indices in ascending order, room for columns->count entries
+ * @return Number of functions selected
+ */
+uint32_t function_columns_select_above(const FunctionColumns *columns, FunctionMetric metric, uint32_t threshold,
+                                       uint32_t *indices);
+
+/**
+ * @brief Sum a metric over all functions of a view
+ *
+ * @param columns View to scan
+ * @param metric Metric to sum
+ * @return Sum of the metric
+ */
+uint64_t function_columns_sum(const FunctionColumns *columns, FunctionMetric metric);
+
 CQError class_array_init(ClassArray *array, uint32_t initial_capacity);
 void class_array_destroy(ClassArray *array);
 CQError class_array_add(ClassArray *array, const ClassInfo *cls);
@@ -217,6 +354,11 @@ void variable_array_destroy(VariableArray *array);
 CQError variable_array_add(VariableArray *array, const VariableInfo *var);
 VariableInfo *variable_array_get(VariableArray *array, uint32_t index);
 
+CQError call_edge_array_init(CallEdgeArray *array, uint32_t initial_capacity);
+void call_edge_array_destroy(CallEdgeArray *array);
+CQError call_edge_array_add(CallEdgeArray *array, const CallEdge *call);
+CallEdge *call_edge_array_get(CallEdgeArray *array, uint32_t index);
+
 CQError file_array_init(FileArray *array, uint32_t initial_capacity);
 void file_array_destroy(FileArray *array);
 CQError file_array_add(FileArray *array, const FileInfo *file);
@@ -229,6 +371,59 @@ CQError project_add_function(Project *project, const FunctionInfo *func, uint32_
 CQError project_add_class(Project *project, const ClassInfo *cls, uint32_t *class_id);
 CQError project_add_variable(Project *project, const VariableInfo *var, uint32_t *var_id);
 
+/**
+ * @brief Append all files, functions, classes, variables and calls of src to dest
+ *
+ * Arrays are relocated with bulk copies. String IDs are remapped into the
+ * destination pool, and file, function, class and variable indices are
+ * rebased, so FileInfo ranges and call edges stay valid. Class method index arrays are
+ * moved to dest; src must still be destroyed by the caller.
+ *
+ * @param dest Project receiving the data
+ * @param src Project to merge from
+ * @param first_file_index Optional output: index in dest of src's first file
+ * @return CQ_SUCCESS on success, error code on failure (dest unchanged)
+ */
+CQError project_merge(Project *dest, Project *src, uint32_t *first_file_index);
+
+/**
+ * @brief Intern the strings of src in dest's pool ahead of a merge
+ *
+ * With a concurrent destination pool, this can run outside the lock that
+ * serializes merges, leaving only the array copies to project_merge_mapped().
+ *
+ * @param dest Project the strings are interned in
+ * @param src Project whose strings are interned
+ * @param string_map Output: dest ID of each src string ID, to free()
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError project_intern_strings(Project *dest, const Project *src, uint32_t **string_map);
+
+/**
+ * @brief project_merge() with string IDs from project_intern_strings()
+ *
+ * @param dest Project receiving the data
+ * @param src Project to merge from
+ * @param string_map Map from project_intern_strings(dest, src)
+ * @param first_file_index Optional output: index in dest of src's first file
+ * @return CQ_SUCCESS on success, error code on failure (dest unchanged)
+ */
+CQError project_merge_mapped(Project *dest, Project *src, const uint32_t *string_map, uint32_t *first_file_index);
+
+/**
+ * @brief Order files by path, moving each file's records along with it
+ *
+ * Functions, classes, variables and calls are regrouped in the new file
+ * order (keeping their order within a file), and every file, function and
+ * class index is remapped. Used to make a project built from results that
+ * arrived in any order deterministic. Must be called before the dependency
+ * graph is built.
+ *
+ * @param project Project to reorder
+ * @return CQ_SUCCESS on success, error code on failure (project unchanged)
+ */
+CQError project_sort_files(Project *project);
+
 // Data validation and integrity functions
 bool ast_data_validate(const ASTData *data);
 bool project_validate(const Project *project);
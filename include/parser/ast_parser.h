@@ -2,6 +2,10 @@
 #define AST_PARSER_H
 
 #include "cqanalyzer.h"
+#include "parser/compile_database.h"
+#include "parser/pch_cache.h"
+#include "parser/preprocessor.h"
+#include "utils/config.h"
 
 /**
  * @file ast_parser.h
@@ -31,6 +35,115 @@ void ast_parser_shutdown(void);
  */
 void *parse_source_file(const char *filepath);
 
+/**
+ * @brief Create a libclang index owned by the caller
+ *
+ * Each parse worker thread needs its own index; libclang indexes must
+ * not be shared between threads that parse concurrently.
+ *
+ * @return New CXIndex handle, or NULL on error
+ */
+void *ast_parser_create_index(void);
+
+/**
+ * @brief Dispose an index created with ast_parser_create_index()
+ *
+ * @param index Index to dispose
+ */
+void ast_parser_dispose_index(void *index);
+
+/**
+ * @brief Use shared precompiled preambles for subsequent parses
+ *
+ * Must not be changed while parse workers are running.
+ *
+ * @param cache PCH cache, or NULL to parse every file from source
+ */
+void ast_parser_set_pch_cache(PchCache *cache);
+
+/**
+ * @brief Intern the macros of subsequent parses in one table
+ *
+ * Without a table, each parse interns its macros in a private one. Must
+ * not be changed while parse workers are running.
+ *
+ * @param table Macro table, or NULL
+ */
+void ast_parser_set_macro_table(MacroTable *table);
+
+/**
+ * @brief Parse files with the arguments they are built with
+ *
+ * Files found in the database are parsed with their compile command
+ * instead of the include directories and macros guessed from the source.
+ * Must not be changed while parse workers are running.
+ *
+ * @param database Compilation database, or NULL to guess the arguments of every file
+ */
+void ast_parser_set_compile_database(const CompileDatabase *database);
+
+/**
+ * @brief Select how much of each translation unit subsequent parses process
+ *
+ * ANALYSIS_PROFILE_DECLARATIONS parses with SkipFunctionBodies and
+ * Incomplete and skips the body walk: function complexity and nesting depth
+ * are left at 0, and no call edges or symbol usage counts are recorded.
+ * Must not be changed while parse workers are running.
+ *
+ * @param profile Resolved profile (ANALYSIS_PROFILE_AUTO behaves as FULL)
+ */
+void ast_parser_set_profile(AnalysisProfile profile);
+
+/**
+ * @brief Parse source file using a caller-provided libclang index
+ *
+ * @param filepath Path to source file
+ * @param index CXIndex created with ast_parser_create_index()
+ * @return Pointer to parsed AST data, or NULL on error
+ */
+void *parse_source_file_with_index(const char *filepath, void *index);
+
+/**
+ * @brief Parse source file contents already in memory using a caller-provided index
+ *
+ * libclang reads the main file from contents instead of the disk; included
+ * headers are still read from the disk.
+ *
+ * @param filepath Path to source file
+ * @param contents Contents of the file, or NULL to read it from the disk
+ * @param length Length of contents in bytes
+ * @param index CXIndex created with ast_parser_create_index()
+ * @return Pointer to parsed AST data, or NULL on error
+ */
+void *parse_source_buffer_with_index(const char *filepath, const char *contents, size_t length, void *index);
+
+/**
+ * @brief Callback receiving the path of a file included by a translation unit
+ */
+typedef void (*IncludedFileCallback)(const char *path, void *user_data);
+
+/**
+ * @brief Visit the files a parsed translation unit included, directly or not
+ *
+ * The main file is not visited. Must be called before
+ * ast_parser_release_translation_unit().
+ *
+ * @param ast_data AST data returned by a parse function
+ * @param callback Called once per included file
+ * @param user_data Passed to callback
+ */
+void ast_parser_visit_included_files(void *ast_data, IncludedFileCallback callback, void *user_data);
+
+/**
+ * @brief Dispose the translation unit held by AST data
+ *
+ * The extracted project data is kept. Call this before disposing the
+ * index the translation unit was parsed with.
+ *
+ * @param ast_data AST data returned by a parse function
+ */
+void ast_parser_release_translation_unit(void *ast_data);
+
 /**
  * @brief Parse source file with language detection
  *
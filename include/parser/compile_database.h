@@ -0,0 +1,85 @@
+#ifndef COMPILE_DATABASE_H
+#define COMPILE_DATABASE_H
+
+#include "cqanalyzer.h"
+
+/**
+ * @file compile_database.h
+ * @brief Per-file compiler arguments from a compile_commands.json
+ *
+ * Loads a JSON compilation database through libclang and keeps, for each
+ * source file, the arguments it is built with, reduced to those that
+ * affect parsing: the compiler, the input and output files and the
+ * dependency-file options are removed, and -working-directory is put first so
+ * that relative paths resolve as in the build.
+ */
+
+typedef struct CompileDatabase CompileDatabase;
+
+/**
+ * @brief Arguments of one source file
+ */
+typedef struct
+{
+    const char *const *args;
+    int arg_count;
+} CompileCommandArgs;
+
+/**
+ * @brief Load the compile_commands.json of a build directory
+ *
+ * @param directory Directory containing compile_commands.json
+ * @return Loaded database, or NULL if there is none or it cannot be read
+ */
+CompileDatabase *compile_database_load(const char *directory);
+
+/**
+ * @brief Load a project's compilation database from the configured location
+ *
+ * Uses Config.compile_commands_dir, relative to the project root unless
+ * absolute, or looks in the project root and its build/ directory when it
+ * is empty. Returns NULL if Config.use_compile_commands is off.
+ *
+ * @param project_path Project root directory
+ * @return Loaded database, or NULL if none was found
+ */
+CompileDatabase *compile_database_load_for_project(const char *project_path);
+
+/**
+ * @brief Destroy a compilation database
+ *
+ * @param database Database to destroy (may be NULL)
+ */
+void compile_database_destroy(CompileDatabase *database);
+
+/**
+ * @brief Number of source files with arguments
+ *
+ * @param database Database (may be NULL)
+ * @return Number of files
+ */
+int compile_database_file_count(const CompileDatabase *database);
+
+/**
+ * @brief Hash of all commands, to tell whether results parsed with them are still valid
+ *
+ * Stable across runs, so it can be stored with cached results.
+ *
+ * @param database Database (may be NULL)
+ * @return Fingerprint, or 0 for NULL
+ */
+uint32_t compile_database_fingerprint(const CompileDatabase *database);
+
+/**
+ * @brief Get the arguments a file is built with
+ *
+ * Paths are compared after resolving symbolic links and relative
+ * components. Thread-safe.
+ *
+ * @param database Database (may be NULL)
+ * @param filepath Source file path
+ * @return Arguments owned by the database, or NULL if the file has no entry
+ */
+const CompileCommandArgs *compile_database_lookup(const CompileDatabase *database, const char *filepath);
+
+#endif // COMPILE_DATABASE_H
@@ -0,0 +1,104 @@
+#ifndef FILE_PREFETCH_H
+#define FILE_PREFETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cqanalyzer.h"
+#include "parser/file_scanner.h"
+
+/**
+ * @file file_prefetch.h
+ * @brief Asynchronous loading of scanned files ahead of the parse workers
+ *
+ * Takes files from a running scan and reads their contents into memory in
+ * the background, so that parse workers find them loaded and can hand them
+ * to libclang instead of waiting for the disk. Reads go through io_uring
+ * when the build has liburing and the kernel allows it, and through a pool
+ * of reader threads otherwise. The memory held by loaded files, queued or
+ * handed out, is capped by a byte budget.
+ */
+
+typedef struct FilePrefetch FilePrefetch;
+
+/**
+ * @brief A scanned file, with its contents if they were loaded
+ */
+typedef struct
+{
+    char *path;          // File path
+    long long size;      // Size in bytes reported by the scan
+    char *contents;      // NUL-terminated contents, or NULL if the file was not loaded
+    size_t length;       // Length of contents in bytes
+    int64_t mtime_ns;    // Modification time from the fstat() the contents were read after
+    bool budgeted;       // Whether contents count against the prefetch budget
+} PrefetchedFile;
+
+/**
+ * @brief Start loading the files of a scan in the background
+ *
+ * Files that do not fit the budget, or cannot be read, are passed on
+ * without contents. With a zero budget nothing is loaded and files are
+ * taken from the scan as they are requested.
+ *
+ * @param scan Running scan; must outlive the prefetcher
+ * @param thread_count Reader threads when io_uring is unavailable, or <= 0 for the default
+ * @param memory_budget Bytes of file contents held at most
+ * @return Running prefetcher, or NULL on error
+ */
+FilePrefetch *file_prefetch_start(FileScan *scan, int thread_count, size_t memory_budget);
+
+/**
+ * @brief Get the next file
+ *
+ * Returns the largest of the files buffered ahead, so large files are
+ * parsed first within a window of at most the queue capacity. With a zero
+ * budget, files come in scan order. Blocks until a file is available or
+ * the scan is exhausted. Thread-safe.
+ *
+ * @param prefetch Running prefetcher
+ * @param file Output file, to pass to file_prefetch_release() when done
+ * @return true if a file was returned, false once all files have been returned
+ */
+bool file_prefetch_next(FilePrefetch *prefetch, PrefetchedFile *file);
+
+/**
+ * @brief Load the contents of a file that was returned without them
+ *
+ * Reads on the calling thread, outside the memory budget. Fails if the
+ * file no longer has the size the scan reported.
+ *
+ * @param file File returned by file_prefetch_next()
+ * @return true if file->contents is loaded
+ */
+bool file_prefetch_load(PrefetchedFile *file);
+
+/**
+ * @brief Free a file returned by file_prefetch_next() and return its memory to the budget
+ *
+ * @param prefetch Prefetcher the file came from
+ * @param file File to release
+ */
+void file_prefetch_release(FilePrefetch *prefetch, PrefetchedFile *file);
+
+/**
+ * @brief Stop the scan and stop loading files
+ *
+ * Files already found are still returned, without contents if they were
+ * not loaded yet.
+ *
+ * @param prefetch Running prefetcher
+ */
+void file_prefetch_cancel(FilePrefetch *prefetch);
+
+/**
+ * @brief Stop the prefetcher, wait for its threads and free it
+ *
+ * Files not returned by file_prefetch_next() are discarded. The scan is
+ * left to the caller to finish.
+ *
+ * @param prefetch Prefetcher to finish (may be NULL)
+ */
+void file_prefetch_finish(FilePrefetch *prefetch);
+
+#endif // FILE_PREFETCH_H
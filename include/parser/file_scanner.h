@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "cqanalyzer.h"
+#include "parser/path_filter.h"
 
 /**
  * @file file_scanner.h
@@ -21,6 +22,115 @@
  */
 typedef void (*ProgressCallback)(int current, int total, const char *status);
 
+// Minimum time between two progress reports
+#define PROGRESS_REPORT_INTERVAL_MS 100
+
+/**
+ * @brief Rate limiter for progress callbacks (zero-initialize before use)
+ */
+typedef struct
+{
+    long long last_report_ns; // Monotonic time of the last report, 0 if none
+} ProgressThrottle;
+
+/**
+ * @brief Check whether enough time has passed to report progress again
+ *
+ * Costs one clock read, so callers can check it per item and only format
+ * status messages when it returns true. Not thread-safe.
+ *
+ * @param throttle Throttle state
+ * @return true on the first call and once per PROGRESS_REPORT_INTERVAL_MS
+ */
+bool progress_throttle_ready(ProgressThrottle *throttle);
+
+/**
+ * @brief Parallel directory scan in progress
+ *
+ * Scanner threads pop directories from a shared work queue and publish the
+ * source files they find to a bounded lock-free buffer, from which the
+ * caller consumes them while the scan is still running.
+ */
+typedef struct FileScan FileScan;
+
+/**
+ * @brief Snapshot of a running scan's progress
+ */
+typedef struct
+{
+    int dirs_scanned;     // Directories fully read
+    int dirs_total;       // Exact count once the pre-pass is done, else directories discovered so far
+    bool dirs_exact;      // Whether dirs_total comes from the pre-pass
+    int files_found;      // Source files published so far
+    int files_estimate;   // Expected source files in the whole tree
+    bool finished;        // All scanner threads are done
+} FileScanProgress;
+
+/**
+ * @brief Start scanning a directory tree in the background
+ *
+ * With count_directories, an extra thread counts the directories of the
+ * tree with getdents64() (readdir() elsewhere), without stat'ing entries,
+ * so progress can be reported against the exact total. Without it, the
+ * total is refined as directories are discovered.
+ *
+ * Paths excluded by the filter are skipped; excluded directories are pruned
+ * when their parent is read, so they are never opened.
+ *
+ * @param path Root directory to scan
+ * @param thread_count Number of scanner threads, or <= 0 for one per online CPU (at most 8)
+ * @param buffer_capacity Files buffered before scanners wait for the consumer,
+ *                        or <= 0 for the default
+ * @param count_directories Whether to run the directory-count pre-pass
+ * @param filter Exclusion rules, or NULL to scan everything; must outlive the scan
+ * @return Running scan, or NULL on error
+ */
+FileScan *file_scan_start(const char *path, int thread_count, int buffer_capacity, bool count_directories,
+                          const PathFilter *filter);
+
+/**
+ * @brief Get the next source file found by the scan
+ *
+ * Blocks until a file is available or the scan has finished. Files are
+ * returned in discovery order, which depends on thread timing. Thread-safe.
+ *
+ * @param scan Running scan
+ * @param path Output file path, owned by the caller
+ * @param size Optional output size of the file in bytes
+ * @return true if a file was returned, false once the scan is exhausted
+ */
+bool file_scan_next(FileScan *scan, char **path, long long *size);
+
+/**
+ * @brief Stop a scan early; files already buffered can still be consumed
+ *
+ * @param scan Running scan
+ */
+void file_scan_cancel(FileScan *scan);
+
+/**
+ * @brief Get the progress of a scan
+ *
+ * The file estimate extrapolates the files found per scanned directory to
+ * the directory total, and equals files_found once the scan has finished.
+ * Thread-safe.
+ *
+ * @param scan Running scan
+ * @param progress Output snapshot
+ */
+void file_scan_progress(const FileScan *scan, FileScanProgress *progress);
+
+/**
+ * @brief Stop the scan, wait for its threads and free it
+ *
+ * Files not consumed with file_scan_next() are discarded.
+ *
+ * @param scan Scan to finish
+ * @return Number of files returned by file_scan_next(), or -1 if a directory
+ *         could not be read
+ */
+int file_scan_finish(FileScan *scan);
+
 /**
  * @brief Scan directory recursively for source files
  *
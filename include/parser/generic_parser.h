@@ -1,6 +1,7 @@
 #ifndef GENERIC_PARSER_H
 #define GENERIC_PARSER_H
 
+#include <limits.h>
 #include "cqanalyzer.h"
 #include "data/ast_types.h"
 
@@ -41,11 +42,17 @@ CQError initialize_language_parsers(void);
  */
 void shutdown_language_parsers(void);
 
+// Pass as max_files to parse_project() to parse every file found
+#define PARSE_PROJECT_NO_FILE_LIMIT INT_MAX
+
 /**
  * @brief Parse an entire project with progress reporting
  *
+ * Files are parsed while the directory scan is still running, and memory
+ * does not grow with the number of files beyond the project itself.
+ *
  * @param project_path Path to the project root directory
- * @param max_files Maximum number of files to parse
+ * @param max_files Maximum number of files to parse, or PARSE_PROJECT_NO_FILE_LIMIT
  * @param progress_callback Optional progress callback function
  * @return Pointer to parsed project AST data, or NULL on error
  */
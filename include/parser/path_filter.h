@@ -0,0 +1,105 @@
+#ifndef PATH_FILTER_H
+#define PATH_FILTER_H
+
+#include <stdbool.h>
+#include "cqanalyzer.h"
+
+/**
+ * @file path_filter.h
+ * @brief Exclusion rules for directory scanning
+ *
+ * Decides which files and directories a scan skips, from configured glob
+ * patterns, the .gitignore files found in the tree and a maximum depth.
+ * Patterns follow .gitignore syntax: '*', '?' and '[...]' do not match '/',
+ * '**' matches across directories, a leading '!' re-includes, a trailing '/'
+ * matches directories only, and a pattern containing '/' is anchored to the
+ * directory it applies to while one without matches names at any level.
+ */
+
+typedef struct PathFilter PathFilter;
+
+/**
+ * @brief .gitignore rules in effect for a directory (reference counted)
+ *
+ * NULL is a valid value meaning "no .gitignore rules".
+ */
+typedef struct PathFilterDir PathFilterDir;
+
+/**
+ * @brief Create a path filter
+ *
+ * @param patterns Comma-separated glob patterns relative to the scan root, or NULL
+ * @param use_gitignore Whether to apply .gitignore files found during the scan
+ * @param max_depth Deepest directory level to scan (root is 0), or <= 0 for no limit
+ * @return New filter, or NULL on allocation failure
+ */
+PathFilter *path_filter_create(const char *patterns, bool use_gitignore, int max_depth);
+
+/**
+ * @brief Create a path filter from the scan_* configuration keys
+ *
+ * @return New filter, or NULL if the configuration is not initialized
+ */
+PathFilter *path_filter_create_from_config(void);
+
+/**
+ * @brief Destroy a path filter
+ *
+ * @param filter Filter to destroy (may be NULL)
+ */
+void path_filter_destroy(PathFilter *filter);
+
+/**
+ * @brief Check whether directories at a depth may be scanned
+ *
+ * @param filter Filter (NULL allows any depth)
+ * @param depth Directory depth below the scan root
+ * @return true if the directory may be opened
+ */
+bool path_filter_allows_depth(const PathFilter *filter, int depth);
+
+/**
+ * @brief Get the rules in effect inside a directory
+ *
+ * Reads the directory's .gitignore, if any, on top of the parent's rules.
+ *
+ * @param filter Filter (may be NULL)
+ * @param parent Rules of the parent directory (may be NULL)
+ * @param dir_fd Open descriptor of the directory
+ * @param rel_path Directory path relative to the scan root ("" for the root)
+ * @return New reference to the rules, to release with path_filter_dir_release()
+ */
+PathFilterDir *path_filter_enter(const PathFilter *filter, PathFilterDir *parent, int dir_fd,
+                                 const char *rel_path);
+
+/**
+ * @brief Take another reference to directory rules
+ *
+ * @param dir Rules (may be NULL)
+ * @return dir
+ */
+PathFilterDir *path_filter_dir_retain(PathFilterDir *dir);
+
+/**
+ * @brief Release a reference to directory rules
+ *
+ * @param dir Rules (may be NULL)
+ */
+void path_filter_dir_release(PathFilterDir *dir);
+
+/**
+ * @brief Check whether a path is excluded
+ *
+ * Configured patterns take precedence over .gitignore files, and deeper
+ * .gitignore files over shallower ones. Within one set the last matching
+ * pattern decides.
+ *
+ * @param filter Filter (NULL excludes nothing)
+ * @param dir Rules of the directory containing the path (may be NULL)
+ * @param rel_path Path relative to the scan root
+ * @param is_dir Whether the path is a directory
+ * @return true if the path should be skipped
+ */
+bool path_filter_excludes(const PathFilter *filter, const PathFilterDir *dir, const char *rel_path, bool is_dir);
+
+#endif // PATH_FILTER_H
@@ -0,0 +1,61 @@
+#ifndef PCH_CACHE_H
+#define PCH_CACHE_H
+
+#include "cqanalyzer.h"
+
+/**
+ * @file pch_cache.h
+ * @brief Shared precompiled headers for common include preambles
+ *
+ * Groups source files by their preamble, the leading block of system
+ * #include directives, together with the compiler arguments used to parse
+ * them. Once a preamble has been seen often enough, it is compiled into a
+ * precompiled header that later translation units load with -include-pch
+ * instead of re-parsing the same headers.
+ */
+
+typedef struct PchCache PchCache;
+
+/**
+ * @brief Create a PCH cache backed by a private temporary directory
+ *
+ * @param min_uses Number of files sharing a preamble before a PCH is built
+ * @return New cache, or NULL on error
+ */
+PchCache *pch_cache_create(int min_uses);
+
+/**
+ * @brief Destroy a PCH cache and delete the files it generated
+ *
+ * @param cache Cache to destroy
+ */
+void pch_cache_destroy(PchCache *cache);
+
+/**
+ * @brief Get a precompiled header matching a file's preamble
+ *
+ * Builds the PCH with the given index when the preamble reaches the use
+ * threshold. Files whose preamble is still being built by another thread
+ * are parsed without a PCH rather than waiting. Thread-safe.
+ *
+ * @param cache Cache
+ * @param index CXIndex of the calling thread, used to build the PCH
+ * @param filepath Source file about to be parsed
+ * @param contents Loaded contents of the file, or NULL to read it from disk
+ * @param length Length of contents in bytes
+ * @param args Compiler arguments the file will be parsed with
+ * @param arg_count Number of arguments
+ * @return Path of the PCH (owned by the cache), or NULL to parse normally
+ */
+const char *pch_cache_acquire(PchCache *cache, void *index, const char *filepath, const char *contents,
+                              size_t length, const char *const *args, int arg_count);
+
+/**
+ * @brief Stop using the PCH for a preamble after it was rejected by a parse
+ *
+ * @param cache Cache
+ * @param pch_path Path returned by pch_cache_acquire()
+ */
+void pch_cache_invalidate(PchCache *cache, const char *pch_path);
+
+#endif // PCH_CACHE_H
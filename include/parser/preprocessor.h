@@ -2,6 +2,7 @@
 #define PREPROCESSOR_H
 
 #include "cqanalyzer.h"
+#include "utils/memory.h"
 
 /**
  * @file preprocessor.h
@@ -21,24 +22,46 @@ typedef struct
 } IncludePath;
 
 /**
- * @brief Macro definition information
+ * @brief Macro definition, interned in a macro table
  */
 typedef struct
 {
-    char name[MAX_NAME_LENGTH];
-    char value[MAX_VALUE_LENGTH];
-    struct MacroDefinition *next;
+    const char *name;
+    const char *value;   // Empty for macros without a value
+    const char *arg;     // "-D" argument passed to libclang
 } MacroDefinition;
 
+/**
+ * @brief Macro definitions interned once for many files
+ *
+ * Each distinct definition is stored once, with its name, value and
+ * argument in an arena, and stays valid until the table is destroyed.
+ * Thread-safe.
+ */
+typedef struct MacroTable MacroTable;
+
+/**
+ * @brief Include directories discovered under a directory, shared read-only
+ *
+ * Derived by preprocessor_include_paths_acquire() from a cached walk of the
+ * directory or of a parent, and reused until a directory in that walk changes.
+ */
+typedef struct IncludePathSet IncludePathSet;
+
 /**
  * @brief Preprocessing context
  */
 typedef struct
 {
+    const IncludePathSet *shared_includes; // Borrowed, emitted before include_paths
     IncludePath *include_paths;
-    MacroDefinition *macros;
+    MacroTable *macro_table;               // Borrowed, or owned if owns_macro_table
+    bool owns_macro_table;
+    const MacroDefinition **macros;        // In definition order
     uint32_t include_count;
     uint32_t macro_count;
+    uint32_t macro_capacity;
+    MemoryArena arena;                     // Arguments built for include_paths
 } PreprocessingContext;
 
 /**
@@ -57,6 +80,98 @@ PreprocessingContext *preprocessor_init(void);
  */
 CQError preprocessor_scan_includes(PreprocessingContext *context, const char *project_root);
 
+/**
+ * @brief Get the include directories of a directory, scanning it only if needed
+ *
+ * The directory tree is walked once and cached; the sets of the root and of
+ * every directory below it are derived from that walk, so acquiring the
+ * project root first covers all of its source directories. A cached tree is
+ * reused as long as none of its directories has been modified since; during
+ * a parse run that is checked once per tree rather than on every acquire.
+ * Walks run without blocking threads that use other trees. Thread-safe.
+ *
+ * @param root Directory whose include directories to get
+ * @return Shared set to release with preprocessor_include_paths_release(),
+ *         or NULL on error
+ */
+const IncludePathSet *preprocessor_include_paths_acquire(const char *root);
+
+/**
+ * @brief Start a parse run, during which directory trees are assumed stable
+ *
+ * A cached tree found unchanged once during the run is reused without
+ * checking its directories again. Runs may nest or overlap; each must be
+ * ended with preprocessor_include_paths_end_run().
+ */
+void preprocessor_include_paths_begin_run(void);
+
+/**
+ * @brief End a run started with preprocessor_include_paths_begin_run()
+ */
+void preprocessor_include_paths_end_run(void);
+
+/**
+ * @brief Release a set returned by preprocessor_include_paths_acquire()
+ *
+ * @param set Set to release (may be NULL)
+ */
+void preprocessor_include_paths_release(const IncludePathSet *set);
+
+/**
+ * @brief Get the number of include directories in a shared set
+ *
+ * @param set Shared set
+ * @return Number of include directories
+ */
+uint32_t preprocessor_include_paths_count(const IncludePathSet *set);
+
+/**
+ * @brief Drop all cached include path sets that are no longer in use
+ */
+void preprocessor_include_paths_clear_cache(void);
+
+/**
+ * @brief Use a shared include path set instead of scanning
+ *
+ * @param context Preprocessing context
+ * @param set Shared set; must outlive the context
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError preprocessor_use_include_paths(PreprocessingContext *context, const IncludePathSet *set);
+
+/**
+ * @brief Create an empty macro table
+ *
+ * @return New macro table, or NULL on error
+ */
+MacroTable *preprocessor_macro_table_create(void);
+
+/**
+ * @brief Destroy a macro table and all definitions interned in it
+ *
+ * @param table Table to destroy (may be NULL)
+ */
+void preprocessor_macro_table_destroy(MacroTable *table);
+
+/**
+ * @brief Get the number of distinct definitions in a macro table
+ *
+ * @param table Macro table
+ * @return Number of definitions
+ */
+uint32_t preprocessor_macro_table_count(const MacroTable *table);
+
+/**
+ * @brief Intern extracted macros in a shared table instead of a private one
+ *
+ * Must be called before macros are extracted.
+ *
+ * @param context Preprocessing context
+ * @param table Shared table; must outlive the context
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError preprocessor_use_macro_table(PreprocessingContext *context, MacroTable *table);
+
 /**
  * @brief Extract macro definitions from source file
  *
@@ -66,9 +181,24 @@ CQError preprocessor_scan_includes(PreprocessingContext *context, const char *pr
  */
 CQError preprocessor_extract_macros(PreprocessingContext *context, const char *filepath);
 
+/**
+ * @brief Extract macro definitions from source file contents already in memory
+ *
+ * @param context Preprocessing context
+ * @param text Contents of the source file
+ * @param length Length of text in bytes
+ * @return CQ_SUCCESS on success, error code on failure
+ */
+CQError preprocessor_extract_macros_from_buffer(PreprocessingContext *context, const char *text, size_t length);
+
 /**
  * @brief Build command line arguments for libclang
  *
+ * The arguments are borrowed from the context, its include path set and
+ * its macro table, and must not be freed. They stay valid until the
+ * context is freed. When max_args is too small, include paths are dropped
+ * before macro definitions, with a warning.
+ *
  * @param context Preprocessing context
  * @param args Output array for arguments
  * @param max_args Maximum number of arguments
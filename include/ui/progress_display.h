@@ -39,6 +39,19 @@ void progress_start(const char *title, int total_items);
  */
 void progress_update(int current_item, const char *status);
 
+/**
+ * @brief Report progress of the current phase
+ *
+ * Matches the parser's progress callback. Draws a line for the running
+ * phase with its own item count, and an ETA based on wall-clock time.
+ * The overall progress set by progress_update() is unchanged.
+ *
+ * @param current Items done in the phase
+ * @param total Items expected in the phase (may grow while it runs)
+ * @param status Optional status message
+ */
+void progress_report(int current, int total, const char *status);
+
 /**
  * @brief Complete progress
  *
@@ -20,6 +20,16 @@ typedef struct
     bool enabled;       // Whether this metric is enabled
 } MetricConfig;
 
+// How much of each translation unit the parser processes. DECLARATIONS skips
+// the walk over function bodies, which is also where call edges
+// (Project.calls) and symbol usage counts are collected, so both stay empty.
+typedef enum
+{
+    ANALYSIS_PROFILE_AUTO = 0,        // Derived from the enabled metrics
+    ANALYSIS_PROFILE_FULL,            // Parse function bodies
+    ANALYSIS_PROFILE_DECLARATIONS     // Declarations and signatures only; no calls or usages
+} AnalysisProfile;
+
 // Configuration structure
 typedef struct
 {
@@ -31,6 +41,17 @@ typedef struct
     bool enable_metrics[32];  // Legacy support
     int max_file_size_mb;
     int thread_count;
+    bool enable_parse_cache;                  // Reuse results for unchanged files
+    char parse_cache_path[MAX_PATH_LENGTH];   // Empty: <project>/.cqanalyzer.cache
+    bool enable_pch;                          // Share precompiled preambles across files
+    bool scan_count_directories;              // Count directories up front for exact progress
+    char scan_exclude[MAX_PATH_LENGTH];       // Comma-separated globs of paths the scanner skips
+    bool scan_use_gitignore;                  // Skip paths ignored by .gitignore files
+    int scan_max_depth;                       // Deepest directory level scanned, 0: unlimited
+    int prefetch_memory_mb;                   // Memory for files loaded ahead of the parser, 0: off
+    bool use_compile_commands;                // Parse with the flags from compile_commands.json
+    char compile_commands_dir[MAX_PATH_LENGTH]; // Empty: project root, then build/
+    AnalysisProfile analysis_profile;
 
     // Metric-specific configurations
     MetricConfig cyclomatic_complexity;
@@ -129,6 +150,21 @@ bool config_get_bool(const char *key, bool default_value);
  */
 const MetricConfig *config_get_metric_config(const char *metric_name);
 
+/**
+ * @brief Resolve the parse profile required by the configured metrics
+ *
+ * An explicit profile is returned as is. ANALYSIS_PROFILE_AUTO resolves to
+ * ANALYSIS_PROFILE_FULL when a metric that needs function bodies
+ * (cyclomatic complexity, maintainability index) is enabled, and to
+ * ANALYSIS_PROFILE_DECLARATIONS otherwise. Callers that need call edges or
+ * usage counts must request ANALYSIS_PROFILE_FULL explicitly, since no
+ * metric depends on them.
+ *
+ * @param config Configuration, or NULL for ANALYSIS_PROFILE_FULL
+ * @return ANALYSIS_PROFILE_FULL or ANALYSIS_PROFILE_DECLARATIONS
+ */
+AnalysisProfile config_resolve_analysis_profile(const Config *config);
+
 /**
  * @brief Get overall quality threshold
  *
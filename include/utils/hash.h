@@ -0,0 +1,47 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file hash.h
+ * @brief Fast non-cryptographic hashing of strings and byte ranges
+ *
+ * A wyhash-style hash that consumes 8 bytes per step and mixes them with a
+ * 64x64->128-bit multiply, so keys that share long prefixes, such as paths
+ * in one directory, still spread over all bits. The secrets are fixed, so
+ * hashes are the same in every run and may be stored on disk; words are read
+ * in native byte order, so they are not portable across endianness. Changing
+ * the function invalidates every stored hash.
+ */
+
+/**
+ * @brief Hash a byte range
+ *
+ * @param data Bytes to hash (may be NULL if length is 0)
+ * @param length Number of bytes
+ * @return 64-bit hash
+ */
+uint64_t cq_hash_bytes(const void *data, size_t length);
+
+/**
+ * @brief Hash a NUL-terminated string
+ *
+ * @param str String to hash
+ * @return 64-bit hash, equal to cq_hash_bytes() over the characters
+ */
+uint64_t cq_hash_string(const char *str);
+
+/**
+ * @brief Fold the hash of one part of a compound key into the hash so far
+ *
+ * Order matters: combining a then b differs from b then a.
+ *
+ * @param seed Hash of the preceding parts
+ * @param hash Hash of the next part
+ * @return 64-bit hash of the parts so far
+ */
+uint64_t cq_hash_combine(uint64_t seed, uint64_t hash);
+
+#endif // HASH_H
@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include "cqanalyzer.h"
+
+/**
+ * @file mapped_file.h
+ * @brief Read-only whole-file access for text analysis
+ *
+ * Maps a file into memory once so that several analyzers can scan the
+ * same contents without reading or copying it again. Files that cannot be
+ * mapped (e.g. pipes or special files) are read into a heap buffer instead.
+ */
+
+/**
+ * @brief Contents of an opened file
+ */
+typedef struct
+{
+    const char *data;  // File contents, not NUL-terminated; valid until closed
+    size_t size;       // Size in bytes
+    bool mapped;       // Whether data is a memory mapping or a heap buffer
+} MappedFile;
+
+/**
+ * @brief Open a file and make its whole contents available
+ *
+ * @param filepath File path
+ * @param file Output file contents
+ * @return CQ_SUCCESS on success, CQ_ERROR_FILE_NOT_FOUND if the file cannot be
+ *         opened or read, CQ_ERROR_MEMORY_ALLOCATION if it cannot be buffered
+ */
+CQError mapped_file_open(const char *filepath, MappedFile *file);
+
+/**
+ * @brief Release the contents of a file
+ *
+ * @param file File opened with mapped_file_open() (may be zeroed)
+ */
+void mapped_file_close(MappedFile *file);
+
+#endif // MAPPED_FILE_H
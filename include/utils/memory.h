@@ -56,4 +56,57 @@ char *cq_strdup(const char *str);
  */
 CQError cq_memcpy_safe(void *dest, size_t dest_size, const void *src, size_t src_size);
 
+typedef struct MemoryArenaBlock MemoryArenaBlock;
+
+/**
+ * @brief Bump allocator for many small allocations freed together
+ *
+ * Allocations are carved from blocks of block_size bytes and stay valid
+ * until the arena is destroyed; they are not freed individually.
+ */
+typedef struct
+{
+    MemoryArenaBlock *blocks;  // Current block first
+    size_t block_size;
+    size_t allocated_bytes;    // Bytes handed out, excluding alignment padding
+} MemoryArena;
+
+/**
+ * @brief Initialize an empty arena
+ *
+ * @param arena Arena to initialize
+ * @param block_size Bytes per block, or 0 for the default
+ */
+void memory_arena_init(MemoryArena *arena, size_t block_size);
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * Requests larger than a block get a block of their own.
+ *
+ * @param arena Arena
+ * @param size Size in bytes
+ * @return Memory aligned for any type, or NULL on failure
+ */
+void *memory_arena_alloc(MemoryArena *arena, size_t size);
+
+/**
+ * @brief Copy a string into an arena
+ *
+ * Strings are packed without alignment padding.
+ *
+ * @param arena Arena
+ * @param str String to copy (need not be NUL-terminated)
+ * @param length Number of bytes to copy
+ * @return NUL-terminated copy, or NULL on failure
+ */
+char *memory_arena_strndup(MemoryArena *arena, const char *str, size_t length);
+
+/**
+ * @brief Free all memory of an arena, leaving it empty and reusable
+ *
+ * @param arena Arena
+ */
+void memory_arena_destroy(MemoryArena *arena);
+
 #endif // MEMORY_H
@@ -6,8 +6,11 @@
 #include <clang-c/Index.h>
 
 #include "analyzer/metric_calculator.h"
+#include "analyzer/duplication_detector.h"
+#include "analyzer/source_lexer.h"
 #include "data/ast_types.h"
 #include "utils/logger.h"
+#include "utils/mapped_file.h"
 
 int calculate_cyclomatic_complexity(void *ast_data)
 {
@@ -25,6 +28,29 @@ int calculate_cyclomatic_complexity(void *ast_data)
     return 1; // Default complexity
 }
 
+CQError calculate_lines_of_code_from_buffer(const char *text, size_t length, int *physical_loc,
+                                            int *logical_loc, int *comment_loc)
+{
+    if ((!text && length > 0) || !physical_loc || !logical_loc || !comment_loc)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Line categories only; no tokens are needed
+    SourceLineCounts lines;
+    CQError result = source_count_lines(text, length, &lines);
+    if (result != CQ_SUCCESS)
+    {
+        return result;
+    }
+
+    *physical_loc = lines.physical_lines;
+    *logical_loc = lines.code_lines;
+    *comment_loc = lines.comment_lines;
+
+    return CQ_SUCCESS;
+}
+
 CQError calculate_lines_of_code(const char *filepath, int *physical_loc,
                                 int *logical_loc, int *comment_loc)
 {
@@ -33,78 +59,88 @@ CQError calculate_lines_of_code(const char *filepath, int *physical_loc,
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    FILE *file = fopen(filepath, "r");
-    if (!file)
+    MappedFile file;
+    if (mapped_file_open(filepath, &file) != CQ_SUCCESS)
     {
         LOG_ERROR("Could not open file for LOC calculation: %s", filepath);
         return CQ_ERROR_FILE_NOT_FOUND;
     }
 
-    char line[1024];
-    int phys_lines = 0;
-    int log_lines = 0;
-    int comment_lines = 0;
-    bool in_multiline_comment = false;
+    CQError result = calculate_lines_of_code_from_buffer(file.data, file.size, physical_loc, logical_loc,
+                                                         comment_loc);
+    mapped_file_close(&file);
 
-    while (fgets(line, sizeof(line), file))
-    {
-        phys_lines++;
+    LOG_INFO("LOC calculation for %s: physical=%d, logical=%d, comments=%d",
+             filepath, *physical_loc, *logical_loc, *comment_loc);
 
-        // Remove trailing whitespace
-        char *end = line + strlen(line) - 1;
-        while (end > line && isspace(*end))
-            *end-- = '\0';
+    return result;
+}
 
-        // Skip empty lines
-        if (line[0] == '\0')
-        {
-            continue;
-        }
+void calculate_halstead_metrics_from_tokens(const SourceToken *tokens, int token_count, HalsteadMetrics *metrics)
+{
+    if (!metrics)
+    {
+        return;
+    }
 
-        // Check for comments
-        char *comment_start = strstr(line, "/*");
-        char *comment_end = strstr(line, "*/");
-        char *line_comment = strstr(line, "//");
+    // Initialize metrics to zero
+    memset(metrics, 0, sizeof(HalsteadMetrics));
 
-        if (in_multiline_comment)
+    for (int i = 0; tokens && i < token_count; i++)
+    {
+        switch (tokens[i].kind)
         {
-            comment_lines++;
-            if (comment_end)
-            {
-                in_multiline_comment = false;
-            }
-            continue;
+        case SOURCE_TOKEN_OPERATOR:
+        case SOURCE_TOKEN_KEYWORD:
+            metrics->N1++;
+            // For simplicity, assume all operators are distinct
+            metrics->n1++;
+            break;
+        case SOURCE_TOKEN_IDENTIFIER:
+        case SOURCE_TOKEN_NUMBER:
+        case SOURCE_TOKEN_STRING:
+            metrics->N2++;
+            // For simplicity, assume all operands are distinct
+            metrics->n2++;
+            break;
+        case SOURCE_TOKEN_PUNCTUATION:
+            break;
         }
+    }
 
-        if (comment_start && (!line_comment || comment_start < line_comment))
-        {
-            comment_lines++;
-            if (!comment_end)
-            {
-                in_multiline_comment = true;
-            }
-            continue;
-        }
+    // Calculate derived metrics
+    int N = metrics->N1 + metrics->N2;
+    int n = metrics->n1 + metrics->n2;
 
-        if (line_comment)
+    if (n > 0)
+    {
+        metrics->volume = N * log2((double)n);
+        if (metrics->n2 > 0)
         {
-            comment_lines++;
-            continue;
+            metrics->difficulty = ((double)metrics->n1 / 2.0) * ((double)metrics->N2 / (double)metrics->n2);
         }
-
-        // Count as logical line if it contains actual code
-        log_lines++;
+        metrics->effort = metrics->difficulty * metrics->volume;
+        metrics->time = metrics->effort / 18.0; // 18 seconds per unit effort
+        metrics->bugs = pow(metrics->effort, 2.0/3.0) / 3000.0;
     }
+}
 
-    fclose(file);
-
-    *physical_loc = phys_lines;
-    *logical_loc = log_lines;
-    *comment_loc = comment_lines;
+CQError calculate_halstead_metrics_from_buffer(const char *text, size_t length, HalsteadMetrics *metrics)
+{
+    if ((!text && length > 0) || !metrics)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
 
-    LOG_INFO("LOC calculation for %s: physical=%d, logical=%d, comments=%d",
-             filepath, phys_lines, log_lines, comment_lines);
+    SourceLexResult lex;
+    CQError result = source_lex(text, length, true, &lex);
+    if (result != CQ_SUCCESS)
+    {
+        return result;
+    }
 
+    calculate_halstead_metrics_from_tokens(lex.tokens, lex.token_count, metrics);
+    source_lex_result_free(&lex);
     return CQ_SUCCESS;
 }
 
@@ -115,78 +151,72 @@ CQError calculate_halstead_metrics(const char *filepath, HalsteadMetrics *metric
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    // Initialize metrics to zero
-    memset(metrics, 0, sizeof(HalsteadMetrics));
-
-    // For simplicity, use a basic token counting approach
-    // In a full implementation, this would use clang_tokenize
-
-    FILE *file = fopen(filepath, "r");
-    if (!file)
+    MappedFile file;
+    if (mapped_file_open(filepath, &file) != CQ_SUCCESS)
     {
         LOG_ERROR("Could not open file for Halstead calculation: %s", filepath);
         return CQ_ERROR_FILE_NOT_FOUND;
     }
 
-    // Simple token counting (operators and operands)
-    // This is a simplified implementation
-    char line[1024];
-    while (fgets(line, sizeof(line), file))
+    CQError result = calculate_halstead_metrics_from_buffer(file.data, file.size, metrics);
+    mapped_file_close(&file);
+
+    LOG_INFO("Halstead metrics for %s: n1=%d, n2=%d, N1=%d, N2=%d, volume=%.2f",
+             filepath, metrics->n1, metrics->n2, metrics->N1, metrics->N2, metrics->volume);
+
+    return result;
+}
+
+CQError calculate_text_metrics_from_buffer(const char *text, size_t length, TextMetrics *metrics)
+{
+    if ((!text && length > 0) || !metrics)
     {
-        char *token = strtok(line, " \t\n\r;(){}[]");
-        while (token)
-        {
-            // Count operators
-            if (strcmp(token, "+") == 0 || strcmp(token, "-") == 0 ||
-                strcmp(token, "*") == 0 || strcmp(token, "/") == 0 ||
-                strcmp(token, "%") == 0 || strcmp(token, "=") == 0 ||
-                strcmp(token, "==") == 0 || strcmp(token, "!=") == 0 ||
-                strcmp(token, "<") == 0 || strcmp(token, ">") == 0 ||
-                strcmp(token, "<=") == 0 || strcmp(token, ">=") == 0 ||
-                strcmp(token, "&&") == 0 || strcmp(token, "||") == 0 ||
-                strcmp(token, "!") == 0 || strcmp(token, "if") == 0 ||
-                strcmp(token, "while") == 0 || strcmp(token, "for") == 0 ||
-                strcmp(token, "return") == 0)
-            {
-                metrics->N1++;
-                // For simplicity, assume all operators are distinct
-                metrics->n1++;
-            }
-            // Count operands (identifiers and literals)
-            else if (isalpha(token[0]) || token[0] == '_' ||
-                     (isdigit(token[0]) && strlen(token) > 1))
-            {
-                metrics->N2++;
-                // For simplicity, assume all operands are distinct
-                metrics->n2++;
-            }
-
-            token = strtok(NULL, " \t\n\r;(){}[]");
-        }
+        return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    fclose(file);
+    memset(metrics, 0, sizeof(TextMetrics));
 
-    // Calculate derived metrics
-    int N = metrics->N1 + metrics->N2;
-    int n = metrics->n1 + metrics->n2;
+    // One lexer pass feeds every text-level metric
+    SourceLexResult lex;
+    CQError result = source_lex(text, length, true, &lex);
+    if (result != CQ_SUCCESS)
+    {
+        return result;
+    }
 
-    if (n > 0)
+    metrics->physical_loc = lex.physical_lines;
+    metrics->logical_loc = lex.code_lines;
+    metrics->comment_loc = lex.comment_lines;
+    calculate_halstead_metrics_from_tokens(lex.tokens, lex.token_count, &metrics->halstead);
+    result = detect_duplication_from_tokens(lex.tokens, lex.token_count, &metrics->duplication_ratio);
+
+    source_lex_result_free(&lex);
+    return result;
+}
+
+CQError calculate_text_metrics(const char *filepath, TextMetrics *metrics)
+{
+    if (!filepath || !metrics)
     {
-        metrics->volume = N * log2((double)n);
-        if (metrics->n2 > 0)
-        {
-            metrics->difficulty = ((double)metrics->n1 / 2.0) * ((double)metrics->N2 / (double)metrics->n2);
-        }
-        metrics->effort = metrics->difficulty * metrics->volume;
-        metrics->time = metrics->effort / 18.0; // 18 seconds per unit effort
-        metrics->bugs = pow(metrics->effort, 2.0/3.0) / 3000.0;
+        return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    LOG_INFO("Halstead metrics for %s: n1=%d, n2=%d, N1=%d, N2=%d, volume=%.2f",
-             filepath, metrics->n1, metrics->n2, metrics->N1, metrics->N2, metrics->volume);
+    // The file is read once and lexed once for all text-level metrics
+    MappedFile file;
+    if (mapped_file_open(filepath, &file) != CQ_SUCCESS)
+    {
+        LOG_ERROR("Could not open file for text metrics: %s", filepath);
+        return CQ_ERROR_FILE_NOT_FOUND;
+    }
 
-    return CQ_SUCCESS;
+    CQError result = calculate_text_metrics_from_buffer(file.data, file.size, metrics);
+    mapped_file_close(&file);
+
+    LOG_DEBUG("Text metrics for %s: physical=%d, logical=%d, comments=%d, volume=%.2f, duplication=%.3f",
+              filepath, metrics->physical_loc, metrics->logical_loc, metrics->comment_loc,
+              metrics->halstead.volume, metrics->duplication_ratio);
+
+    return result;
 }
 
 double calculate_maintainability_index(int complexity, int loc, double comment_ratio)
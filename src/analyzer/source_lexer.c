@@ -0,0 +1,583 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SOURCE_LINES_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SOURCE_LINES_SIMD 1
+#endif
+
+#include "analyzer/source_lexer.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+// Expected bytes per token, used to size the token array up front
+#define SOURCE_BYTES_PER_TOKEN 5
+
+static const char *const three_char_operators[] = {"<<=", ">>=", "...", "->*", "<=>"};
+static const char *const two_char_operators[] = {
+    "==", "!=", "<=", ">=", "&&", "||", "++", "--", "+=", "-=", "*=",
+    "/=", "%=", "&=", "|=", "^=", "<<", ">>", "->", "::", ".*"};
+
+static const char *const keywords[] = {
+    "if", "else", "while", "for", "do", "switch", "case", "default",
+    "break", "continue", "return", "goto", "sizeof"};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_identifier_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+}
+
+static bool is_identifier_char(char c)
+{
+    return is_identifier_start(c) || is_digit(c);
+}
+
+static bool is_operator_char(char c)
+{
+    return c != '\0' && strchr("+-*/%=!<>&|^~?:.", c) != NULL;
+}
+
+static bool is_keyword(const char *token, size_t length)
+{
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+    {
+        if (strlen(keywords[i]) == length && memcmp(keywords[i], token, length) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Length of the longest operator starting at p, or 0 if there is none
+ */
+static size_t operator_length(const char *p, const char *end)
+{
+    if (!is_operator_char(*p))
+    {
+        return 0;
+    }
+
+    size_t available = (size_t)(end - p);
+    if (available >= 3)
+    {
+        for (size_t i = 0; i < sizeof(three_char_operators) / sizeof(three_char_operators[0]); i++)
+        {
+            if (memcmp(p, three_char_operators[i], 3) == 0)
+            {
+                return 3;
+            }
+        }
+    }
+    if (available >= 2)
+    {
+        for (size_t i = 0; i < sizeof(two_char_operators) / sizeof(two_char_operators[0]); i++)
+        {
+            if (memcmp(p, two_char_operators[i], 2) == 0)
+            {
+                return 2;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Skip a numeric literal, including suffixes and exponent signs
+ */
+static const char *scan_number(const char *p, const char *end)
+{
+    p++;
+    while (p < end)
+    {
+        char c = *p;
+        if (is_identifier_char(c) || c == '.')
+        {
+            p++;
+        }
+        else if ((c == '+' || c == '-') && (p[-1] == 'e' || p[-1] == 'E' || p[-1] == 'p' || p[-1] == 'P'))
+        {
+            p++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return p;
+}
+
+/**
+ * @brief Skip a string or character literal; unterminated ones end at the line
+ */
+static const char *scan_literal(const char *p, const char *end)
+{
+    char quote = *p++;
+    while (p < end && *p != quote && *p != '\n')
+    {
+        p += (*p == '\\' && p + 1 < end && p[1] != '\n') ? 2 : 1;
+    }
+    return (p < end && *p == quote) ? p + 1 : p;
+}
+
+static bool push_token(SourceLexResult *result, const char *start, size_t length, SourceTokenKind kind)
+{
+    if (result->token_count == result->token_capacity)
+    {
+        if (result->token_capacity > INT_MAX / 2)
+        {
+            return false;
+        }
+        int new_capacity = result->token_capacity ? result->token_capacity * 2 : 64;
+        SourceToken *new_tokens = realloc(result->tokens, new_capacity * sizeof(SourceToken));
+        if (!new_tokens)
+        {
+            return false;
+        }
+        result->tokens = new_tokens;
+        result->token_capacity = new_capacity;
+    }
+
+    result->tokens[result->token_count].hash = (unsigned long)cq_hash_bytes(start, length);
+    result->tokens[result->token_count].kind = kind;
+    result->token_count++;
+    return true;
+}
+
+static void finish_line(SourceLexResult *result, bool has_code, bool has_comment)
+{
+    result->physical_lines++;
+    if (has_code)
+    {
+        result->code_lines++;
+    }
+    else if (has_comment)
+    {
+        result->comment_lines++;
+    }
+    else
+    {
+        result->blank_lines++;
+    }
+}
+
+CQError source_lex(const char *text, size_t length, bool collect_tokens, SourceLexResult *result)
+{
+    if ((!text && length > 0) || !result)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(result, 0, sizeof(*result));
+
+    if (collect_tokens && length > 0)
+    {
+        size_t expected = length / SOURCE_BYTES_PER_TOKEN + 16;
+        result->token_capacity = expected < INT_MAX / 2 ? (int)expected : INT_MAX / 2;
+        result->tokens = malloc(result->token_capacity * sizeof(SourceToken));
+        if (!result->tokens)
+        {
+            result->token_capacity = 0;
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    const char *p = text;
+    const char *end = text + length;
+    bool in_block_comment = false;
+    bool line_started = false;
+    bool line_has_code = false;
+    bool line_has_comment = false;
+
+    while (p < end)
+    {
+        char c = *p;
+        if (c == '\n')
+        {
+            finish_line(result, line_has_code, line_has_comment);
+            line_started = line_has_code = line_has_comment = false;
+            p++;
+            continue;
+        }
+        line_started = true;
+
+        if (in_block_comment)
+        {
+            if (c == '*' && p + 1 < end && p[1] == '/')
+            {
+                in_block_comment = false;
+                line_has_comment = true;
+                p += 2;
+                continue;
+            }
+            if (!is_space(c))
+            {
+                line_has_comment = true;
+            }
+            p++;
+            continue;
+        }
+
+        if (is_space(c))
+        {
+            p++;
+            continue;
+        }
+
+        if (c == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))
+        {
+            line_has_comment = true;
+            if (p[1] == '*')
+            {
+                in_block_comment = true;
+                p += 2;
+            }
+            else
+            {
+                const char *newline = memchr(p, '\n', (size_t)(end - p));
+                p = newline ? newline : end;
+            }
+            continue;
+        }
+
+        const char *start = p;
+        SourceTokenKind kind;
+        size_t op_length;
+        if (is_identifier_start(c))
+        {
+            while (++p < end && is_identifier_char(*p))
+                ;
+            kind = is_keyword(start, (size_t)(p - start)) ? SOURCE_TOKEN_KEYWORD : SOURCE_TOKEN_IDENTIFIER;
+        }
+        else if (is_digit(c) || (c == '.' && p + 1 < end && is_digit(p[1])))
+        {
+            p = scan_number(p, end);
+            kind = SOURCE_TOKEN_NUMBER;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            p = scan_literal(p, end);
+            kind = SOURCE_TOKEN_STRING;
+        }
+        else if ((op_length = operator_length(p, end)) > 0)
+        {
+            p += op_length;
+            kind = SOURCE_TOKEN_OPERATOR;
+        }
+        else
+        {
+            p++;
+            kind = SOURCE_TOKEN_PUNCTUATION;
+        }
+
+        line_has_code = true;
+        if (collect_tokens && !push_token(result, start, (size_t)(p - start), kind))
+        {
+            LOG_ERROR("Memory allocation failed for source tokens");
+            source_lex_result_free(result);
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    if (line_started)
+    {
+        finish_line(result, line_has_code, line_has_comment);
+    }
+
+    return CQ_SUCCESS;
+}
+
+void source_lex_result_free(SourceLexResult *result)
+{
+    if (!result)
+    {
+        return;
+    }
+
+    free(result->tokens);
+    result->tokens = NULL;
+    result->token_count = 0;
+    result->token_capacity = 0;
+}
+
+/**
+ * @brief Line classification state carried between chunks
+ */
+typedef struct
+{
+    bool in_block_comment;
+    bool line_started;
+    bool line_has_code;
+    bool line_has_comment;
+} LineScanState;
+
+static void add_line(SourceLineCounts *counts, LineScanState *state)
+{
+    counts->physical_lines++;
+    if (state->line_has_code)
+    {
+        counts->code_lines++;
+    }
+    else if (state->line_has_comment)
+    {
+        counts->comment_lines++;
+    }
+    else
+    {
+        counts->blank_lines++;
+    }
+    state->line_started = state->line_has_code = state->line_has_comment = false;
+}
+
+/**
+ * @brief Classify bytes from p until stop with the same rules as source_lex()
+ *
+ * Tokens are not delimited: every byte outside comments and whitespace marks
+ * its line as code, which is what the lexer decides for any token it would
+ * produce. Comments and literals crossing stop are consumed whole.
+ *
+ * @return Position where scanning stopped (at or after stop)
+ */
+static const char *scan_lines(const char *p, const char *stop, const char *end, LineScanState *state,
+                              SourceLineCounts *counts)
+{
+    while (p < stop)
+    {
+        char c = *p;
+        if (c == '\n')
+        {
+            add_line(counts, state);
+            p++;
+            continue;
+        }
+        state->line_started = true;
+
+        if (state->in_block_comment)
+        {
+            if (c == '*' && p + 1 < end && p[1] == '/')
+            {
+                state->in_block_comment = false;
+                state->line_has_comment = true;
+                p += 2;
+                continue;
+            }
+            if (!is_space(c))
+            {
+                state->line_has_comment = true;
+            }
+            p++;
+            continue;
+        }
+
+        if (is_space(c))
+        {
+            p++;
+            continue;
+        }
+
+        if (c == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))
+        {
+            state->line_has_comment = true;
+            if (p[1] == '*')
+            {
+                state->in_block_comment = true;
+                p += 2;
+            }
+            else
+            {
+                const char *newline = memchr(p, '\n', (size_t)(end - p));
+                p = newline ? newline : end;
+            }
+            continue;
+        }
+
+        state->line_has_code = true;
+        p = (c == '"' || c == '\'') ? scan_literal(p, end) : p + 1;
+    }
+    return p;
+}
+
+#ifdef SOURCE_LINES_SIMD
+
+#define LINE_CHUNK_SIZE 32
+
+/**
+ * @brief Byte masks of a 32-byte chunk, bit i describing byte i
+ */
+typedef struct
+{
+    uint32_t newline;
+    uint32_t nonspace;   // Neither whitespace nor newline
+    uint32_t delimiter;  // '/', '"' or '\'': may open a comment or literal
+    uint32_t star;       // '*': may close a block comment
+} ChunkMasks;
+
+#if defined(__AVX2__)
+
+static ChunkMasks classify_chunk(const char *p)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i newline = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    // '\t' through '\r' are contiguous; bytes >= 0x80 compare as negative
+    __m256i space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+        _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v)));
+    __m256i delimiter = _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))));
+
+    ChunkMasks masks;
+    masks.newline = (uint32_t)_mm256_movemask_epi8(newline);
+    masks.nonspace = ~(uint32_t)_mm256_movemask_epi8(space);
+    masks.delimiter = (uint32_t)_mm256_movemask_epi8(delimiter);
+    masks.star = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+    return masks;
+}
+
+#else
+
+static ChunkMasks classify_half(const char *p)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i newline = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    // '\t' through '\r' are contiguous; bytes >= 0x80 compare as negative
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                                               _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1))));
+    __m128i delimiter = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\''))));
+
+    ChunkMasks masks;
+    masks.newline = (uint32_t)_mm_movemask_epi8(newline);
+    masks.nonspace = ~(uint32_t)_mm_movemask_epi8(space) & 0xFFFFu;
+    masks.delimiter = (uint32_t)_mm_movemask_epi8(delimiter);
+    masks.star = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+    return masks;
+}
+
+static ChunkMasks classify_chunk(const char *p)
+{
+    ChunkMasks lo = classify_half(p);
+    ChunkMasks hi = classify_half(p + 16);
+
+    ChunkMasks masks;
+    masks.newline = lo.newline | hi.newline << 16;
+    masks.nonspace = lo.nonspace | hi.nonspace << 16;
+    masks.delimiter = lo.delimiter | hi.delimiter << 16;
+    masks.star = lo.star | hi.star << 16;
+    return masks;
+}
+
+#endif
+
+/**
+ * @brief Classify a chunk that neither opens nor closes a comment or literal
+ *
+ * Non-whitespace bytes mark their line as comment inside a block comment and
+ * as code otherwise.
+ */
+static void scan_lines_chunk(const ChunkMasks *masks, LineScanState *state, SourceLineCounts *counts)
+{
+    uint64_t newlines = masks->newline;
+    uint64_t nonspace = masks->nonspace;
+    unsigned start = 0;
+
+    for (;;)
+    {
+        unsigned stop = newlines ? (unsigned)__builtin_ctzll(newlines) : LINE_CHUNK_SIZE;
+        uint64_t segment = ((1ull << stop) - 1) & ~((1ull << start) - 1);
+        if (segment)
+        {
+            state->line_started = true;
+            if (nonspace & segment)
+            {
+                if (state->in_block_comment)
+                {
+                    state->line_has_comment = true;
+                }
+                else
+                {
+                    state->line_has_code = true;
+                }
+            }
+        }
+        if (!newlines)
+        {
+            break;
+        }
+        add_line(counts, state);
+        newlines &= newlines - 1;
+        start = stop + 1;
+    }
+}
+
+#endif // SOURCE_LINES_SIMD
+
+static CQError count_lines(const char *text, size_t length, bool vectorize, SourceLineCounts *counts)
+{
+    if ((!text && length > 0) || !counts)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(counts, 0, sizeof(*counts));
+
+    const char *p = text;
+    const char *end = text + length;
+    LineScanState state = {0};
+
+#ifdef SOURCE_LINES_SIMD
+    while (vectorize && end - p >= LINE_CHUNK_SIZE)
+    {
+        ChunkMasks masks = classify_chunk(p);
+        if (state.in_block_comment ? masks.star == 0 : masks.delimiter == 0)
+        {
+            scan_lines_chunk(&masks, &state, counts);
+            p += LINE_CHUNK_SIZE;
+        }
+        else
+        {
+            p = scan_lines(p, p + LINE_CHUNK_SIZE, end, &state, counts);
+        }
+    }
+#else
+    (void)vectorize;
+#endif
+
+    scan_lines(p, end, end, &state, counts);
+    if (state.line_started)
+    {
+        add_line(counts, &state);
+    }
+
+    return CQ_SUCCESS;
+}
+
+CQError source_count_lines(const char *text, size_t length, SourceLineCounts *counts)
+{
+    return count_lines(text, length, true, counts);
+}
+
+CQError source_count_lines_scalar(const char *text, size_t length, SourceLineCounts *counts)
+{
+    return count_lines(text, length, false, counts);
+}
@@ -0,0 +1,967 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "data/analysis_cache.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+// Bump when the on-disk layout or the meaning of a record changes
+#define CACHE_MAGIC 0x43514143u   // "CAQC"
+#define CACHE_FORMAT_VERSION 6u
+
+// Whether a dependency still matches, found by the first lookup that needs it
+enum
+{
+    DEPENDENCY_UNCHECKED = 0,
+    DEPENDENCY_CURRENT,
+    DEPENDENCY_CHANGED
+};
+
+/**
+ * @brief One version of a file that cached entries depend on, shared by all of them
+ */
+typedef struct
+{
+    char *path;
+    int64_t mtime_ns;
+    int64_t size;
+    atomic_int state;         // DEPENDENCY_*; set once per loaded cache
+} CacheDependency;
+
+/**
+ * @brief One cached file
+ */
+typedef struct
+{
+    char *path;
+    AnalysisCacheKey key;
+    unsigned char *blob;      // Serialized per-file records
+    uint32_t blob_size;
+    uint32_t *dependencies;   // Indices into the cache's dependencies
+    uint32_t dependency_count;
+    bool live;                // Stored or retained during this run
+} CacheEntry;
+
+struct AnalysisCache
+{
+    CacheEntry *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *index;          // Open-addressing table of entry indices by path
+    uint32_t index_size;
+    CacheDependency *dependencies;
+    uint32_t dependency_count;
+    uint32_t dependency_capacity;
+    uint32_t *dependency_index; // Open-addressing table of dependency indices by path and version
+    uint32_t dependency_index_size;
+    uint32_t variant;         // Parser settings the entries were produced with
+};
+
+/**
+ * @brief Header written at the start of the cache file
+ *
+ * Record sizes are included so that a change to any AST record layout
+ * invalidates the cache instead of misreading it.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t file_info_size;
+    uint32_t function_info_size;
+    uint32_t class_info_size;
+    uint32_t variable_info_size;
+    uint32_t variant;
+    uint32_t dependency_count;
+    uint32_t entry_count;
+    char analyzer_version[16];
+} CacheHeader;
+
+static CQError cache_rebuild_index(AnalysisCache *cache, uint32_t new_size)
+{
+    uint32_t *index = (uint32_t *)malloc(new_size * sizeof(uint32_t));
+    if (!index)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(index, 0xFF, new_size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        uint32_t bucket = (uint32_t)(cq_hash_string(cache->entries[i].path) % new_size);
+        while (index[bucket] != UINT32_MAX)
+        {
+            bucket = (bucket + 1) % new_size;
+        }
+        index[bucket] = i;
+    }
+
+    free(cache->index);
+    cache->index = index;
+    cache->index_size = new_size;
+    return CQ_SUCCESS;
+}
+
+static CacheEntry *cache_find(const AnalysisCache *cache, const char *filepath)
+{
+    if (cache->index_size == 0)
+    {
+        return NULL;
+    }
+
+    uint32_t bucket = (uint32_t)(cq_hash_string(filepath) % cache->index_size);
+    while (cache->index[bucket] != UINT32_MAX)
+    {
+        CacheEntry *entry = &cache->entries[cache->index[bucket]];
+        if (strcmp(entry->path, filepath) == 0)
+        {
+            return entry;
+        }
+        bucket = (bucket + 1) % cache->index_size;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Append an entry; takes ownership of path and blob
+ */
+static CacheEntry *cache_append(AnalysisCache *cache, char *path)
+{
+    if (cache->count >= cache->capacity)
+    {
+        uint32_t new_capacity = cache->capacity ? cache->capacity * 2 : 64;
+        CacheEntry *entries = (CacheEntry *)realloc(cache->entries, new_capacity * sizeof(CacheEntry));
+        if (!entries)
+        {
+            return NULL;
+        }
+        cache->entries = entries;
+        cache->capacity = new_capacity;
+    }
+
+    // Keep the path index at most half full
+    if ((cache->count + 1) * 2 > cache->index_size)
+    {
+        uint32_t new_size = cache->index_size ? cache->index_size * 2 : 128;
+        if (cache_rebuild_index(cache, new_size) != CQ_SUCCESS)
+        {
+            return NULL;
+        }
+    }
+
+    CacheEntry *entry = &cache->entries[cache->count];
+    memset(entry, 0, sizeof(CacheEntry));
+    entry->path = path;
+
+    uint32_t bucket = (uint32_t)(cq_hash_string(path) % cache->index_size);
+    while (cache->index[bucket] != UINT32_MAX)
+    {
+        bucket = (bucket + 1) % cache->index_size;
+    }
+    cache->index[bucket] = cache->count++;
+
+    return entry;
+}
+
+static uint32_t dependency_hash(const char *path, int64_t mtime_ns, int64_t size)
+{
+    return (uint32_t)cq_hash_combine(cq_hash_string(path), (uint64_t)mtime_ns ^ ((uint64_t)size << 32));
+}
+
+static CQError cache_rebuild_dependency_index(AnalysisCache *cache, uint32_t new_size)
+{
+    uint32_t *index = (uint32_t *)malloc(new_size * sizeof(uint32_t));
+    if (!index)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(index, 0xFF, new_size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < cache->dependency_count; i++)
+    {
+        const CacheDependency *dependency = &cache->dependencies[i];
+        uint32_t bucket = dependency_hash(dependency->path, dependency->mtime_ns, dependency->size) % new_size;
+        while (index[bucket] != UINT32_MAX)
+        {
+            bucket = (bucket + 1) % new_size;
+        }
+        index[bucket] = i;
+    }
+
+    free(cache->dependency_index);
+    cache->dependency_index = index;
+    cache->dependency_index_size = new_size;
+    return CQ_SUCCESS;
+}
+
+/**
+ * @brief Find or add a version of a dependency
+ *
+ * @return Index of the dependency, or UINT32_MAX on allocation failure
+ */
+static uint32_t cache_intern_dependency(AnalysisCache *cache, const char *path, int64_t mtime_ns, int64_t size,
+                                        int state)
+{
+    if (cache->dependency_index_size > 0)
+    {
+        uint32_t bucket = dependency_hash(path, mtime_ns, size) % cache->dependency_index_size;
+        while (cache->dependency_index[bucket] != UINT32_MAX)
+        {
+            const CacheDependency *dependency = &cache->dependencies[cache->dependency_index[bucket]];
+            if (dependency->mtime_ns == mtime_ns && dependency->size == size && strcmp(dependency->path, path) == 0)
+            {
+                return cache->dependency_index[bucket];
+            }
+            bucket = (bucket + 1) % cache->dependency_index_size;
+        }
+    }
+
+    if (cache->dependency_count >= cache->dependency_capacity)
+    {
+        uint32_t new_capacity = cache->dependency_capacity ? cache->dependency_capacity * 2 : 64;
+        CacheDependency *dependencies =
+            (CacheDependency *)realloc(cache->dependencies, new_capacity * sizeof(CacheDependency));
+        if (!dependencies)
+        {
+            return UINT32_MAX;
+        }
+        cache->dependencies = dependencies;
+        cache->dependency_capacity = new_capacity;
+    }
+
+    // Keep the dependency index at most half full
+    if ((cache->dependency_count + 1) * 2 > cache->dependency_index_size)
+    {
+        uint32_t new_size = cache->dependency_index_size ? cache->dependency_index_size * 2 : 128;
+        if (cache_rebuild_dependency_index(cache, new_size) != CQ_SUCCESS)
+        {
+            return UINT32_MAX;
+        }
+    }
+
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        return UINT32_MAX;
+    }
+
+    CacheDependency *dependency = &cache->dependencies[cache->dependency_count];
+    dependency->path = copy;
+    dependency->mtime_ns = mtime_ns;
+    dependency->size = size;
+    atomic_init(&dependency->state, state);
+
+    uint32_t bucket = dependency_hash(path, mtime_ns, size) % cache->dependency_index_size;
+    while (cache->dependency_index[bucket] != UINT32_MAX)
+    {
+        bucket = (bucket + 1) % cache->dependency_index_size;
+    }
+    cache->dependency_index[bucket] = cache->dependency_count;
+    return cache->dependency_count++;
+}
+
+/**
+ * @brief Check that a dependency still has its recorded modification time and size
+ *
+ * Each dependency is checked with stat() by the first lookup that needs it;
+ * concurrent lookups may both check it and store the same result.
+ */
+static bool cache_dependency_current(CacheDependency *dependency)
+{
+    int state = atomic_load_explicit(&dependency->state, memory_order_relaxed);
+    if (state == DEPENDENCY_UNCHECKED)
+    {
+        struct stat st;
+        bool current = stat(dependency->path, &st) == 0 && (int64_t)st.st_size == dependency->size &&
+                       (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec == dependency->mtime_ns;
+        state = current ? DEPENDENCY_CURRENT : DEPENDENCY_CHANGED;
+        atomic_store_explicit(&dependency->state, state, memory_order_relaxed);
+    }
+    return state == DEPENDENCY_CURRENT;
+}
+
+/**
+ * @brief Growable byte buffer used to serialize entries
+ */
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ByteBuffer;
+
+static void buffer_write(ByteBuffer *buffer, const void *data, size_t length)
+{
+    if (buffer->failed)
+    {
+        return;
+    }
+
+    if (buffer->size + length > buffer->capacity)
+    {
+        size_t new_capacity = buffer->capacity ? buffer->capacity : 256;
+        while (new_capacity < buffer->size + length)
+        {
+            new_capacity *= 2;
+        }
+        unsigned char *new_data = (unsigned char *)realloc(buffer->data, new_capacity);
+        if (!new_data)
+        {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = new_data;
+        buffer->capacity = new_capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, data, length);
+    buffer->size += length;
+}
+
+static void buffer_write_u32(ByteBuffer *buffer, uint32_t value)
+{
+    buffer_write(buffer, &value, sizeof(value));
+}
+
+/**
+ * @brief Bounds-checked reader over a serialized blob
+ */
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+} ByteReader;
+
+static bool reader_read(ByteReader *reader, void *out, size_t length)
+{
+    if (reader->offset + length > reader->size)
+    {
+        return false;
+    }
+    memcpy(out, reader->data + reader->offset, length);
+    reader->offset += length;
+    return true;
+}
+
+static bool reader_read_u32(ByteReader *reader, uint32_t *value)
+{
+    return reader_read(reader, value, sizeof(*value));
+}
+
+/**
+ * @brief Serialize a per-file project: string pool, then the raw record arrays
+ */
+static bool serialize_project(const Project *project, ByteBuffer *buffer)
+{
+    const StringPool *pool = &project->string_pool;
+    buffer_write_u32(buffer, pool->count);
+    for (uint32_t i = 0; i < pool->count; i++)
+    {
+        const char *str = string_pool_get(pool, i);
+        uint32_t length = (uint32_t)strlen(str);
+        buffer_write_u32(buffer, length);
+        buffer_write(buffer, str, length);
+    }
+
+    buffer_write_u32(buffer, project->files.count);
+    buffer_write(buffer, project->files.files, project->files.count * sizeof(FileInfo));
+
+    buffer_write_u32(buffer, project->functions.count);
+    buffer_write(buffer, project->functions.functions, project->functions.count * sizeof(FunctionInfo));
+
+    buffer_write_u32(buffer, project->classes.count);
+    buffer_write(buffer, project->classes.classes, project->classes.count * sizeof(ClassInfo));
+    for (uint32_t i = 0; i < project->classes.count; i++)
+    {
+        const ClassInfo *cls = &project->classes.classes[i];
+        uint32_t method_count = cls->method_indices ? cls->method_count : 0;
+        buffer_write_u32(buffer, method_count);
+        buffer_write(buffer, cls->method_indices, method_count * sizeof(uint32_t));
+    }
+
+    buffer_write_u32(buffer, project->variables.count);
+    buffer_write(buffer, project->variables.variables, project->variables.count * sizeof(VariableInfo));
+
+    buffer_write_u32(buffer, project->calls.count);
+    buffer_write(buffer, project->calls.calls, project->calls.count * sizeof(CallEdge));
+
+    return !buffer->failed;
+}
+
+/**
+ * @brief Reserve room in a project array and bulk-read records into it
+ */
+static bool read_records(ByteReader *reader, void **items, uint32_t *count, uint32_t *capacity, size_t record_size)
+{
+    uint32_t record_count;
+    if (!reader_read_u32(reader, &record_count) ||
+        reader->offset + (size_t)record_count * record_size > reader->size)
+    {
+        return false;
+    }
+
+    if (record_count > *capacity)
+    {
+        void *new_items = realloc(*items, (size_t)record_count * record_size);
+        if (!new_items)
+        {
+            return false;
+        }
+        *items = new_items;
+        *capacity = record_count;
+    }
+
+    reader_read(reader, *items, (size_t)record_count * record_size);
+    *count = record_count;
+    return true;
+}
+
+static bool deserialize_project(const unsigned char *blob, uint32_t blob_size, Project *project)
+{
+    ByteReader reader = {blob, blob_size, 0};
+
+    uint32_t string_count;
+    if (!reader_read_u32(&reader, &string_count) || string_count == 0)
+    {
+        return false;
+    }
+
+    // Strings are re-interned in order so every stored ID stays valid
+    char *str = NULL;
+    bool ok = true;
+    for (uint32_t i = 0; i < string_count && ok; i++)
+    {
+        uint32_t length;
+        ok = reader_read_u32(&reader, &length) && reader.offset + length <= reader.size;
+        if (!ok)
+        {
+            break;
+        }
+
+        char *new_str = (char *)realloc(str, length + 1);
+        if (!new_str)
+        {
+            ok = false;
+            break;
+        }
+        str = new_str;
+        reader_read(&reader, str, length);
+        str[length] = '\0';
+
+        if (i == 0)
+        {
+            if (project_init(project, str, string_count) != CQ_SUCCESS)
+            {
+                memset(project, 0, sizeof(Project));
+                ok = false;
+                break;
+            }
+            ok = project->root_path_id == 0;
+        }
+        else
+        {
+            ok = string_pool_intern(&project->string_pool, str) == i;
+        }
+    }
+    free(str);
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    if (!read_records(&reader, (void **)&project->files.files, &project->files.count,
+                      &project->files.capacity, sizeof(FileInfo)) ||
+        !read_records(&reader, (void **)&project->functions.functions, &project->functions.count,
+                      &project->functions.capacity, sizeof(FunctionInfo)) ||
+        !read_records(&reader, (void **)&project->classes.classes, &project->classes.count,
+                      &project->classes.capacity, sizeof(ClassInfo)))
+    {
+        return false;
+    }
+
+    // Pointers in the raw class records are stale; rebuild the method index arrays
+    for (uint32_t i = 0; i < project->classes.count; i++)
+    {
+        project->classes.classes[i].method_indices = NULL;
+    }
+
+    for (uint32_t i = 0; i < project->classes.count; i++)
+    {
+        ClassInfo *cls = &project->classes.classes[i];
+        uint32_t method_count;
+        if (!reader_read_u32(&reader, &method_count) ||
+            reader.offset + (size_t)method_count * sizeof(uint32_t) > reader.size)
+        {
+            return false;
+        }
+
+        if (method_count > 0)
+        {
+            cls->method_indices = (uint32_t *)malloc(method_count * sizeof(uint32_t));
+            if (!cls->method_indices)
+            {
+                return false;
+            }
+            reader_read(&reader, cls->method_indices, method_count * sizeof(uint32_t));
+        }
+        cls->method_count = method_count;
+    }
+
+    if (!read_records(&reader, (void **)&project->variables.variables, &project->variables.count,
+                      &project->variables.capacity, sizeof(VariableInfo)) ||
+        !read_records(&reader, (void **)&project->calls.calls, &project->calls.count,
+                      &project->calls.capacity, sizeof(CallEdge)))
+    {
+        return false;
+    }
+
+    project->total_functions = project->functions.count;
+    project->total_classes = project->classes.count;
+    project->total_variables = project->variables.count;
+    return true;
+}
+
+static void cache_fill_header(CacheHeader *header, uint32_t variant, uint32_t dependency_count,
+                              uint32_t entry_count)
+{
+    memset(header, 0, sizeof(CacheHeader));
+    header->magic = CACHE_MAGIC;
+    header->format_version = CACHE_FORMAT_VERSION;
+    header->file_info_size = sizeof(FileInfo);
+    header->function_info_size = sizeof(FunctionInfo);
+    header->class_info_size = sizeof(ClassInfo);
+    header->variable_info_size = sizeof(VariableInfo);
+    header->variant = variant;
+    header->dependency_count = dependency_count;
+    header->entry_count = entry_count;
+    strncpy(header->analyzer_version, CQANALYZER_VERSION, sizeof(header->analyzer_version) - 1);
+}
+
+AnalysisCache *analysis_cache_load(const char *cache_path, uint32_t variant)
+{
+    AnalysisCache *cache = calloc(1, sizeof(AnalysisCache));
+    if (!cache)
+    {
+        LOG_ERROR("Memory allocation failed for analysis cache");
+        return NULL;
+    }
+
+    cache->variant = variant;
+    if (!cache_path)
+    {
+        return cache;
+    }
+
+    FILE *file = fopen(cache_path, "rb");
+    if (!file)
+    {
+        LOG_INFO("No analysis cache at %s, starting empty", cache_path);
+        return cache;
+    }
+
+    CacheHeader header;
+    CacheHeader expected;
+    cache_fill_header(&expected, variant, 0, 0);
+    if (fread(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        return cache;
+    }
+    expected.dependency_count = header.dependency_count;
+    expected.entry_count = header.entry_count;
+    if (memcmp(&header, &expected, sizeof(CacheHeader)) != 0)
+    {
+        LOG_INFO("Analysis cache %s was written with other settings, ignoring it", cache_path);
+        fclose(file);
+        return cache;
+    }
+
+    // Dependencies are written once, before the entries that refer to them by index
+    bool ok = true;
+    for (uint32_t i = 0; i < header.dependency_count && ok; i++)
+    {
+        uint32_t path_length;
+        int64_t version[2]; // Modification time and size
+        char path[MAX_PATH_LENGTH];
+        ok = fread(&path_length, sizeof(path_length), 1, file) == 1 && path_length < MAX_PATH_LENGTH &&
+             fread(path, 1, path_length, file) == path_length &&
+             fread(version, sizeof(version), 1, file) == 1;
+        if (ok)
+        {
+            path[path_length] = '\0';
+            ok = cache_intern_dependency(cache, path, version[0], version[1], DEPENDENCY_UNCHECKED) == i;
+        }
+    }
+    if (!ok)
+    {
+        LOG_WARNING("Corrupt analysis cache %s, ignoring it", cache_path);
+        fclose(file);
+        return cache;
+    }
+
+    for (uint32_t i = 0; i < header.entry_count; i++)
+    {
+        uint32_t path_length;
+        AnalysisCacheKey key;
+        uint32_t dependency_count;
+        uint32_t blob_size;
+
+        if (fread(&path_length, sizeof(path_length), 1, file) != 1 || path_length >= MAX_PATH_LENGTH)
+        {
+            break;
+        }
+
+        char *path = malloc(path_length + 1);
+        if (!path || fread(path, 1, path_length, file) != path_length ||
+            fread(&key, sizeof(key), 1, file) != 1 ||
+            fread(&dependency_count, sizeof(dependency_count), 1, file) != 1 ||
+            dependency_count > cache->dependency_count)
+        {
+            free(path);
+            break;
+        }
+        path[path_length] = '\0';
+
+        uint32_t *dependencies = malloc((dependency_count ? dependency_count : 1) * sizeof(uint32_t));
+        bool valid = dependencies && fread(dependencies, sizeof(uint32_t), dependency_count, file) == dependency_count;
+        for (uint32_t j = 0; valid && j < dependency_count; j++)
+        {
+            valid = dependencies[j] < cache->dependency_count;
+        }
+
+        unsigned char *blob = NULL;
+        if (valid && fread(&blob_size, sizeof(blob_size), 1, file) == 1)
+        {
+            blob = malloc(blob_size ? blob_size : 1);
+            if (blob && fread(blob, 1, blob_size, file) != blob_size)
+            {
+                free(blob);
+                blob = NULL;
+            }
+        }
+        if (!blob)
+        {
+            free(dependencies);
+            free(path);
+            break;
+        }
+
+        CacheEntry *entry = cache_find(cache, path) ? NULL : cache_append(cache, path);
+        if (!entry)
+        {
+            free(dependencies);
+            free(blob);
+            free(path);
+            continue;
+        }
+        entry->key = key;
+        entry->blob = blob;
+        entry->blob_size = blob_size;
+        entry->dependencies = dependencies;
+        entry->dependency_count = dependency_count;
+    }
+
+    fclose(file);
+    LOG_INFO("Loaded %u analysis cache entries from %s", cache->count, cache_path);
+    return cache;
+}
+
+CQError analysis_cache_save(AnalysisCache *cache, const char *cache_path)
+{
+    if (!cache || !cache_path)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Write to a temporary file and rename so an interrupted run keeps the old cache
+    char temp_path[MAX_PATH_LENGTH];
+    int ret = snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    if (ret < 0 || ret >= (int)sizeof(temp_path))
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        LOG_WARNING("Could not write analysis cache: %s", temp_path);
+        return CQ_ERROR_FILE_NOT_FOUND;
+    }
+
+    // Only the dependencies of live entries are written, renumbered in order of first use
+    uint32_t *renumbered = malloc((cache->dependency_count ? cache->dependency_count : 1) * sizeof(uint32_t));
+    uint32_t *written = malloc((cache->dependency_count ? cache->dependency_count : 1) * sizeof(uint32_t));
+    if (!renumbered || !written)
+    {
+        free(renumbered);
+        free(written);
+        fclose(file);
+        remove(temp_path);
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    memset(renumbered, 0xFF, cache->dependency_count * sizeof(uint32_t));
+
+    uint32_t live_count = 0;
+    uint32_t written_count = 0;
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        const CacheEntry *entry = &cache->entries[i];
+        if (!entry->live)
+        {
+            continue;
+        }
+        live_count++;
+        for (uint32_t j = 0; j < entry->dependency_count; j++)
+        {
+            uint32_t dependency = entry->dependencies[j];
+            if (renumbered[dependency] == UINT32_MAX)
+            {
+                renumbered[dependency] = written_count;
+                written[written_count++] = dependency;
+            }
+        }
+    }
+
+    CacheHeader header;
+    cache_fill_header(&header, cache->variant, written_count, live_count);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (uint32_t i = 0; i < written_count && ok; i++)
+    {
+        const CacheDependency *dependency = &cache->dependencies[written[i]];
+        uint32_t path_length = (uint32_t)strlen(dependency->path);
+        int64_t version[2] = {dependency->mtime_ns, dependency->size};
+        ok = fwrite(&path_length, sizeof(path_length), 1, file) == 1 &&
+             fwrite(dependency->path, 1, path_length, file) == path_length &&
+             fwrite(version, sizeof(version), 1, file) == 1;
+    }
+
+    for (uint32_t i = 0; i < cache->count && ok; i++)
+    {
+        const CacheEntry *entry = &cache->entries[i];
+        if (!entry->live)
+        {
+            continue;
+        }
+
+        uint32_t path_length = (uint32_t)strlen(entry->path);
+        ok = fwrite(&path_length, sizeof(path_length), 1, file) == 1 &&
+             fwrite(entry->path, 1, path_length, file) == path_length &&
+             fwrite(&entry->key, sizeof(entry->key), 1, file) == 1 &&
+             fwrite(&entry->dependency_count, sizeof(entry->dependency_count), 1, file) == 1;
+        for (uint32_t j = 0; j < entry->dependency_count && ok; j++)
+        {
+            ok = fwrite(&renumbered[entry->dependencies[j]], sizeof(uint32_t), 1, file) == 1;
+        }
+        ok = ok && fwrite(&entry->blob_size, sizeof(entry->blob_size), 1, file) == 1 &&
+             fwrite(entry->blob, 1, entry->blob_size, file) == entry->blob_size;
+    }
+    free(renumbered);
+    free(written);
+
+    if (fclose(file) != 0)
+    {
+        ok = false;
+    }
+
+    if (!ok || rename(temp_path, cache_path) != 0)
+    {
+        LOG_WARNING("Failed to write analysis cache: %s", cache_path);
+        remove(temp_path);
+        return CQ_ERROR_UNKNOWN;
+    }
+
+    LOG_INFO("Saved %u analysis cache entries to %s", live_count, cache_path);
+    return CQ_SUCCESS;
+}
+
+void analysis_cache_destroy(AnalysisCache *cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        free(cache->entries[i].path);
+        free(cache->entries[i].blob);
+        free(cache->entries[i].dependencies);
+    }
+    for (uint32_t i = 0; i < cache->dependency_count; i++)
+    {
+        free(cache->dependencies[i].path);
+    }
+
+    free(cache->entries);
+    free(cache->index);
+    free(cache->dependencies);
+    free(cache->dependency_index);
+    free(cache);
+}
+
+void analysis_cache_key_init(AnalysisCacheKey *key, int64_t mtime_ns, size_t length)
+{
+    if (!key)
+    {
+        return;
+    }
+
+    memset(key, 0, sizeof(AnalysisCacheKey));
+    key->mtime_ns = mtime_ns;
+    key->size = (int64_t)length;
+}
+
+void analysis_cache_key_hash(AnalysisCacheKey *key, const char *contents)
+{
+    if (!key || key->has_hash || (!contents && key->size > 0))
+    {
+        return;
+    }
+
+    key->content_hash = cq_hash_bytes(contents, (size_t)key->size);
+    key->has_hash = true;
+}
+
+Project *analysis_cache_lookup(const AnalysisCache *cache, const char *filepath, AnalysisCacheKey *key,
+                               const char *contents)
+{
+    if (!cache || !filepath || !key)
+    {
+        return NULL;
+    }
+
+    const CacheEntry *entry = cache_find(cache, filepath);
+    if (!entry || entry->key.size != key->size)
+    {
+        return NULL;
+    }
+
+    // A touched but unchanged file still hits through the content hash
+    if (entry->key.mtime_ns != key->mtime_ns)
+    {
+        analysis_cache_key_hash(key, contents);
+        if (!key->has_hash || key->content_hash != entry->key.content_hash)
+        {
+            return NULL;
+        }
+    }
+
+    // Records also come from included files, which must be unchanged too
+    for (uint32_t i = 0; i < entry->dependency_count; i++)
+    {
+        if (!cache_dependency_current(&cache->dependencies[entry->dependencies[i]]))
+        {
+            return NULL;
+        }
+    }
+
+    Project *project = calloc(1, sizeof(Project));
+    if (!project)
+    {
+        return NULL;
+    }
+
+    if (!deserialize_project(entry->blob, entry->blob_size, project))
+    {
+        LOG_WARNING("Corrupt analysis cache entry for %s, reparsing", filepath);
+        if (project->string_pool.strings)
+        {
+            project_destroy(project);
+        }
+        free(project);
+        return NULL;
+    }
+
+    return project;
+}
+
+CQError analysis_cache_store(AnalysisCache *cache, const char *filepath, const AnalysisCacheKey *key,
+                             const Project *project, const AnalysisCacheDependency *dependencies,
+                             uint32_t dependency_count)
+{
+    if (!cache || !filepath || !key || !key->has_hash || !project || (dependency_count > 0 && !dependencies))
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // The versions given were seen by the parse, so they need no check this run
+    uint32_t *entry_dependencies = malloc((dependency_count ? dependency_count : 1) * sizeof(uint32_t));
+    if (!entry_dependencies)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    for (uint32_t i = 0; i < dependency_count; i++)
+    {
+        entry_dependencies[i] = cache_intern_dependency(cache, dependencies[i].path, dependencies[i].mtime_ns,
+                                                        dependencies[i].size, DEPENDENCY_CURRENT);
+        if (entry_dependencies[i] == UINT32_MAX)
+        {
+            free(entry_dependencies);
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    ByteBuffer buffer = {0};
+    if (!serialize_project(project, &buffer))
+    {
+        free(buffer.data);
+        free(entry_dependencies);
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    CacheEntry *entry = cache_find(cache, filepath);
+    if (!entry)
+    {
+        char *path = strdup(filepath);
+        entry = path ? cache_append(cache, path) : NULL;
+        if (!entry)
+        {
+            free(path);
+            free(buffer.data);
+            free(entry_dependencies);
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    free(entry->blob);
+    entry->blob = buffer.data;
+    entry->blob_size = (uint32_t)buffer.size;
+    free(entry->dependencies);
+    entry->dependencies = entry_dependencies;
+    entry->dependency_count = dependency_count;
+    entry->key = *key;
+    entry->live = true;
+    return CQ_SUCCESS;
+}
+
+CQError analysis_cache_retain(AnalysisCache *cache, const char *filepath, const AnalysisCacheKey *key)
+{
+    if (!cache || !filepath)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    CacheEntry *entry = cache_find(cache, filepath);
+    if (!entry)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (key)
+    {
+        entry->key.mtime_ns = key->mtime_ns;
+        entry->key.size = key->size;
+    }
+    entry->live = true;
+    return CQ_SUCCESS;
+}
@@ -1,11 +1,78 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "data/ast_types.h"
+#include "utils/hash.h"
 #include "utils/logger.h"
 
 // String Pool Implementation
+
+// Bytes of string characters per arena block
+#define STRING_POOL_BLOCK_SIZE (16 * 1024)
+
+// Marks an empty lookup slot
+#define STRING_POOL_EMPTY_SLOT UINT32_MAX
+
+// Lookup shards of a concurrent pool (a power of two)
+#define STRING_POOL_SHARD_COUNT 16
+
+// Marks an empty slot of a shard table
+#define STRING_POOL_EMPTY_ENTRY UINT64_MAX
+
+/**
+ * @brief Lookup table of a shard, replaced as a whole when it grows
+ *
+ * Each slot packs the hash (high half) and the string ID (low half) so it
+ * is published with a single atomic store.
+ */
+typedef struct StringPoolTable
+{
+    struct StringPoolTable *retired_next; // Older tables, kept for lock-free readers
+    uint32_t slot_count;
+    _Atomic uint64_t slots[];
+} StringPoolTable;
+
+/**
+ * @brief One lock stripe of a concurrent pool
+ */
+typedef struct
+{
+    _Alignas(64) pthread_mutex_t mutex;   // Guards inserts; lookups take no lock
+    _Atomic(StringPoolTable *) table;
+    StringPoolTable *retired;             // Replaced tables, freed with the pool
+    uint32_t count;                       // Strings in this shard
+    MemoryArena arena;                    // Characters of this shard's strings
+} StringPoolShard;
+
+/**
+ * @brief Replaced ID array of a concurrent pool
+ */
+typedef struct RetiredStrings
+{
+    struct RetiredStrings *next;
+    const char **strings;
+} RetiredStrings;
+
+struct StringPoolSync
+{
+    StringPoolShard shards[STRING_POOL_SHARD_COUNT];
+    pthread_mutex_t id_mutex;             // Serializes ID assignment and growth of pool->strings
+    _Atomic(const char **) strings;       // Current pool->strings, for lock-free readers
+    _Atomic uint32_t count;               // Current pool->count, for lock-free readers
+    RetiredStrings *retired;              // Replaced ID arrays, freed with the pool
+};
+
+static uint32_t string_pool_hash(const char *str, size_t *length)
+{
+    *length = strlen(str);
+    return (uint32_t)cq_hash_bytes(str, *length);
+}
+
 CQError string_pool_init(StringPool *pool, uint32_t initial_capacity)
 {
     if (!pool || initial_capacity == 0)
@@ -13,28 +80,39 @@ CQError string_pool_init(StringPool *pool, uint32_t initial_capacity)
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    pool->strings = (char **)malloc(initial_capacity * sizeof(char *));
-    pool->hashes = (uint32_t *)malloc(initial_capacity * sizeof(uint32_t));
-    pool->hash_table = (uint32_t *)malloc(initial_capacity * sizeof(uint32_t));
+    // Room for the initial capacity below the load limit
+    uint32_t slot_count = 16;
+    while (slot_count < initial_capacity + initial_capacity / 3 + 1 && slot_count < (1u << 31))
+    {
+        slot_count *= 2;
+    }
+
+    pool->strings = (const char **)malloc(initial_capacity * sizeof(char *));
+    pool->slots = (StringPoolSlot *)malloc(slot_count * sizeof(StringPoolSlot));
 
-    if (!pool->strings || !pool->hashes || !pool->hash_table)
+    if (!pool->strings || !pool->slots)
     {
         free(pool->strings);
-        free(pool->hashes);
-        free(pool->hash_table);
+        free(pool->slots);
+        pool->strings = NULL;
+        pool->slots = NULL;
         return CQ_ERROR_MEMORY_ALLOCATION;
     }
 
     pool->count = 0;
     pool->capacity = initial_capacity;
-    pool->hash_table_size = initial_capacity;
+    pool->slot_count = slot_count;
+    pool->sync = NULL;
+    memory_arena_init(&pool->arena, STRING_POOL_BLOCK_SIZE);
 
-    // Initialize hash table to invalid values
-    memset(pool->hash_table, 0xFF, initial_capacity * sizeof(uint32_t));
+    // Initialize lookup table to empty slots
+    memset(pool->slots, 0xFF, slot_count * sizeof(StringPoolSlot));
 
     return CQ_SUCCESS;
 }
 
+static void string_pool_sync_free(StringPoolSync *sync);
+
 void string_pool_destroy(StringPool *pool)
 {
     if (!pool)
@@ -42,50 +120,81 @@ void string_pool_destroy(StringPool *pool)
         return;
     }
 
-    for (uint32_t i = 0; i < pool->count; i++)
-    {
-        free(pool->strings[i]);
-    }
-
+    string_pool_sync_free(pool->sync);
+    pool->sync = NULL;
+    memory_arena_destroy(&pool->arena);
     free(pool->strings);
-    free(pool->hashes);
-    free(pool->hash_table);
+    free(pool->slots);
 
     pool->strings = NULL;
-    pool->hashes = NULL;
-    pool->hash_table = NULL;
+    pool->slots = NULL;
     pool->count = 0;
     pool->capacity = 0;
-    pool->hash_table_size = 0;
+    pool->slot_count = 0;
 }
 
-uint32_t string_pool_intern(StringPool *pool, const char *str)
+/**
+ * @brief Rebuild the lookup table with a new size from the stored hashes
+ */
+static CQError string_pool_rehash(StringPool *pool, uint32_t new_size)
 {
-    if (!pool || !str)
+    StringPoolSlot *new_slots = (StringPoolSlot *)malloc(new_size * sizeof(StringPoolSlot));
+    if (!new_slots)
     {
-        return 0;
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(new_slots, 0xFF, new_size * sizeof(StringPoolSlot));
+    for (uint32_t i = 0; i < pool->slot_count; i++)
+    {
+        StringPoolSlot slot = pool->slots[i];
+        if (slot.id == STRING_POOL_EMPTY_SLOT)
+        {
+            continue;
+        }
+
+        uint32_t bucket = slot.hash & (new_size - 1);
+        while (new_slots[bucket].id != STRING_POOL_EMPTY_SLOT)
+        {
+            bucket = (bucket + 1) & (new_size - 1);
+        }
+        new_slots[bucket] = slot;
     }
 
-    // Simple hash function
-    uint32_t hash = 0;
-    for (const char *c = str; *c; c++)
+    free(pool->slots);
+    pool->slots = new_slots;
+    pool->slot_count = new_size;
+    return CQ_SUCCESS;
+}
+
+static uint32_t string_pool_intern_concurrent(StringPool *pool, const char *str);
+
+uint32_t string_pool_intern(StringPool *pool, const char *str)
+{
+    if (pool && pool->sync && str)
+    {
+        return string_pool_intern_concurrent(pool, str);
+    }
+    if (!pool || !str || !pool->slots)
     {
-        hash = hash * 31 + *c;
+        return 0;
     }
 
-    // Check if string already exists
-    uint32_t bucket = hash % pool->hash_table_size;
-    uint32_t index = pool->hash_table[bucket];
+    size_t length;
+    uint32_t hash = string_pool_hash(str, &length);
 
-    while (index != 0xFFFFFFFF)
+    // Check if string already exists; most probes are settled by the hash alone
+    uint32_t mask = pool->slot_count - 1;
+    uint32_t bucket = hash & mask;
+    while (pool->slots[bucket].id != STRING_POOL_EMPTY_SLOT)
     {
-        if (pool->hashes[index] == hash && strcmp(pool->strings[index], str) == 0)
+        const StringPoolSlot *slot = &pool->slots[bucket];
+        if (slot->hash == hash && strcmp(pool->strings[slot->id], str) == 0)
         {
-            return index;
+            return slot->id;
         }
         // Linear probing
-        bucket = (bucket + 1) % pool->hash_table_size;
-        index = pool->hash_table[bucket];
+        bucket = (bucket + 1) & mask;
     }
 
     // String not found, add it
@@ -93,38 +202,57 @@ uint32_t string_pool_intern(StringPool *pool, const char *str)
     {
         // Expand capacity
         uint32_t new_capacity = pool->capacity * 2;
-        char **new_strings = (char **)realloc(pool->strings, new_capacity * sizeof(char *));
-        uint32_t *new_hashes = (uint32_t *)realloc(pool->hashes, new_capacity * sizeof(uint32_t));
-
-        if (!new_strings || !new_hashes)
+        const char **new_strings = (const char **)realloc(pool->strings, new_capacity * sizeof(char *));
+        if (!new_strings)
         {
-            free(new_strings);
-            free(new_hashes);
             return 0;
         }
 
         pool->strings = new_strings;
-        pool->hashes = new_hashes;
         pool->capacity = new_capacity;
     }
 
-    // Add string
-    pool->strings[pool->count] = strdup(str);
-    pool->hashes[pool->count] = hash;
+    char *copy = memory_arena_strndup(&pool->arena, str, length);
+    if (!copy)
+    {
+        return 0;
+    }
 
-    // Add to hash table
-    bucket = hash % pool->hash_table_size;
-    while (pool->hash_table[bucket] != 0xFFFFFFFF)
+    // Keep the lookup table at most three quarters full so probe sequences stay short
+    if ((uint64_t)(pool->count + 1) * 4 > (uint64_t)pool->slot_count * 3)
     {
-        bucket = (bucket + 1) % pool->hash_table_size;
+        if (string_pool_rehash(pool, pool->slot_count * 2) != CQ_SUCCESS)
+        {
+            return 0;
+        }
+        mask = pool->slot_count - 1;
+        bucket = hash & mask;
+        while (pool->slots[bucket].id != STRING_POOL_EMPTY_SLOT)
+        {
+            bucket = (bucket + 1) & mask;
+        }
     }
-    pool->hash_table[bucket] = pool->count;
+
+    // Add string
+    pool->strings[pool->count] = copy;
+    pool->slots[bucket].hash = hash;
+    pool->slots[bucket].id = pool->count;
 
     return pool->count++;
 }
 
 const char *string_pool_get(const StringPool *pool, uint32_t id)
 {
+    if (pool && pool->sync)
+    {
+        // An ID is counted only once its string is stored
+        if (id >= atomic_load_explicit(&pool->sync->count, memory_order_acquire))
+        {
+            return NULL;
+        }
+        return atomic_load_explicit(&pool->sync->strings, memory_order_acquire)[id];
+    }
+
     if (!pool || id >= pool->count)
     {
         return NULL;
@@ -133,6 +261,320 @@ const char *string_pool_get(const StringPool *pool, uint32_t id)
     return pool->strings[id];
 }
 
+static StringPoolTable *string_pool_table_create(uint32_t slot_count)
+{
+    StringPoolTable *table = malloc(sizeof(StringPoolTable) + slot_count * sizeof(_Atomic uint64_t));
+    if (!table)
+    {
+        return NULL;
+    }
+
+    table->retired_next = NULL;
+    table->slot_count = slot_count;
+    for (uint32_t i = 0; i < slot_count; i++)
+    {
+        atomic_init(&table->slots[i], STRING_POOL_EMPTY_ENTRY);
+    }
+    return table;
+}
+
+/**
+ * @brief Store an entry in a table that has room; caller holds the shard mutex
+ */
+static void string_pool_table_insert(StringPoolTable *table, uint32_t hash, uint32_t id)
+{
+    uint32_t mask = table->slot_count - 1;
+    uint32_t bucket = hash & mask;
+    while (atomic_load_explicit(&table->slots[bucket], memory_order_relaxed) != STRING_POOL_EMPTY_ENTRY)
+    {
+        bucket = (bucket + 1) & mask;
+    }
+    atomic_store_explicit(&table->slots[bucket], ((uint64_t)hash << 32) | id, memory_order_release);
+}
+
+/**
+ * @brief Find an interned string in a shard table without locking
+ *
+ * A table replaced by a concurrent insert may miss strings added since;
+ * callers then search again under the shard mutex.
+ */
+static bool string_pool_table_find(StringPoolSync *sync, StringPoolTable *table, uint32_t hash,
+                                   const char *str, uint32_t *id)
+{
+    uint32_t mask = table->slot_count - 1;
+    for (uint32_t bucket = hash & mask;; bucket = (bucket + 1) & mask)
+    {
+        uint64_t entry = atomic_load_explicit(&table->slots[bucket], memory_order_acquire);
+        if (entry == STRING_POOL_EMPTY_ENTRY)
+        {
+            return false;
+        }
+        if ((uint32_t)(entry >> 32) == hash)
+        {
+            // The entry was published after its string, so the ID array already holds it
+            const char **strings = atomic_load_explicit(&sync->strings, memory_order_acquire);
+            if (strcmp(strings[(uint32_t)entry], str) == 0)
+            {
+                *id = (uint32_t)entry;
+                return true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Give a stored string the next ID; caller holds a shard mutex
+ *
+ * @return The new ID, or STRING_POOL_EMPTY_SLOT on failure
+ */
+static uint32_t string_pool_assign_id(StringPool *pool, const char *copy)
+{
+    StringPoolSync *sync = pool->sync;
+    pthread_mutex_lock(&sync->id_mutex);
+
+    uint32_t id = pool->count;
+    if (id >= pool->capacity)
+    {
+        // Readers may still index the old array, so it is retired rather than freed
+        uint32_t new_capacity = pool->capacity * 2;
+        const char **new_strings = (const char **)malloc(new_capacity * sizeof(char *));
+        RetiredStrings *retired = (RetiredStrings *)malloc(sizeof(RetiredStrings));
+        if (!new_strings || !retired)
+        {
+            free(new_strings);
+            free(retired);
+            pthread_mutex_unlock(&sync->id_mutex);
+            return STRING_POOL_EMPTY_SLOT;
+        }
+
+        memcpy(new_strings, pool->strings, pool->count * sizeof(char *));
+        retired->strings = pool->strings;
+        retired->next = sync->retired;
+        sync->retired = retired;
+        pool->strings = new_strings;
+        pool->capacity = new_capacity;
+        atomic_store_explicit(&sync->strings, new_strings, memory_order_release);
+    }
+
+    pool->strings[id] = copy;
+    pool->count = id + 1;
+    atomic_store_explicit(&sync->count, id + 1, memory_order_release);
+
+    pthread_mutex_unlock(&sync->id_mutex);
+    return id;
+}
+
+/**
+ * @brief Shard of a hash; uses other bits than the table index
+ */
+static StringPoolShard *string_pool_shard(StringPoolSync *sync, uint32_t hash)
+{
+    return &sync->shards[(hash * 0x9E3779B1u) >> 28 & (STRING_POOL_SHARD_COUNT - 1)];
+}
+
+static uint32_t string_pool_intern_concurrent(StringPool *pool, const char *str)
+{
+    StringPoolSync *sync = pool->sync;
+    size_t length;
+    uint32_t hash = string_pool_hash(str, &length);
+    StringPoolShard *shard = string_pool_shard(sync, hash);
+
+    // Strings that are already interned are found without locking
+    uint32_t id;
+    StringPoolTable *table = atomic_load_explicit(&shard->table, memory_order_acquire);
+    if (string_pool_table_find(sync, table, hash, str, &id))
+    {
+        return id;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+
+    // Another thread may have added it, or replaced the table, since
+    table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    if (string_pool_table_find(sync, table, hash, str, &id))
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        return id;
+    }
+
+    // Keep the table at most three quarters full, as in the single-threaded mode
+    if ((uint64_t)(shard->count + 1) * 4 > (uint64_t)table->slot_count * 3)
+    {
+        StringPoolTable *grown = string_pool_table_create(table->slot_count * 2);
+        if (!grown)
+        {
+            pthread_mutex_unlock(&shard->mutex);
+            return 0;
+        }
+        for (uint32_t i = 0; i < table->slot_count; i++)
+        {
+            uint64_t entry = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+            if (entry != STRING_POOL_EMPTY_ENTRY)
+            {
+                string_pool_table_insert(grown, (uint32_t)(entry >> 32), (uint32_t)entry);
+            }
+        }
+        table->retired_next = shard->retired;
+        shard->retired = table;
+        atomic_store_explicit(&shard->table, grown, memory_order_release);
+        table = grown;
+    }
+
+    char *copy = memory_arena_strndup(&shard->arena, str, length);
+    id = copy ? string_pool_assign_id(pool, copy) : STRING_POOL_EMPTY_SLOT;
+    if (id == STRING_POOL_EMPTY_SLOT)
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        return 0;
+    }
+
+    string_pool_table_insert(table, hash, id);
+    shard->count++;
+
+    pthread_mutex_unlock(&shard->mutex);
+    return id;
+}
+
+bool string_pool_find(const StringPool *pool, const char *str, uint32_t *id)
+{
+    if (!pool || !str || !id)
+    {
+        return false;
+    }
+
+    size_t length;
+    uint32_t hash = string_pool_hash(str, &length);
+    if (pool->sync)
+    {
+        StringPoolShard *shard = string_pool_shard(pool->sync, hash);
+        return string_pool_table_find(pool->sync, atomic_load_explicit(&shard->table, memory_order_acquire), hash,
+                                      str, id);
+    }
+    if (!pool->slots)
+    {
+        return false;
+    }
+
+    uint32_t mask = pool->slot_count - 1;
+    for (uint32_t bucket = hash & mask; pool->slots[bucket].id != STRING_POOL_EMPTY_SLOT;
+         bucket = (bucket + 1) & mask)
+    {
+        const StringPoolSlot *slot = &pool->slots[bucket];
+        if (slot->hash == hash && strcmp(pool->strings[slot->id], str) == 0)
+        {
+            *id = slot->id;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void string_pool_sync_free(StringPoolSync *sync)
+{
+    if (!sync)
+    {
+        return;
+    }
+
+    for (int i = 0; i < STRING_POOL_SHARD_COUNT; i++)
+    {
+        StringPoolShard *shard = &sync->shards[i];
+        free(atomic_load_explicit(&shard->table, memory_order_relaxed));
+        while (shard->retired)
+        {
+            StringPoolTable *next = shard->retired->retired_next;
+            free(shard->retired);
+            shard->retired = next;
+        }
+        memory_arena_destroy(&shard->arena);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+
+    while (sync->retired)
+    {
+        RetiredStrings *next = sync->retired->next;
+        free(sync->retired->strings);
+        free(sync->retired);
+        sync->retired = next;
+    }
+
+    pthread_mutex_destroy(&sync->id_mutex);
+    free(sync);
+}
+
+CQError string_pool_enable_concurrent(StringPool *pool)
+{
+    if (!pool || !pool->slots)
+    {
+        return pool && pool->sync ? CQ_SUCCESS : CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    StringPoolSync *sync = aligned_alloc(_Alignof(StringPoolSync), sizeof(StringPoolSync));
+    if (!sync)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    memset(sync, 0, sizeof(StringPoolSync));
+
+    // Size the shard tables for the strings already interned
+    uint32_t slot_count = 64;
+    while ((uint64_t)slot_count * 3 * STRING_POOL_SHARD_COUNT < (uint64_t)pool->count * 4 * 2)
+    {
+        slot_count *= 2;
+    }
+
+    if (pthread_mutex_init(&sync->id_mutex, NULL) != 0)
+    {
+        free(sync);
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    int initialized = 0;
+    for (; initialized < STRING_POOL_SHARD_COUNT; initialized++)
+    {
+        StringPoolShard *shard = &sync->shards[initialized];
+        StringPoolTable *table = string_pool_table_create(slot_count);
+        if (!table || pthread_mutex_init(&shard->mutex, NULL) != 0)
+        {
+            free(table);
+            break;
+        }
+        atomic_init(&shard->table, table);
+        memory_arena_init(&shard->arena, STRING_POOL_BLOCK_SIZE);
+    }
+    if (initialized < STRING_POOL_SHARD_COUNT)
+    {
+        for (int i = 0; i < initialized; i++)
+        {
+            free(atomic_load_explicit(&sync->shards[i].table, memory_order_relaxed));
+            pthread_mutex_destroy(&sync->shards[i].mutex);
+        }
+        pthread_mutex_destroy(&sync->id_mutex);
+        free(sync);
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Existing strings keep their IDs and stay in the pool's own arena
+    for (uint32_t i = 0; i < pool->slot_count; i++)
+    {
+        StringPoolSlot slot = pool->slots[i];
+        if (slot.id != STRING_POOL_EMPTY_SLOT)
+        {
+            StringPoolShard *shard = string_pool_shard(sync, slot.hash);
+            string_pool_table_insert(atomic_load_explicit(&shard->table, memory_order_relaxed), slot.hash, slot.id);
+            shard->count++;
+        }
+    }
+    atomic_init(&sync->strings, pool->strings);
+    atomic_init(&sync->count, pool->count);
+
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->slot_count = 0;
+    pool->sync = sync;
+    return CQ_SUCCESS;
+}
+
 // Symbol Table Implementation
 CQError symbol_table_init(SymbolTable *table, uint32_t initial_capacity)
 {
@@ -304,6 +746,104 @@ FunctionInfo *function_array_get(FunctionArray *array, uint32_t index)
     return &array->functions[index];
 }
 
+// Function Columns Implementation
+
+// Columns start on cache-line boundaries: 16 values of 4 bytes
+#define FUNCTION_COLUMN_ALIGNMENT 64
+#define FUNCTION_COLUMN_GRANULE (FUNCTION_COLUMN_ALIGNMENT / sizeof(uint32_t))
+
+CQError function_columns_build(FunctionColumns *columns, const FunctionArray *array)
+{
+    if (!columns || !array)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (!columns->columns[0] || columns->capacity < array->count)
+    {
+        // One block holds all columns, each padded to a whole number of cache lines
+        uint32_t capacity = (uint32_t)((array->count + FUNCTION_COLUMN_GRANULE - 1) / FUNCTION_COLUMN_GRANULE *
+                                       FUNCTION_COLUMN_GRANULE);
+        capacity = capacity > 0 ? capacity : FUNCTION_COLUMN_GRANULE;
+        uint32_t *block = (uint32_t *)aligned_alloc(FUNCTION_COLUMN_ALIGNMENT,
+                                                    (size_t)capacity * FUNCTION_METRIC_COUNT * sizeof(uint32_t));
+        free(columns->columns[0]);
+        memset(columns, 0, sizeof(*columns));
+        if (!block)
+        {
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+
+        for (int metric = 0; metric < FUNCTION_METRIC_COUNT; metric++)
+        {
+            columns->columns[metric] = block + (size_t)metric * capacity;
+        }
+        columns->capacity = capacity;
+    }
+
+    uint32_t *complexity = columns->columns[FUNCTION_METRIC_COMPLEXITY];
+    uint32_t *nesting_depth = columns->columns[FUNCTION_METRIC_NESTING_DEPTH];
+    uint32_t *lines_of_code = columns->columns[FUNCTION_METRIC_LINES_OF_CODE];
+    uint32_t *parameter_count = columns->columns[FUNCTION_METRIC_PARAMETER_COUNT];
+    for (uint32_t i = 0; i < array->count; i++)
+    {
+        const FunctionInfo *func = &array->functions[i];
+        complexity[i] = func->complexity;
+        nesting_depth[i] = func->nesting_depth;
+        lines_of_code[i] = func->lines_of_code;
+        parameter_count[i] = func->parameter_count;
+    }
+    columns->count = array->count;
+
+    return CQ_SUCCESS;
+}
+
+void function_columns_destroy(FunctionColumns *columns)
+{
+    if (!columns)
+    {
+        return;
+    }
+
+    free(columns->columns[0]);
+    memset(columns, 0, sizeof(*columns));
+}
+
+uint32_t function_columns_select_above(const FunctionColumns *columns, FunctionMetric metric, uint32_t threshold,
+                                       uint32_t *indices)
+{
+    if (!columns || !indices || metric < 0 || metric >= FUNCTION_METRIC_COUNT || !columns->columns[metric])
+    {
+        return 0;
+    }
+
+    // Every index is written and kept only if it matches, so the loop has no branch to mispredict
+    const uint32_t *values = columns->columns[metric];
+    uint32_t selected = 0;
+    for (uint32_t i = 0; i < columns->count; i++)
+    {
+        indices[selected] = i;
+        selected += values[i] > threshold;
+    }
+    return selected;
+}
+
+uint64_t function_columns_sum(const FunctionColumns *columns, FunctionMetric metric)
+{
+    if (!columns || metric < 0 || metric >= FUNCTION_METRIC_COUNT || !columns->columns[metric])
+    {
+        return 0;
+    }
+
+    const uint32_t *values = columns->columns[metric];
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < columns->count; i++)
+    {
+        sum += values[i];
+    }
+    return sum;
+}
+
 // Class Array Implementation
 CQError class_array_init(ClassArray *array, uint32_t initial_capacity)
 {
@@ -464,16 +1004,16 @@ VariableInfo *variable_array_get(VariableArray *array, uint32_t index)
     return &array->variables[index];
 }
 
-// File Array Implementation
-CQError file_array_init(FileArray *array, uint32_t initial_capacity)
+// Call Edge Array Implementation
+CQError call_edge_array_init(CallEdgeArray *array, uint32_t initial_capacity)
 {
     if (!array || initial_capacity == 0)
     {
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    array->files = (FileInfo *)malloc(initial_capacity * sizeof(FileInfo));
-    if (!array->files)
+    array->calls = (CallEdge *)malloc(initial_capacity * sizeof(CallEdge));
+    if (!array->calls)
     {
         return CQ_ERROR_MEMORY_ALLOCATION;
     }
@@ -484,22 +1024,22 @@ CQError file_array_init(FileArray *array, uint32_t initial_capacity)
     return CQ_SUCCESS;
 }
 
-void file_array_destroy(FileArray *array)
+void call_edge_array_destroy(CallEdgeArray *array)
 {
     if (!array)
     {
         return;
     }
 
-    free(array->files);
-    array->files = NULL;
+    free(array->calls);
+    array->calls = NULL;
     array->count = 0;
     array->capacity = 0;
 }
 
-CQError file_array_add(FileArray *array, const FileInfo *file)
+CQError call_edge_array_add(CallEdgeArray *array, const CallEdge *call)
 {
-    if (!array || !file)
+    if (!array || !call)
     {
         return CQ_ERROR_INVALID_ARGUMENT;
     }
@@ -508,35 +1048,106 @@ CQError file_array_add(FileArray *array, const FileInfo *file)
     {
         // Expand capacity
         uint32_t new_capacity = array->capacity * 2;
-        FileInfo *new_files = (FileInfo *)realloc(array->files, new_capacity * sizeof(FileInfo));
+        CallEdge *new_calls = (CallEdge *)realloc(array->calls, new_capacity * sizeof(CallEdge));
 
-        if (!new_files)
+        if (!new_calls)
         {
             return CQ_ERROR_MEMORY_ALLOCATION;
         }
 
-        array->files = new_files;
+        array->calls = new_calls;
         array->capacity = new_capacity;
     }
 
-    array->files[array->count] = *file;
+    array->calls[array->count] = *call;
     array->count++;
 
     return CQ_SUCCESS;
 }
 
-FileInfo *file_array_get(FileArray *array, uint32_t index)
+CallEdge *call_edge_array_get(CallEdgeArray *array, uint32_t index)
 {
     if (!array || index >= array->count)
     {
         return NULL;
     }
 
-    return &array->files[index];
+    return &array->calls[index];
 }
 
-// Project Implementation
-CQError project_init(Project *project, const char *root_path, uint32_t initial_capacity)
+// File Array Implementation
+CQError file_array_init(FileArray *array, uint32_t initial_capacity)
+{
+    if (!array || initial_capacity == 0)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    array->files = (FileInfo *)malloc(initial_capacity * sizeof(FileInfo));
+    if (!array->files)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    array->count = 0;
+    array->capacity = initial_capacity;
+
+    return CQ_SUCCESS;
+}
+
+void file_array_destroy(FileArray *array)
+{
+    if (!array)
+    {
+        return;
+    }
+
+    free(array->files);
+    array->files = NULL;
+    array->count = 0;
+    array->capacity = 0;
+}
+
+CQError file_array_add(FileArray *array, const FileInfo *file)
+{
+    if (!array || !file)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (array->count >= array->capacity)
+    {
+        // Expand capacity
+        uint32_t new_capacity = array->capacity * 2;
+        FileInfo *new_files = (FileInfo *)realloc(array->files, new_capacity * sizeof(FileInfo));
+
+        if (!new_files)
+        {
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+
+        array->files = new_files;
+        array->capacity = new_capacity;
+    }
+
+    array->files[array->count] = *file;
+    array->count++;
+
+    return CQ_SUCCESS;
+}
+
+FileInfo *file_array_get(FileArray *array, uint32_t index)
+{
+    if (!array || index >= array->count)
+    {
+        return NULL;
+    }
+
+    return &array->files[index];
+}
+
+// Project Implementation
+CQError project_init(Project *project, const char *root_path, uint32_t initial_capacity)
 {
     if (!project || !root_path || initial_capacity == 0)
     {
@@ -575,9 +1186,20 @@ CQError project_init(Project *project, const char *root_path, uint32_t initial_c
         return result;
     }
 
+    result = call_edge_array_init(&project->calls, initial_capacity);
+    if (result != CQ_SUCCESS)
+    {
+        variable_array_destroy(&project->variables);
+        class_array_destroy(&project->classes);
+        function_array_destroy(&project->functions);
+        string_pool_destroy(&project->string_pool);
+        return result;
+    }
+
     result = file_array_init(&project->files, initial_capacity);
     if (result != CQ_SUCCESS)
     {
+        call_edge_array_destroy(&project->calls);
         variable_array_destroy(&project->variables);
         class_array_destroy(&project->classes);
         function_array_destroy(&project->functions);
@@ -590,6 +1212,7 @@ CQError project_init(Project *project, const char *root_path, uint32_t initial_c
     if (result != CQ_SUCCESS)
     {
         file_array_destroy(&project->files);
+        call_edge_array_destroy(&project->calls);
         variable_array_destroy(&project->variables);
         class_array_destroy(&project->classes);
         function_array_destroy(&project->functions);
@@ -625,6 +1248,7 @@ void project_destroy(Project *project)
 
     symbol_table_destroy(&project->symbol_table);
     file_array_destroy(&project->files);
+    call_edge_array_destroy(&project->calls);
     variable_array_destroy(&project->variables);
     class_array_destroy(&project->classes);
     function_array_destroy(&project->functions);
@@ -661,6 +1285,21 @@ CQError project_add_file(Project *project, const char *filepath, SupportedLangua
     return result;
 }
 
+/**
+ * @brief Get the file that entities added now belong to
+ *
+ * Entities are attributed to the most recently added file, whose ranges
+ * start at the array counts recorded by project_add_file().
+ */
+static FileInfo *project_current_file(Project *project)
+{
+    if (project->files.count == 0)
+    {
+        return NULL;
+    }
+    return &project->files.files[project->files.count - 1];
+}
+
 CQError project_add_function(Project *project, const FunctionInfo *func, uint32_t *func_id)
 {
     if (!project || !func)
@@ -672,6 +1311,13 @@ CQError project_add_function(Project *project, const FunctionInfo *func, uint32_
     if (result == CQ_SUCCESS)
     {
         project->total_functions++;
+
+        FileInfo *file = project_current_file(project);
+        if (file && file->function_start + file->function_count == project->functions.count - 1)
+        {
+            file->function_count++;
+        }
+
         if (func_id)
         {
             *func_id = project->functions.count - 1;
@@ -692,6 +1338,13 @@ CQError project_add_class(Project *project, const ClassInfo *cls, uint32_t *clas
     if (result == CQ_SUCCESS)
     {
         project->total_classes++;
+
+        FileInfo *file = project_current_file(project);
+        if (file && file->class_start + file->class_count == project->classes.count - 1)
+        {
+            file->class_count++;
+        }
+
         if (class_id)
         {
             *class_id = project->classes.count - 1;
@@ -712,6 +1365,13 @@ CQError project_add_variable(Project *project, const VariableInfo *var, uint32_t
     if (result == CQ_SUCCESS)
     {
         project->total_variables++;
+
+        FileInfo *file = project_current_file(project);
+        if (file && file->variable_start + file->variable_count == project->variables.count - 1)
+        {
+            file->variable_count++;
+        }
+
         if (var_id)
         {
             *var_id = project->variables.count - 1;
@@ -721,6 +1381,521 @@ CQError project_add_variable(Project *project, const VariableInfo *var, uint32_t
     return result;
 }
 
+/**
+ * @brief Grow a dynamic array so it can hold at least `needed` elements
+ */
+static CQError array_reserve(void **items, uint32_t *capacity, uint32_t needed, size_t element_size)
+{
+    if (needed <= *capacity)
+    {
+        return CQ_SUCCESS;
+    }
+
+    uint32_t new_capacity = *capacity > 0 ? *capacity : 1;
+    while (new_capacity < needed)
+    {
+        new_capacity *= 2;
+    }
+
+    void *new_items = realloc(*items, (size_t)new_capacity * element_size);
+    if (!new_items)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    *items = new_items;
+    *capacity = new_capacity;
+    return CQ_SUCCESS;
+}
+
+static uint32_t remap_string_id(const uint32_t *string_map, uint32_t count, uint32_t id)
+{
+    return id < count ? string_map[id] : id;
+}
+
+CQError project_intern_strings(Project *dest, const Project *src, uint32_t **string_map)
+{
+    if (!dest || !src || dest == src || !string_map)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Map every source string ID to its ID in the destination pool
+    uint32_t string_count = src->string_pool.count;
+    uint32_t *map = (uint32_t *)malloc((string_count > 0 ? string_count : 1) * sizeof(uint32_t));
+    if (!map)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (uint32_t i = 0; i < string_count; i++)
+    {
+        map[i] = string_pool_intern(&dest->string_pool, src->string_pool.strings[i]);
+    }
+
+    *string_map = map;
+    return CQ_SUCCESS;
+}
+
+CQError project_merge(Project *dest, Project *src, uint32_t *first_file_index)
+{
+    uint32_t *string_map = NULL;
+    CQError result = project_intern_strings(dest, src, &string_map);
+    if (result == CQ_SUCCESS)
+    {
+        result = project_merge_mapped(dest, src, string_map, first_file_index);
+    }
+
+    free(string_map);
+    return result;
+}
+
+CQError project_merge_mapped(Project *dest, Project *src, const uint32_t *string_map, uint32_t *first_file_index)
+{
+    if (!dest || !src || dest == src || !string_map)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Reserve everything up front so a failure leaves dest unchanged
+    CQError result = array_reserve((void **)&dest->functions.functions, &dest->functions.capacity,
+                                   dest->functions.count + src->functions.count, sizeof(FunctionInfo));
+    if (result == CQ_SUCCESS)
+    {
+        result = array_reserve((void **)&dest->classes.classes, &dest->classes.capacity,
+                               dest->classes.count + src->classes.count, sizeof(ClassInfo));
+    }
+    if (result == CQ_SUCCESS)
+    {
+        result = array_reserve((void **)&dest->variables.variables, &dest->variables.capacity,
+                               dest->variables.count + src->variables.count, sizeof(VariableInfo));
+    }
+    if (result == CQ_SUCCESS)
+    {
+        result = array_reserve((void **)&dest->files.files, &dest->files.capacity,
+                               dest->files.count + src->files.count, sizeof(FileInfo));
+    }
+    if (result == CQ_SUCCESS)
+    {
+        result = array_reserve((void **)&dest->calls.calls, &dest->calls.capacity,
+                               dest->calls.count + src->calls.count, sizeof(CallEdge));
+    }
+    if (result == CQ_SUCCESS)
+    {
+        // Both symbol arrays share one capacity, so it is only raised once both have grown
+        uint32_t needed = dest->symbol_table.count + src->symbol_table.count;
+        uint32_t id_capacity = dest->symbol_table.capacity;
+        uint32_t file_capacity = dest->symbol_table.capacity;
+        result = array_reserve((void **)&dest->symbol_table.symbol_ids, &id_capacity, needed, sizeof(uint32_t));
+        if (result == CQ_SUCCESS)
+        {
+            result = array_reserve((void **)&dest->symbol_table.file_indices, &file_capacity, needed,
+                                   sizeof(uint32_t));
+        }
+        if (result == CQ_SUCCESS)
+        {
+            dest->symbol_table.capacity = id_capacity;
+        }
+    }
+    if (result != CQ_SUCCESS)
+    {
+        LOG_ERROR("Failed to reserve project arrays for merge");
+        return result;
+    }
+
+    uint32_t string_count = src->string_pool.count;
+    uint32_t file_base = dest->files.count;
+    uint32_t function_base = dest->functions.count;
+    uint32_t class_base = dest->classes.count;
+    uint32_t variable_base = dest->variables.count;
+
+    // Relocate the arrays with bulk copies, then patch IDs in place
+    FunctionInfo *functions = dest->functions.functions + function_base;
+    memcpy(functions, src->functions.functions, src->functions.count * sizeof(FunctionInfo));
+    for (uint32_t i = 0; i < src->functions.count; i++)
+    {
+        functions[i].name_id = remap_string_id(string_map, string_count, functions[i].name_id);
+        functions[i].return_type_id = remap_string_id(string_map, string_count, functions[i].return_type_id);
+        functions[i].location.file_id += file_base;
+        if (functions[i].class_id != CLASS_ID_NONE)
+        {
+            functions[i].class_id += class_base;
+        }
+    }
+
+    ClassInfo *classes = dest->classes.classes + class_base;
+    memcpy(classes, src->classes.classes, src->classes.count * sizeof(ClassInfo));
+    for (uint32_t i = 0; i < src->classes.count; i++)
+    {
+        classes[i].name_id = remap_string_id(string_map, string_count, classes[i].name_id);
+        classes[i].location.file_id += file_base;
+        classes[i].file_id += file_base;
+        for (uint32_t m = 0; classes[i].method_indices && m < classes[i].method_count; m++)
+        {
+            classes[i].method_indices[m] += function_base;
+        }
+
+        // Ownership of the method index array moves to dest
+        src->classes.classes[i].method_indices = NULL;
+    }
+
+    VariableInfo *variables = dest->variables.variables + variable_base;
+    memcpy(variables, src->variables.variables, src->variables.count * sizeof(VariableInfo));
+    for (uint32_t i = 0; i < src->variables.count; i++)
+    {
+        variables[i].name_id = remap_string_id(string_map, string_count, variables[i].name_id);
+        variables[i].type_id = remap_string_id(string_map, string_count, variables[i].type_id);
+        variables[i].location.file_id += file_base;
+    }
+
+    CallEdge *calls = dest->calls.calls + dest->calls.count;
+    memcpy(calls, src->calls.calls, src->calls.count * sizeof(CallEdge));
+    for (uint32_t i = 0; i < src->calls.count; i++)
+    {
+        calls[i].caller_index += function_base;
+        calls[i].callee_name_id = remap_string_id(string_map, string_count, calls[i].callee_name_id);
+    }
+
+    FileInfo *files = dest->files.files + file_base;
+    memcpy(files, src->files.files, src->files.count * sizeof(FileInfo));
+    for (uint32_t i = 0; i < src->files.count; i++)
+    {
+        files[i].filepath_id = remap_string_id(string_map, string_count, files[i].filepath_id);
+        files[i].function_start += function_base;
+        files[i].class_start += class_base;
+        files[i].variable_start += variable_base;
+    }
+
+    uint32_t symbol_base = dest->symbol_table.count;
+    for (uint32_t i = 0; i < src->symbol_table.count; i++)
+    {
+        dest->symbol_table.symbol_ids[symbol_base + i] =
+            remap_string_id(string_map, string_count, src->symbol_table.symbol_ids[i]);
+        dest->symbol_table.file_indices[symbol_base + i] = src->symbol_table.file_indices[i] + file_base;
+    }
+
+    dest->functions.count += src->functions.count;
+    dest->classes.count += src->classes.count;
+    dest->variables.count += src->variables.count;
+    dest->calls.count += src->calls.count;
+    dest->files.count += src->files.count;
+    dest->symbol_table.count += src->symbol_table.count;
+    dest->total_functions += src->functions.count;
+    dest->total_classes += src->classes.count;
+    dest->total_variables += src->variables.count;
+
+    if (first_file_index)
+    {
+        *first_file_index = file_base;
+    }
+
+    return CQ_SUCCESS;
+}
+
+/**
+ * @brief File path and original index, for sorting files
+ */
+typedef struct
+{
+    const char *path;
+    uint32_t index;
+} FileOrder;
+
+static int compare_file_order(const void *a, const void *b)
+{
+    const FileOrder *fa = (const FileOrder *)a;
+    const FileOrder *fb = (const FileOrder *)b;
+    int cmp = strcmp(fa->path ? fa->path : "", fb->path ? fb->path : "");
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+    return fa->index < fb->index ? -1 : (fa->index > fb->index ? 1 : 0);
+}
+
+/**
+ * @brief Stable counting sort: new position of each record given its bucket
+ *
+ * @param buckets Bucket of each record, in [0, bucket_count)
+ * @param count Number of records
+ * @param bucket_count Number of buckets
+ * @param bucket_starts Optional output (bucket_count entries): first position of each bucket
+ * @return Map from old to new record index (caller frees), or NULL on allocation failure
+ */
+static uint32_t *bucket_permutation(const uint32_t *buckets, uint32_t count, uint32_t bucket_count,
+                                    uint32_t *bucket_starts)
+{
+    uint32_t *next = (uint32_t *)calloc(bucket_count + 1, sizeof(uint32_t));
+    uint32_t *map = (uint32_t *)malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if (!next || !map)
+    {
+        free(next);
+        free(map);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        next[buckets[i] + 1]++;
+    }
+    for (uint32_t b = 0; b < bucket_count; b++)
+    {
+        next[b + 1] += next[b];
+    }
+    if (bucket_starts)
+    {
+        memcpy(bucket_starts, next, bucket_count * sizeof(uint32_t));
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        map[i] = next[buckets[i]]++;
+    }
+
+    free(next);
+    return map;
+}
+
+/**
+ * @brief Copy records to the positions given by map
+ */
+static void permute_into(void *dst, const void *src, uint32_t count, size_t element_size, const uint32_t *map)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy((char *)dst + (size_t)map[i] * element_size, (const char *)src + (size_t)i * element_size,
+               element_size);
+    }
+}
+
+CQError project_sort_files(Project *project)
+{
+    if (!project)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint32_t file_count = project->files.count;
+    uint32_t function_count = project->functions.count;
+    uint32_t class_count = project->classes.count;
+    uint32_t variable_count = project->variables.count;
+    uint32_t call_count = project->calls.count;
+    if (file_count < 2)
+    {
+        return CQ_SUCCESS;
+    }
+
+    FileOrder *order = (FileOrder *)malloc(file_count * sizeof(FileOrder));
+    if (!order)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    bool sorted = true;
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        order[i].path = string_pool_get(&project->string_pool, project->files.files[i].filepath_id);
+        order[i].index = i;
+        if (i > 0 && compare_file_order(&order[i - 1], &order[i]) > 0)
+        {
+            sorted = false;
+        }
+    }
+    if (sorted)
+    {
+        free(order);
+        return CQ_SUCCESS;
+    }
+    qsort(order, file_count, sizeof(FileOrder), compare_file_order);
+
+    // Records of unknown files go to an extra bucket after all files
+    uint32_t largest = function_count;
+    largest = class_count > largest ? class_count : largest;
+    largest = variable_count > largest ? variable_count : largest;
+    largest = call_count > largest ? call_count : largest;
+    largest = file_count > largest ? file_count : largest;
+
+    uint32_t *file_map = (uint32_t *)malloc(file_count * sizeof(uint32_t));
+    uint32_t *buckets = (uint32_t *)malloc(largest * sizeof(uint32_t));
+    uint32_t *function_starts = (uint32_t *)malloc((file_count + 1) * sizeof(uint32_t));
+    uint32_t *class_starts = (uint32_t *)malloc((file_count + 1) * sizeof(uint32_t));
+    uint32_t *variable_starts = (uint32_t *)malloc((file_count + 1) * sizeof(uint32_t));
+    uint32_t *function_map = NULL;
+    uint32_t *class_map = NULL;
+    uint32_t *variable_map = NULL;
+    uint32_t *call_map = NULL;
+    FunctionInfo *new_functions = NULL;
+    ClassInfo *new_classes = NULL;
+    VariableInfo *new_variables = NULL;
+    CallEdge *new_calls = NULL;
+    FileInfo *new_files = NULL;
+    CQError result = CQ_ERROR_MEMORY_ALLOCATION;
+
+    if (!file_map || !buckets || !function_starts || !class_starts || !variable_starts)
+    {
+        goto cleanup;
+    }
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        file_map[order[i].index] = i;
+    }
+
+    for (uint32_t i = 0; i < function_count; i++)
+    {
+        uint32_t file_id = project->functions.functions[i].location.file_id;
+        buckets[i] = file_id < file_count ? file_map[file_id] : file_count;
+    }
+    function_map = bucket_permutation(buckets, function_count, file_count + 1, function_starts);
+
+    for (uint32_t i = 0; i < class_count; i++)
+    {
+        uint32_t file_id = project->classes.classes[i].file_id;
+        buckets[i] = file_id < file_count ? file_map[file_id] : file_count;
+    }
+    class_map = bucket_permutation(buckets, class_count, file_count + 1, class_starts);
+
+    for (uint32_t i = 0; i < variable_count; i++)
+    {
+        uint32_t file_id = project->variables.variables[i].location.file_id;
+        buckets[i] = file_id < file_count ? file_map[file_id] : file_count;
+    }
+    variable_map = bucket_permutation(buckets, variable_count, file_count + 1, variable_starts);
+
+    if (!function_map || !class_map || !variable_map)
+    {
+        goto cleanup;
+    }
+
+    // Calls follow their caller
+    for (uint32_t i = 0; i < call_count; i++)
+    {
+        uint32_t caller = project->calls.calls[i].caller_index;
+        buckets[i] = caller < function_count ? function_map[caller] : function_count;
+    }
+    call_map = bucket_permutation(buckets, call_count, function_count + 1, NULL);
+    if (!call_map)
+    {
+        goto cleanup;
+    }
+
+    // Allocate every destination array before touching the project
+    new_functions = (FunctionInfo *)malloc(((size_t)project->functions.capacity + 1) * sizeof(FunctionInfo));
+    new_classes = (ClassInfo *)malloc(((size_t)project->classes.capacity + 1) * sizeof(ClassInfo));
+    new_variables = (VariableInfo *)malloc(((size_t)project->variables.capacity + 1) * sizeof(VariableInfo));
+    new_calls = (CallEdge *)malloc(((size_t)project->calls.capacity + 1) * sizeof(CallEdge));
+    new_files = (FileInfo *)malloc(((size_t)project->files.capacity + 1) * sizeof(FileInfo));
+    if (!new_functions || !new_classes || !new_variables || !new_calls || !new_files)
+    {
+        goto cleanup;
+    }
+
+    // Patch indices in place, then move the records
+    for (uint32_t i = 0; i < function_count; i++)
+    {
+        FunctionInfo *func = &project->functions.functions[i];
+        uint32_t file_id = func->location.file_id;
+
+        if (func->class_id < class_count)
+        {
+            func->class_id = class_map[func->class_id];
+        }
+        if (file_id < file_count)
+        {
+            func->location.file_id = file_map[file_id];
+        }
+    }
+    for (uint32_t i = 0; i < class_count; i++)
+    {
+        ClassInfo *cls = &project->classes.classes[i];
+        if (cls->location.file_id < file_count)
+        {
+            cls->location.file_id = file_map[cls->location.file_id];
+        }
+        if (cls->file_id < file_count)
+        {
+            cls->file_id = file_map[cls->file_id];
+        }
+        for (uint32_t m = 0; cls->method_indices && m < cls->method_count; m++)
+        {
+            if (cls->method_indices[m] < function_count)
+            {
+                cls->method_indices[m] = function_map[cls->method_indices[m]];
+            }
+        }
+    }
+    for (uint32_t i = 0; i < variable_count; i++)
+    {
+        VariableInfo *var = &project->variables.variables[i];
+        if (var->location.file_id < file_count)
+        {
+            var->location.file_id = file_map[var->location.file_id];
+        }
+    }
+    for (uint32_t i = 0; i < call_count; i++)
+    {
+        CallEdge *call = &project->calls.calls[i];
+        if (call->caller_index < function_count)
+        {
+            call->caller_index = function_map[call->caller_index];
+        }
+    }
+    for (uint32_t i = 0; i < project->symbol_table.count; i++)
+    {
+        uint32_t file_index = project->symbol_table.file_indices[i];
+        if (file_index < file_count)
+        {
+            project->symbol_table.file_indices[i] = file_map[file_index];
+        }
+    }
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        FileInfo *file = &project->files.files[i];
+        file->function_start = function_starts[file_map[i]];
+        file->class_start = class_starts[file_map[i]];
+        file->variable_start = variable_starts[file_map[i]];
+    }
+
+    permute_into(new_functions, project->functions.functions, function_count, sizeof(FunctionInfo), function_map);
+    permute_into(new_classes, project->classes.classes, class_count, sizeof(ClassInfo), class_map);
+    permute_into(new_variables, project->variables.variables, variable_count, sizeof(VariableInfo), variable_map);
+    permute_into(new_calls, project->calls.calls, call_count, sizeof(CallEdge), call_map);
+    permute_into(new_files, project->files.files, file_count, sizeof(FileInfo), file_map);
+
+    // Swap the arrays; the old ones are released below
+    FunctionInfo *old_functions = project->functions.functions;
+    ClassInfo *old_classes = project->classes.classes;
+    VariableInfo *old_variables = project->variables.variables;
+    CallEdge *old_calls = project->calls.calls;
+    FileInfo *old_files = project->files.files;
+    project->functions.functions = new_functions;
+    project->classes.classes = new_classes;
+    project->variables.variables = new_variables;
+    project->calls.calls = new_calls;
+    project->files.files = new_files;
+    new_functions = old_functions;
+    new_classes = old_classes;
+    new_variables = old_variables;
+    new_calls = old_calls;
+    new_files = old_files;
+    result = CQ_SUCCESS;
+
+cleanup:
+    free(order);
+    free(file_map);
+    free(buckets);
+    free(function_starts);
+    free(class_starts);
+    free(variable_starts);
+    free(function_map);
+    free(class_map);
+    free(variable_map);
+    free(call_map);
+    free(new_functions);
+    free(new_classes);
+    free(new_variables);
+    free(new_calls);
+    free(new_files);
+    return result;
+}
+
 // Validation functions
 bool ast_data_validate(const ASTData *data)
 {
@@ -5,37 +5,129 @@
 
 #include "cqanalyzer.h"
 #include "data/data_store.h"
+#include "data/ast_types.h"
 #include "utils/logger.h"
 
-// Simple hash table for storing file data
-#define HASH_TABLE_SIZE 1024
+// Initial number of files the columns have room for
+#define DATA_STORE_INITIAL_FILES 1024
 
-typedef struct MetricEntry
-{
-    char metric_name[64];
-    double value;
-    struct MetricEntry *next;
-} MetricEntry;
+// Initial number of distinct metric names
+#define DATA_STORE_INITIAL_METRICS 16
 
-typedef struct FileEntry
+/**
+ * @brief Values of one metric, indexed by file ID
+ */
+typedef struct
+{
+    double *values;           // Dense column; undefined where the file has no value
+    uint64_t *present;        // Bit per file ID, set where values holds a value
+    uint32_t present_count;   // Files with a value
+} MetricColumn;
+
+/**
+ * @brief Metric table: interned file IDs by interned metric IDs
+ *
+ * File and metric IDs are dense and assigned in order of addition, so each
+ * metric is a double column over all files and reading a metric for every
+ * file copies one contiguous span.
+ */
+static struct
 {
-    char filepath[MAX_PATH_LENGTH];
-    SupportedLanguage language;
-    MetricEntry *metrics;
-    struct FileEntry *next;
-} FileEntry;
+    StringPool paths;         // File path by file ID
+    SupportedLanguage *languages;
+    uint32_t file_capacity;   // Files the columns have room for
+    StringPool metric_names;  // Metric name by metric ID
+    MetricColumn *metrics;    // Column by metric ID
+    uint32_t metric_capacity;
+} store;
 
-static FileEntry *file_hash_table[HASH_TABLE_SIZE];
 static bool data_store_initialized = false;
 
-static unsigned int hash_string(const char *str)
+static size_t presence_words(uint32_t file_capacity)
+{
+    return (file_capacity + 63) / 64;
+}
+
+/**
+ * @brief Allocate a column with room for the current file capacity
+ */
+static CQError metric_column_init(MetricColumn *column)
 {
-    unsigned int hash = 0;
-    while (*str)
+    column->values = (double *)malloc(store.file_capacity * sizeof(double));
+    column->present = (uint64_t *)calloc(presence_words(store.file_capacity), sizeof(uint64_t));
+    column->present_count = 0;
+    if (!column->values || !column->present)
     {
-        hash = (hash * 31) + *str++;
+        free(column->values);
+        free(column->present);
+        column->values = NULL;
+        column->present = NULL;
+        return CQ_ERROR_MEMORY_ALLOCATION;
     }
-    return hash % HASH_TABLE_SIZE;
+    return CQ_SUCCESS;
+}
+
+/**
+ * @brief Double the number of files every column has room for
+ */
+static CQError grow_files(void)
+{
+    uint32_t new_capacity = store.file_capacity * 2;
+    size_t old_words = presence_words(store.file_capacity);
+    size_t new_words = presence_words(new_capacity);
+
+    SupportedLanguage *languages =
+        (SupportedLanguage *)realloc(store.languages, new_capacity * sizeof(SupportedLanguage));
+    if (!languages)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    store.languages = languages;
+
+    // Columns that grew stay valid at the old capacity if a later one fails
+    for (uint32_t i = 0; i < store.metric_names.count; i++)
+    {
+        MetricColumn *column = &store.metrics[i];
+        double *values = (double *)realloc(column->values, new_capacity * sizeof(double));
+        if (!values)
+        {
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+        column->values = values;
+
+        uint64_t *present = (uint64_t *)realloc(column->present, new_words * sizeof(uint64_t));
+        if (!present)
+        {
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+        memset(present + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
+        column->present = present;
+    }
+
+    store.file_capacity = new_capacity;
+    return CQ_SUCCESS;
+}
+
+/**
+ * @brief Find the ID of a stored file
+ */
+static bool find_file(const char *filepath, uint32_t *file_id)
+{
+    return string_pool_find(&store.paths, filepath, file_id);
+}
+
+/**
+ * @brief Find the column of a metric, or NULL if no file has it
+ */
+static MetricColumn *find_metric(const char *metric_name)
+{
+    uint32_t metric_id;
+    return string_pool_find(&store.metric_names, metric_name, &metric_id) ? &store.metrics[metric_id] : NULL;
+}
+
+static bool has_value(const MetricColumn *column, uint32_t file_id)
+{
+    return (column->present[file_id / 64] >> (file_id % 64)) & 1;
 }
 
 CQError data_store_init(void)
@@ -45,7 +137,23 @@ CQError data_store_init(void)
         return CQ_SUCCESS;
     }
 
-    memset(file_hash_table, 0, sizeof(file_hash_table));
+    memset(&store, 0, sizeof(store));
+    store.file_capacity = DATA_STORE_INITIAL_FILES;
+    store.metric_capacity = DATA_STORE_INITIAL_METRICS;
+    store.languages = (SupportedLanguage *)malloc(store.file_capacity * sizeof(SupportedLanguage));
+    store.metrics = (MetricColumn *)malloc(store.metric_capacity * sizeof(MetricColumn));
+    if (!store.languages || !store.metrics ||
+        string_pool_init(&store.paths, DATA_STORE_INITIAL_FILES) != CQ_SUCCESS ||
+        string_pool_init(&store.metric_names, DATA_STORE_INITIAL_METRICS) != CQ_SUCCESS)
+    {
+        LOG_ERROR("Failed to allocate memory for data store");
+        string_pool_destroy(&store.paths);
+        free(store.languages);
+        free(store.metrics);
+        memset(&store, 0, sizeof(store));
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
     data_store_initialized = true;
 
     LOG_INFO("Data store initialized");
@@ -60,26 +168,16 @@ void data_store_shutdown(void)
     }
 
     // Free all allocated memory
-    for (int i = 0; i < HASH_TABLE_SIZE; i++)
+    for (uint32_t i = 0; i < store.metric_names.count; i++)
     {
-        FileEntry *entry = file_hash_table[i];
-        while (entry)
-        {
-            FileEntry *next_entry = entry->next;
-
-            MetricEntry *metric = entry->metrics;
-            while (metric)
-            {
-                MetricEntry *next_metric = metric->next;
-                free(metric);
-                metric = next_metric;
-            }
-
-            free(entry);
-            entry = next_entry;
-        }
-        file_hash_table[i] = NULL;
+        free(store.metrics[i].values);
+        free(store.metrics[i].present);
     }
+    free(store.metrics);
+    free(store.languages);
+    string_pool_destroy(&store.metric_names);
+    string_pool_destroy(&store.paths);
+    memset(&store, 0, sizeof(store));
 
     data_store_initialized = false;
     LOG_INFO("Data store shutdown");
@@ -87,39 +185,35 @@ void data_store_shutdown(void)
 
 CQError data_store_add_file(const char *filepath, SupportedLanguage language)
 {
-    if (!data_store_initialized || !filepath)
+    if (!data_store_initialized || !filepath || strlen(filepath) >= MAX_PATH_LENGTH)
     {
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    unsigned int hash = hash_string(filepath);
-
     // Check if file already exists
-    FileEntry *entry = file_hash_table[hash];
-    while (entry)
+    uint32_t file_id;
+    if (find_file(filepath, &file_id))
     {
-        if (strcmp(entry->filepath, filepath) == 0)
-        {
-            // Update language if different
-            entry->language = language;
-            return CQ_SUCCESS;
-        }
-        entry = entry->next;
+        // Update language if different
+        store.languages[file_id] = language;
+        return CQ_SUCCESS;
     }
 
-    // Create new entry
-    entry = (FileEntry *)malloc(sizeof(FileEntry));
-    if (!entry)
+    if (store.paths.count >= store.file_capacity && grow_files() != CQ_SUCCESS)
     {
         LOG_ERROR("Failed to allocate memory for file entry");
         return CQ_ERROR_MEMORY_ALLOCATION;
     }
 
-    strcpy(entry->filepath, filepath);
-    entry->language = language;
-    entry->metrics = NULL;
-    entry->next = file_hash_table[hash];
-    file_hash_table[hash] = entry;
+    // New paths get the next ID
+    uint32_t count = store.paths.count;
+    file_id = string_pool_intern(&store.paths, filepath);
+    if (store.paths.count == count)
+    {
+        LOG_ERROR("Failed to allocate memory for file entry");
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+    store.languages[file_id] = language;
 
     LOG_DEBUG("Added file to data store: %s", filepath);
     return CQ_SUCCESS;
@@ -132,50 +226,54 @@ CQError data_store_add_metric(const char *filepath, const char *metric_name, dou
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    unsigned int hash = hash_string(filepath);
-
-    // Find file entry
-    FileEntry *entry = file_hash_table[hash];
-    while (entry)
-    {
-        if (strcmp(entry->filepath, filepath) == 0)
-        {
-            break;
-        }
-        entry = entry->next;
-    }
-
-    if (!entry)
+    uint32_t file_id;
+    if (!find_file(filepath, &file_id))
     {
         LOG_ERROR("File not found in data store: %s", filepath);
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    // Check if metric already exists
-    MetricEntry *metric = entry->metrics;
-    while (metric)
+    MetricColumn *column = find_metric(metric_name);
+    if (!column)
     {
-        if (strcmp(metric->metric_name, metric_name) == 0)
+        // First value of this metric: add a column
+        if (store.metric_names.count >= store.metric_capacity)
         {
-            // Update value
-            metric->value = value;
-            return CQ_SUCCESS;
+            uint32_t new_capacity = store.metric_capacity * 2;
+            MetricColumn *metrics = (MetricColumn *)realloc(store.metrics, new_capacity * sizeof(MetricColumn));
+            if (!metrics)
+            {
+                LOG_ERROR("Failed to allocate memory for metric entry");
+                return CQ_ERROR_MEMORY_ALLOCATION;
+            }
+            store.metrics = metrics;
+            store.metric_capacity = new_capacity;
+        }
+
+        column = &store.metrics[store.metric_names.count];
+        if (metric_column_init(column) != CQ_SUCCESS)
+        {
+            LOG_ERROR("Failed to allocate memory for metric entry");
+            return CQ_ERROR_MEMORY_ALLOCATION;
+        }
+
+        uint32_t count = store.metric_names.count;
+        string_pool_intern(&store.metric_names, metric_name);
+        if (store.metric_names.count == count)
+        {
+            free(column->values);
+            free(column->present);
+            LOG_ERROR("Failed to allocate memory for metric entry");
+            return CQ_ERROR_MEMORY_ALLOCATION;
         }
-        metric = metric->next;
     }
 
-    // Create new metric entry
-    metric = (MetricEntry *)malloc(sizeof(MetricEntry));
-    if (!metric)
+    if (!has_value(column, file_id))
     {
-        LOG_ERROR("Failed to allocate memory for metric entry");
-        return CQ_ERROR_MEMORY_ALLOCATION;
+        column->present[file_id / 64] |= (uint64_t)1 << (file_id % 64);
+        column->present_count++;
     }
-
-    strcpy(metric->metric_name, metric_name);
-    metric->value = value;
-    metric->next = entry->metrics;
-    entry->metrics = metric;
+    column->values[file_id] = value;
 
     LOG_DEBUG("Added metric %s=%.2f for file: %s", metric_name, value, filepath);
     return CQ_SUCCESS;
@@ -188,17 +286,11 @@ int data_store_get_all_files(char filepaths[][MAX_PATH_LENGTH], int max_files)
         return 0;
     }
 
-    int count = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE && count < max_files; i++)
+    // Files are returned in the order they were added
+    int count = store.paths.count < (uint32_t)max_files ? (int)store.paths.count : max_files;
+    for (int i = 0; i < count; i++)
     {
-        FileEntry *entry = file_hash_table[i];
-        while (entry && count < max_files)
-        {
-            strcpy(filepaths[count], entry->filepath);
-            count++;
-            entry = entry->next;
-        }
+        strcpy(filepaths[i], string_pool_get(&store.paths, (uint32_t)i));
     }
 
     return count;
@@ -211,26 +303,27 @@ int data_store_get_all_metric_values(const char *metric_name, double *values, in
         return 0;
     }
 
-    int count = 0;
+    const MetricColumn *column = find_metric(metric_name);
+    if (!column)
+    {
+        return 0;
+    }
 
-    for (int i = 0; i < HASH_TABLE_SIZE && count < max_values; i++)
+    // When every file has the metric, the column is the result
+    uint32_t file_count = store.paths.count;
+    if (column->present_count == file_count)
     {
-        FileEntry *entry = file_hash_table[i];
-        while (entry && count < max_values)
+        int count = file_count < (uint32_t)max_values ? (int)file_count : max_values;
+        memcpy(values, column->values, (size_t)count * sizeof(double));
+        return count;
+    }
+
+    int count = 0;
+    for (uint32_t file_id = 0; file_id < file_count && count < max_values; file_id++)
+    {
+        if (has_value(column, file_id))
         {
-            // Find the metric for this file
-            MetricEntry *metric = entry->metrics;
-            while (metric && count < max_values)
-            {
-                if (strcmp(metric->metric_name, metric_name) == 0)
-                {
-                    values[count] = metric->value;
-                    count++;
-                    break; // Only one value per file per metric
-                }
-                metric = metric->next;
-            }
-            entry = entry->next;
+            values[count++] = column->values[file_id];
         }
     }
 
@@ -244,34 +337,12 @@ double data_store_get_metric(const char *filepath, const char *metric_name)
         return -1.0;
     }
 
-    unsigned int hash = hash_string(filepath);
-
-    // Find file entry
-    FileEntry *entry = file_hash_table[hash];
-    while (entry)
-    {
-        if (strcmp(entry->filepath, filepath) == 0)
-        {
-            break;
-        }
-        entry = entry->next;
-    }
-
-    if (!entry)
+    uint32_t file_id;
+    const MetricColumn *column = find_metric(metric_name);
+    if (!column || !find_file(filepath, &file_id) || !has_value(column, file_id))
     {
         return -1.0;
     }
 
-    // Find metric
-    MetricEntry *metric = entry->metrics;
-    while (metric)
-    {
-        if (strcmp(metric->metric_name, metric_name) == 0)
-        {
-            return metric->value;
-        }
-        metric = metric->next;
-    }
-
-    return -1.0;
+    return column->values[file_id];
 }
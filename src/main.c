@@ -231,7 +231,7 @@ int main(int argc, char *argv[])
 
     // Phase 1: Parse the project
     progress_update(1, "Parsing project files...");
-    void *project_ast = parse_project(args.project_path, 1000, (void (*)(int, int, const char *))progress_update);
+    void *project_ast = parse_project(args.project_path, PARSE_PROJECT_NO_FILE_LIMIT, progress_report);
     if (!project_ast)
     {
         LOG_ERROR("Failed to parse project");
@@ -4,135 +4,303 @@
 #include <clang-c/Index.h>
 
 #include "parser/ast_parser.h"
+#include "parser/compile_database.h"
 #include "parser/generic_parser.h"
 #include "parser/language_support.h"
+#include "parser/pch_cache.h"
 #include "parser/preprocessor.h"
 #include "data/ast_types.h"
 #include "utils/logger.h"
 
+// Compiler arguments per parse, including the two PCH arguments
+#define MAX_PARSE_ARGS 256
+
 // Global libclang index
 static CXIndex clang_index = NULL;
 
+// Shared precompiled preambles (NULL when disabled)
+static PchCache *pch_cache = NULL;
+
+// Macro definitions shared by the files of the project being parsed (NULL outside parse_project)
+static MacroTable *project_macro_table = NULL;
+
+// Per-file arguments from compile_commands.json (NULL when not used)
+static const CompileDatabase *compile_database = NULL;
+
+// Parse options and body metrics for the active analysis profile
+static unsigned parse_options = CXTranslationUnit_None;
+static bool parse_function_bodies = true;
+
 /**
- * @brief Context for AST visitor
+ * @brief Function or variable slot of a declaration in the per-file project
  */
 typedef struct {
-    ASTData *ast_data;
-    FunctionInfo *current_function;
-    int complexity_count;
-    VariableInfo *current_variables;
-} VisitorContext;
+    CXCursor cursor;        // Canonical declaration cursor
+    uint32_t slot;          // Index into the function or variable array; UINT32_MAX if empty
+    bool is_function;
+} SymbolSlot;
 
 /**
- * @brief Visitor function for counting decision points
+ * @brief Hash index from canonical declaration cursors to project slots
+ *
+ * References are resolved with clang_getCursorReferenced(), so usage counts
+ * go to the exact declaration instead of every symbol sharing its name.
  */
-static enum CXChildVisitResult count_decision_points_visitor(CXCursor cursor, CXCursor parent, CXClientData client_data) {
-    int *count = (int *)client_data;
-    enum CXCursorKind kind = clang_getCursorKind(cursor);
+typedef struct {
+    SymbolSlot *entries;
+    uint32_t count;
+    uint32_t capacity;      // Power of two
+} SymbolIndex;
 
-    switch (kind) {
-        case CXCursor_IfStmt:
-        case CXCursor_WhileStmt:
-        case CXCursor_ForStmt:
-        case CXCursor_DoStmt:
-        case CXCursor_SwitchStmt:
-            (*count)++;
-            break;
-        case CXCursor_CaseStmt:
-        case CXCursor_DefaultStmt:
-            (*count)++;
-            break;
-        case CXCursor_BinaryOperator: {
-            CXString spelling = clang_getCursorSpelling(cursor);
-            const char *op = clang_getCString(spelling);
-            if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) {
-                (*count)++;
+static SymbolSlot *symbol_index_lookup(const SymbolIndex *index, CXCursor canonical) {
+    if (index->capacity == 0) {
+        return NULL;
+    }
+
+    uint32_t mask = index->capacity - 1;
+    uint32_t bucket = clang_hashCursor(canonical) & mask;
+    while (index->entries[bucket].slot != UINT32_MAX) {
+        if (clang_equalCursors(index->entries[bucket].cursor, canonical)) {
+            return &index->entries[bucket];
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return NULL;
+}
+
+static void symbol_index_insert_entry(SymbolIndex *index, const SymbolSlot *entry) {
+    uint32_t mask = index->capacity - 1;
+    uint32_t bucket = clang_hashCursor(entry->cursor) & mask;
+    while (index->entries[bucket].slot != UINT32_MAX) {
+        bucket = (bucket + 1) & mask;
+    }
+    index->entries[bucket] = *entry;
+    index->count++;
+}
+
+/**
+ * @brief Register a declaration
+ *
+ * The first declaration of a symbol takes the slot until its definition is
+ * seen, so usages land on the definition rather than on a prototype.
+ *
+ * @return Slot the definition took over, or UINT32_MAX if there was none
+ */
+static uint32_t symbol_index_add(SymbolIndex *index, CXCursor declaration, uint32_t slot, bool is_function) {
+    CXCursor canonical = clang_getCanonicalCursor(declaration);
+    SymbolSlot *existing = symbol_index_lookup(index, canonical);
+    if (existing) {
+        if (!clang_isCursorDefinition(declaration) || existing->slot == slot) {
+            return UINT32_MAX;
+        }
+        uint32_t previous = existing->slot;
+        existing->slot = slot;
+        return previous;
+    }
+
+    // Keep the table at most half full
+    if ((index->count + 1) * 2 > index->capacity) {
+        uint32_t new_capacity = index->capacity ? index->capacity * 2 : 256;
+        SymbolSlot *old_entries = index->entries;
+        uint32_t old_capacity = index->capacity;
+
+        SymbolSlot *entries = malloc(new_capacity * sizeof(SymbolSlot));
+        if (!entries) {
+            return UINT32_MAX;
+        }
+        for (uint32_t i = 0; i < new_capacity; i++) {
+            entries[i].slot = UINT32_MAX;
+        }
+
+        index->entries = entries;
+        index->capacity = new_capacity;
+        index->count = 0;
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (old_entries[i].slot != UINT32_MAX) {
+                symbol_index_insert_entry(index, &old_entries[i]);
             }
-            clang_disposeString(spelling);
-            break;
         }
-        case CXCursor_ConditionalOperator: // ?:
-            (*count)++;
-            break;
-        default:
-            break;
+        free(old_entries);
     }
 
-    return CXChildVisit_Recurse;
+    SymbolSlot entry = { .cursor = canonical, .slot = slot, .is_function = is_function };
+    symbol_index_insert_entry(index, &entry);
+    return UINT32_MAX;
 }
 
 /**
- * @brief Count decision points in a cursor subtree
+ * @brief Count a DeclRefExpr against the function or variable it refers to
  */
-static void count_decision_points(CXCursor cursor, int *count) {
-    clang_visitChildren(cursor, count_decision_points_visitor, count);
+static void record_symbol_usage(ASTData *ast_data, const SymbolIndex *index, CXCursor reference) {
+    CXCursor referenced = clang_getCursorReferenced(reference);
+    if (clang_Cursor_isNull(referenced)) {
+        return;
+    }
+
+    SymbolSlot *entry = symbol_index_lookup(index, clang_getCanonicalCursor(referenced));
+    if (!entry) {
+        return;
+    }
+
+    if (entry->is_function) {
+        FunctionInfo *func = function_array_get(&ast_data->project->functions, entry->slot);
+        if (func) {
+            func->usage_count++;
+        }
+    } else {
+        VariableInfo *var = variable_array_get(&ast_data->project->variables, entry->slot);
+        if (var) {
+            var->usage_count++;
+        }
+    }
 }
 
 /**
- * @brief Context for nesting depth visitor
+ * @brief Open cursor on the function body walk stack
  */
 typedef struct {
-    int current_depth;
+    CXCursor cursor;
+    int depth;              // Control-structure nesting depth inside this cursor
+} BodyFrame;
+
+/**
+ * @brief State of a single-pass function body walk
+ *
+ * libclang reports no "leave" events, so the ancestors of the current cursor
+ * are kept on an explicit stack and popped until the reported parent is on
+ * top. The stack buffer is reused for every function of a translation unit.
+ */
+typedef struct {
+    ASTData *ast_data;
+    const SymbolIndex *symbols; // Declarations referenced by usage counting
+    uint32_t function_index;    // Caller index for recorded call edges
+    int decision_count;
     int max_depth;
-} NestingContext;
+    BodyFrame *stack;
+    int stack_size;
+    int stack_capacity;
+} FunctionBodyContext;
 
 /**
- * @brief Visitor function for calculating nesting depth
+ * @brief Check whether a binary operator cursor is && or ||
  */
-static enum CXChildVisitResult calculate_nesting_visitor(CXCursor cursor, CXCursor parent, CXClientData client_data) {
-    NestingContext *context = (NestingContext *)client_data;
+static bool is_logical_operator(CXCursor cursor) {
+#if CINDEX_VERSION_MAJOR > 0 || CINDEX_VERSION_MINOR >= 64
+    // libclang 17+ classifies operators without materializing a string
+    enum CXBinaryOperatorKind op = clang_getCursorBinaryOperatorKind(cursor);
+    return op == CXBinaryOperator_LAnd || op == CXBinaryOperator_LOr;
+#else
+    CXString spelling = clang_getCursorSpelling(cursor);
+    const char *op = clang_getCString(spelling);
+    bool logical = op && (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0);
+    clang_disposeString(spelling);
+    return logical;
+#endif
+}
+
+/**
+ * @brief Visitor computing complexity, nesting, call edges and usages in one walk
+ */
+static enum CXChildVisitResult function_body_visitor(CXCursor cursor, CXCursor parent, CXClientData client_data) {
+    FunctionBodyContext *context = (FunctionBodyContext *)client_data;
     enum CXCursorKind kind = clang_getCursorKind(cursor);
 
-    // Check if this is a control structure that increases nesting
-    int is_control_structure = 0;
+    // Leave every subtree that does not contain this cursor
+    while (context->stack_size > 0 &&
+           !clang_equalCursors(context->stack[context->stack_size - 1].cursor, parent)) {
+        context->stack_size--;
+    }
+    int depth = context->stack_size > 0 ? context->stack[context->stack_size - 1].depth : 0;
+
     switch (kind) {
         case CXCursor_IfStmt:
         case CXCursor_WhileStmt:
         case CXCursor_ForStmt:
         case CXCursor_DoStmt:
         case CXCursor_SwitchStmt:
-            is_control_structure = 1;
+            // Decision point that also nests its children
+            context->decision_count++;
+            depth++;
+            if (depth > context->max_depth) {
+                context->max_depth = depth;
+            }
+            break;
+        case CXCursor_CaseStmt:
+        case CXCursor_DefaultStmt:
+        case CXCursor_ConditionalOperator: // ?:
+            context->decision_count++;
+            break;
+        case CXCursor_BinaryOperator:
+            if (is_logical_operator(cursor)) {
+                context->decision_count++;
+            }
+            break;
+        case CXCursor_CallExpr: {
+            CXString spelling = clang_getCursorSpelling(cursor);
+            const char *callee = clang_getCString(spelling);
+            if (callee && callee[0] != '\0') {
+                unsigned line;
+                clang_getFileLocation(clang_getCursorLocation(cursor), NULL, &line, NULL, NULL);
+
+                CallEdge call = {
+                    .caller_index = context->function_index,
+                    .callee_name_id = string_pool_intern(&context->ast_data->project->string_pool, callee),
+                    .line = line
+                };
+                call_edge_array_add(&context->ast_data->project->calls, &call);
+            }
+            clang_disposeString(spelling);
+            break;
+        }
+        case CXCursor_DeclRefExpr:
+            record_symbol_usage(context->ast_data, context->symbols, cursor);
             break;
         default:
             break;
     }
 
-    if (is_control_structure) {
-        // Increase depth for this control structure
-        context->current_depth++;
-
-        // Update max depth if current is greater
-        if (context->current_depth > context->max_depth) {
-            context->max_depth = context->current_depth;
+    if (context->stack_size == context->stack_capacity) {
+        int new_capacity = context->stack_capacity ? context->stack_capacity * 2 : 64;
+        BodyFrame *new_stack = realloc(context->stack, new_capacity * sizeof(BodyFrame));
+        if (!new_stack) {
+            // Without a frame the subtree would be attributed to the wrong depth
+            return CXChildVisit_Continue;
         }
-
-        // Visit children with increased depth
-        clang_visitChildren(cursor, calculate_nesting_visitor, client_data);
-
-        // Decrease depth when leaving this control structure
-        context->current_depth--;
-
-        return CXChildVisit_Continue;
+        context->stack = new_stack;
+        context->stack_capacity = new_capacity;
     }
+    context->stack[context->stack_size].cursor = cursor;
+    context->stack[context->stack_size].depth = depth;
+    context->stack_size++;
 
-    // For non-control structures, just continue visiting children
     return CXChildVisit_Recurse;
 }
 
 /**
- * @brief Calculate nesting depth for a function cursor
+ * @brief Walk a function body once, filling complexity, nesting and call edges
  */
-static void calculate_function_nesting_depth(CXCursor function_cursor, int *max_depth) {
-    NestingContext context = {
-        .current_depth = 0,
-        .max_depth = 0
-    };
+static void analyze_function_body(CXCursor function_cursor, FunctionBodyContext *context,
+                                  uint32_t function_index, FunctionInfo *func_data) {
+    context->function_index = function_index;
+    context->decision_count = 0;
+    context->max_depth = 0;
+    context->stack_size = 0;
 
-    clang_visitChildren(function_cursor, calculate_nesting_visitor, &context);
+    clang_visitChildren(function_cursor, function_body_visitor, context);
 
-    *max_depth = context.max_depth;
+    func_data->complexity = 1 + context->decision_count; // Base complexity + decision points
+    func_data->nesting_depth = context->max_depth;
 }
 
+/**
+ * @brief Context for AST visitor
+ */
+typedef struct {
+    ASTData *ast_data;
+    SymbolIndex symbols;        // Functions and variables declared so far
+    FunctionBodyContext body;   // Reused for every function body walk
+} VisitorContext;
+
 /**
  * @brief AST visitor function for libclang
  */
@@ -142,11 +310,22 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
     ASTData *ast_data = context->ast_data;
     enum CXCursorKind kind = clang_getCursorKind(cursor);
 
+    // Classify by kind first; names and locations are only fetched for recorded kinds
+    switch (kind)
+    {
+        case CXCursor_FunctionDecl:
+        case CXCursor_StructDecl:
+        case CXCursor_ClassDecl:
+        case CXCursor_VarDecl:
+            break;
+        default:
+            return CXChildVisit_Continue;
+    }
+
     // Get cursor location
     CXSourceLocation location = clang_getCursorLocation(cursor);
-    CXFile file;
     unsigned line, column, offset;
-    clang_getFileLocation(location, &file, &line, &column, &offset);
+    clang_getFileLocation(location, NULL, &line, &column, &offset);
 
     // Get cursor spelling (name)
     CXString cursor_spelling = clang_getCursorSpelling(cursor);
@@ -160,6 +339,7 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
 
             // Create function info
             FunctionInfo func_data = {0};
+            func_data.class_id = CLASS_ID_NONE;
             func_data.name_id = string_pool_intern(&ast_data->project->string_pool, name);
             func_data.location.line = line;
             func_data.location.column = column;
@@ -176,25 +356,39 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
             int num_args = clang_Cursor_getNumArguments(cursor);
             func_data.parameter_count = num_args;
 
-            // Calculate cyclomatic complexity
-            int decision_count = 0;
-            count_decision_points(cursor, &decision_count);
-            func_data.complexity = 1 + decision_count; // Base complexity + decision points
-
-            // Calculate nesting depth
-            int max_nesting = 0;
-            calculate_function_nesting_depth(cursor, &max_nesting);
-            func_data.nesting_depth = max_nesting;
+            // Physical lines spanned by the declaration, including the return type
+            CXSourceRange extent = clang_getCursorExtent(cursor);
+            unsigned start_line, end_line;
+            clang_getFileLocation(clang_getRangeStart(extent), NULL, &start_line, NULL, NULL);
+            clang_getFileLocation(clang_getRangeEnd(extent), NULL, &end_line, NULL, NULL);
+            func_data.lines_of_code = end_line >= start_line ? end_line - start_line + 1 : 1;
 
-            LOG_DEBUG("Function %s complexity: %u, nesting depth: %u", name, func_data.complexity, func_data.nesting_depth);
-
-            // Add to project's function array
+            // Add to project's function array before the body walk, so recursive
+            // calls are counted as usages of this record
             uint32_t func_id;
-            if (project_add_function(ast_data->project, &func_data, &func_id) == CQ_SUCCESS) {
-                LOG_DEBUG("Added function %s with ID %u", name, func_id);
-            } else {
+            if (project_add_function(ast_data->project, &func_data, &func_id) != CQ_SUCCESS) {
                 LOG_ERROR("Failed to add function %s", name);
+                break;
+            }
+            LOG_DEBUG("Added function %s with ID %u", name, func_id);
+
+            FunctionInfo *func = function_array_get(&ast_data->project->functions, func_id);
+            uint32_t prototype = symbol_index_add(&context->symbols, cursor, func_id, true);
+            if (prototype != UINT32_MAX)
+            {
+                // Usages seen before the definition move over from the prototype
+                FunctionInfo *declared = function_array_get(&ast_data->project->functions, prototype);
+                func->usage_count += declared->usage_count;
+                declared->usage_count = 0;
             }
+
+            // Body metrics are only available when bodies were parsed
+            if (parse_function_bodies)
+            {
+                analyze_function_body(cursor, &context->body, func_id, func);
+            }
+
+            LOG_DEBUG("Function %s complexity: %u, nesting depth: %u", name, func->complexity, func->nesting_depth);
             break;
         }
 
@@ -246,6 +440,15 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
             // Add to project's variable array
             uint32_t var_id;
             if (project_add_variable(ast_data->project, &var_data, &var_id) == CQ_SUCCESS) {
+                uint32_t declared_id = symbol_index_add(&context->symbols, cursor, var_id, false);
+                if (declared_id != UINT32_MAX)
+                {
+                    // Usages seen before the definition move over from the extern declaration
+                    VariableInfo *var = variable_array_get(&ast_data->project->variables, var_id);
+                    VariableInfo *declared = variable_array_get(&ast_data->project->variables, declared_id);
+                    var->usage_count += declared->usage_count;
+                    declared->usage_count = 0;
+                }
                 LOG_DEBUG("Added variable %s with ID %u", name, var_id);
             } else {
                 LOG_ERROR("Failed to add variable %s", name);
@@ -253,39 +456,6 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
             break;
         }
 
-        case CXCursor_DeclRefExpr:
-        {
-            // This is a reference to a declared symbol (variable or function usage)
-            LOG_DEBUG("Found reference to: %s at line %u", name, line);
-
-            // Track usage for variables
-            for (uint32_t i = 0; i < ast_data->project->variables.count; i++) {
-                VariableInfo *var = variable_array_get(&ast_data->project->variables, i);
-                if (var) {
-                    const char *var_name = string_pool_get(&ast_data->project->string_pool, var->name_id);
-                    if (strcmp(var_name, name) == 0) {
-                        var->usage_count++;
-                        LOG_DEBUG("Incremented usage count for variable %s to %u", name, var->usage_count);
-                        break;
-                    }
-                }
-            }
-
-            // Track usage for functions
-            for (uint32_t i = 0; i < ast_data->project->functions.count; i++) {
-                FunctionInfo *func = function_array_get(&ast_data->project->functions, i);
-                if (func) {
-                    const char *func_name = string_pool_get(&ast_data->project->string_pool, func->name_id);
-                    if (strcmp(func_name, name) == 0) {
-                        func->usage_count++;
-                        LOG_DEBUG("Incremented usage count for function %s to %u", name, func->usage_count);
-                        break;
-                    }
-                }
-            }
-            break;
-        }
-
         default:
             // Other cursor types can be handled here
             break;
@@ -298,31 +468,13 @@ static enum CXChildVisitResult ast_visitor(CXCursor cursor, CXCursor parent, CXC
 /**
  * @brief Traverse AST and extract information
  */
-static void traverse_ast(CXCursor root_cursor, ASTData *ast_data)
+static void traverse_ast(CXCursor root_cursor, ASTData *ast_data, const char *filepath)
 {
     LOG_INFO("Starting AST traversal");
 
-    // Get file name from translation unit
-    CXFile file;
-    clang_getFileLocation(clang_getCursorLocation(root_cursor), &file, NULL, NULL, NULL);
-    const char *filename_str = NULL;
-    if (file)
-    {
-        CXString filename = clang_getFileName(file);
-        filename_str = clang_getCString(filename);
-        clang_disposeString(filename);
-    }
-
-    // Create file info using proper initialization
-    FileInfo file_info = {0};
-    if (filename_str) {
-        file_info.filepath_id = string_pool_intern(&ast_data->project->string_pool, filename_str);
-    }
-    file_info.language = LANG_C; // Assume C for now, could be detected
-
-    // Add file to project
+    // Add file to project; the language is refined by the caller
     FileInfo *added_file;
-    if (project_add_file(ast_data->project, filename_str, LANG_C, &added_file) != CQ_SUCCESS) {
+    if (project_add_file(ast_data->project, filepath, LANG_C, &added_file) != CQ_SUCCESS) {
         LOG_ERROR("Failed to add file to project");
         return;
     }
@@ -330,12 +482,14 @@ static void traverse_ast(CXCursor root_cursor, ASTData *ast_data)
     // Create visitor context
     VisitorContext context = {
         .ast_data = ast_data,
-        .current_function = NULL,
-        .complexity_count = 0
+        .body = { .ast_data = ast_data }
     };
+    context.body.symbols = &context.symbols;
 
     // Visit all children of the root cursor
     clang_visitChildren(root_cursor, ast_visitor, &context);
+    free(context.body.stack);
+    free(context.symbols.entries);
 
     LOG_INFO("AST traversal completed. Found %u functions, %u classes",
              ast_data->project->total_functions, ast_data->project->total_classes);
@@ -369,30 +523,217 @@ void ast_parser_shutdown(void)
     }
 }
 
-void *parse_source_file(const char *filepath)
+void *ast_parser_create_index(void)
 {
-    if (!filepath)
+    CXIndex index = clang_createIndex(0, 0);
+    if (!index)
     {
-        LOG_ERROR("Invalid filepath for AST parsing");
-        return NULL;
+        LOG_ERROR("Failed to create libclang index");
+    }
+    return index;
+}
+
+void ast_parser_dispose_index(void *index)
+{
+    if (index)
+    {
+        clang_disposeIndex((CXIndex)index);
+    }
+}
+
+/**
+ * @brief Target of ast_parser_visit_included_files()
+ */
+typedef struct
+{
+    IncludedFileCallback callback;
+    void *user_data;
+} InclusionVisitor;
+
+static void inclusion_visitor(CXFile included_file, CXSourceLocation *inclusion_stack, unsigned include_len,
+                              CXClientData client_data)
+{
+    (void)inclusion_stack;
+
+    // The main file is reported with an empty inclusion stack
+    if (include_len == 0)
+    {
+        return;
+    }
+
+    InclusionVisitor *visitor = (InclusionVisitor *)client_data;
+    CXString name = clang_getFileName(included_file);
+    const char *path = clang_getCString(name);
+    if (path && path[0] != '\0')
+    {
+        visitor->callback(path, visitor->user_data);
+    }
+    clang_disposeString(name);
+}
+
+void ast_parser_visit_included_files(void *data, IncludedFileCallback callback, void *user_data)
+{
+    ASTData *ast_data = (ASTData *)data;
+    if (!ast_data || !ast_data->clang_translation_unit || !callback)
+    {
+        return;
+    }
+
+    InclusionVisitor visitor = {callback, user_data};
+    clang_getInclusions((CXTranslationUnit)ast_data->clang_translation_unit, inclusion_visitor, &visitor);
+}
+
+void ast_parser_release_translation_unit(void *data)
+{
+    ASTData *ast_data = (ASTData *)data;
+    if (!ast_data || !ast_data->clang_translation_unit)
+    {
+        return;
+    }
+
+    clang_disposeTranslationUnit((CXTranslationUnit)ast_data->clang_translation_unit);
+    ast_data->clang_translation_unit = NULL;
+    ast_data->clang_index = NULL;
+}
+
+void ast_parser_set_pch_cache(PchCache *cache)
+{
+    pch_cache = cache;
+}
+
+void ast_parser_set_macro_table(MacroTable *table)
+{
+    project_macro_table = table;
+}
+
+void ast_parser_set_compile_database(const CompileDatabase *database)
+{
+    compile_database = database;
+}
+
+void ast_parser_set_profile(AnalysisProfile profile)
+{
+    if (profile == ANALYSIS_PROFILE_DECLARATIONS)
+    {
+        parse_options = CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete;
+        parse_function_bodies = false;
+    }
+    else
+    {
+        parse_options = CXTranslationUnit_None;
+        parse_function_bodies = true;
+    }
+}
+
+/**
+ * @brief Check whether a translation unit hit a fatal error
+ */
+static bool has_fatal_diagnostic(CXTranslationUnit tu)
+{
+    unsigned count = clang_getNumDiagnostics(tu);
+    for (unsigned i = 0; i < count; i++)
+    {
+        CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+        enum CXDiagnosticSeverity severity = clang_getDiagnosticSeverity(diagnostic);
+        clang_disposeDiagnostic(diagnostic);
+        if (severity == CXDiagnostic_Fatal)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Preprocessing state the guessed arguments of a file are borrowed from
+ */
+typedef struct
+{
+    PreprocessingContext *context;
+    const IncludePathSet *include_paths;       // Cached set of the file's directory
+} GuessedArgs;
+
+/**
+ * @brief Build arguments from the file's macros and the include directories
+ *
+ * @return Number of arguments, borrowed from guess until release_guessed_args(), or -1 on error
+ */
+static int build_guessed_args(const char *filepath, const char *project_root, const char *contents, size_t length,
+                              GuessedArgs *guess, const char **args, int max_args)
+{
+    // Initialize preprocessing context
+    guess->context = preprocessor_init();
+    if (!guess->context)
+    {
+        LOG_ERROR("Failed to initialize preprocessing context");
+        return -1;
+    }
+
+    // Use the cached include directories under the file's directory
+    guess->include_paths = preprocessor_include_paths_acquire(project_root);
+    if (!guess->include_paths || preprocessor_use_include_paths(guess->context, guess->include_paths) != CQ_SUCCESS)
+    {
+        LOG_WARNING("Failed to scan include directories");
+    }
+
+    // Macros are interned in the project's table when there is one
+    if (project_macro_table)
+    {
+        preprocessor_use_macro_table(guess->context, project_macro_table);
+    }
+
+    // Extract macros from the source file
+    CQError macro_result = contents ? preprocessor_extract_macros_from_buffer(guess->context, contents, length)
+                                    : preprocessor_extract_macros(guess->context, filepath);
+    if (macro_result != CQ_SUCCESS)
+    {
+        LOG_WARNING("Failed to extract macros from source file");
     }
 
+    return preprocessor_build_args(guess->context, args, max_args);
+}
+
+/**
+ * @brief Free the preprocessing state of a parse
+ */
+static void release_guessed_args(GuessedArgs *guess)
+{
+    preprocessor_free(guess->context);
+    preprocessor_include_paths_release(guess->include_paths);
+}
+
+void *parse_source_file(const char *filepath)
+{
     if (!clang_index)
     {
         LOG_ERROR("Libclang index not initialized");
         return NULL;
     }
 
-    LOG_INFO("Parsing source file: %s", filepath);
+    return parse_source_file_with_index(filepath, clang_index);
+}
 
-    // Initialize preprocessing context
-    PreprocessingContext *preproc_ctx = preprocessor_init();
-    if (!preproc_ctx)
+void *parse_source_file_with_index(const char *filepath, void *index)
+{
+    return parse_source_buffer_with_index(filepath, NULL, 0, index);
+}
+
+void *parse_source_buffer_with_index(const char *filepath, const char *contents, size_t length, void *index)
+{
+    if (!filepath)
     {
-        LOG_ERROR("Failed to initialize preprocessing context");
+        LOG_ERROR("Invalid filepath for AST parsing");
         return NULL;
     }
 
+    if (!index)
+    {
+        LOG_ERROR("Libclang index not initialized");
+        return NULL;
+    }
+
+    LOG_INFO("Parsing source file: %s", filepath);
+
     // Determine project root (simplified - use file's directory)
     char project_root[MAX_PATH_LENGTH];
     char *last_slash = strrchr(filepath, '/');
@@ -414,42 +755,74 @@ void *parse_source_file(const char *filepath)
         strcpy(project_root, ".");
     }
 
-    // Scan for include directories
-    if (preprocessor_scan_includes(preproc_ctx, project_root) != CQ_SUCCESS)
+    // Build command line arguments, leaving room for the PCH arguments
+    const char *args[MAX_PARSE_ARGS];
+    int arg_count;
+    GuessedArgs guess = {0};
+    const CompileCommandArgs *command = compile_database_lookup(compile_database, filepath);
+    if (command)
     {
-        LOG_WARNING("Failed to scan include directories");
+        if (command->arg_count > MAX_PARSE_ARGS - 2)
+        {
+            LOG_WARNING("Compile command of %s has %d arguments, using the first %d", filepath, command->arg_count,
+                        MAX_PARSE_ARGS - 2);
+        }
+        arg_count = command->arg_count < MAX_PARSE_ARGS - 2 ? command->arg_count : MAX_PARSE_ARGS - 2;
+        memcpy(args, command->args, arg_count * sizeof(const char *));
     }
-
-    // Extract macros from the source file
-    if (preprocessor_extract_macros(preproc_ctx, filepath) != CQ_SUCCESS)
+    else
     {
-        LOG_WARNING("Failed to extract macros from source file");
+        arg_count = build_guessed_args(filepath, project_root, contents, length, &guess, args, MAX_PARSE_ARGS - 2);
+        if (arg_count < 0)
+        {
+            return NULL;
+        }
     }
 
-    // Build command line arguments
-    const char *args[100]; // Reasonable maximum
-    int arg_count = preprocessor_build_args(preproc_ctx, args, 100);
+    LOG_DEBUG("Using %d %s arguments for libclang", arg_count, command ? "compile command" : "preprocessing");
 
-    LOG_DEBUG("Using %d preprocessing arguments for libclang", arg_count);
+    // Load the shared precompiled preamble for this file's leading includes, if any
+    const char *pch_path =
+        pch_cache ? pch_cache_acquire(pch_cache, index, filepath, contents, length, args, arg_count) : NULL;
+    int parse_arg_count = arg_count;
+    if (pch_path)
+    {
+        args[parse_arg_count++] = "-include-pch";
+        args[parse_arg_count++] = pch_path;
+    }
 
-    // Parse the file with libclang
+    // Parse the file with libclang, from the loaded contents if the caller has them
+    struct CXUnsavedFile unsaved = {filepath, contents, (unsigned long)length};
+    unsigned unsaved_count = contents ? 1 : 0;
     CXTranslationUnit tu = clang_parseTranslationUnit(
-        clang_index,
+        (CXIndex)index,
         filepath,
-        args, arg_count,    // command line args
-        NULL, 0,    // unsaved files
-        CXTranslationUnit_None
+        args, parse_arg_count,    // command line args
+        &unsaved, unsaved_count,    // unsaved files
+        parse_options
     );
 
-    if (!tu)
+    // A PCH that does not match the file fails the parse; retry from source
+    if (pch_path && (!tu || has_fatal_diagnostic(tu)))
     {
-        LOG_ERROR("Failed to parse translation unit for file: %s", filepath);
-        preprocessor_free(preproc_ctx);
-        // Free allocated args
-        for (int i = 0; i < arg_count; i++)
+        LOG_DEBUG("Precompiled preamble rejected for %s, reparsing without it", filepath);
+        if (tu)
         {
-            free((void *)args[i]);
+            clang_disposeTranslationUnit(tu);
         }
+
+        tu = clang_parseTranslationUnit((CXIndex)index, filepath, args, arg_count, &unsaved, unsaved_count,
+                                        parse_options);
+        if (tu && !has_fatal_diagnostic(tu))
+        {
+            pch_cache_invalidate(pch_cache, pch_path);
+        }
+    }
+
+    if (!tu)
+    {
+        LOG_ERROR("Failed to parse translation unit for file: %s", filepath);
+        release_guessed_args(&guess);
         return NULL;
     }
 
@@ -459,16 +832,11 @@ void *parse_source_file(const char *filepath)
     {
         LOG_ERROR("Memory allocation failed for AST data");
         clang_disposeTranslationUnit(tu);
-        preprocessor_free(preproc_ctx);
-        // Free allocated args
-        for (int i = 0; i < arg_count; i++)
-        {
-            free((void *)args[i]);
-        }
+        release_guessed_args(&guess);
         return NULL;
     }
 
-    ast_data->clang_index = clang_index;
+    ast_data->clang_index = index;
     ast_data->clang_translation_unit = tu;
 
     // Create project structure
@@ -478,12 +846,7 @@ void *parse_source_file(const char *filepath)
         LOG_ERROR("Memory allocation failed for project data");
         free(ast_data);
         clang_disposeTranslationUnit(tu);
-        preprocessor_free(preproc_ctx);
-        // Free allocated args
-        for (int i = 0; i < arg_count; i++)
-        {
-            free((void *)args[i]);
-        }
+        release_guessed_args(&guess);
         return NULL;
     }
 
@@ -493,12 +856,7 @@ void *parse_source_file(const char *filepath)
         free(ast_data->project);
         free(ast_data);
         clang_disposeTranslationUnit(tu);
-        preprocessor_free(preproc_ctx);
-        // Free allocated args
-        for (int i = 0; i < arg_count; i++)
-        {
-            free((void *)args[i]);
-        }
+        release_guessed_args(&guess);
         return NULL;
     }
 
@@ -507,16 +865,10 @@ void *parse_source_file(const char *filepath)
 
     // Traverse AST and extract information
     CXCursor root_cursor = clang_getTranslationUnitCursor(tu);
-    traverse_ast(root_cursor, ast_data);
-
-    // Clean up preprocessing context
-    preprocessor_free(preproc_ctx);
+    traverse_ast(root_cursor, ast_data, filepath);
 
-    // Free allocated args
-    for (int i = 0; i < arg_count; i++)
-    {
-        free((void *)args[i]);
-    }
+    // The arguments are borrowed from the preprocessing state
+    release_guessed_args(&guess);
 
     LOG_INFO("Successfully parsed file: %s", filepath);
     return ast_data;
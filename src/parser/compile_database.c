@@ -0,0 +1,432 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // realpath()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <clang-c/CXCompilationDatabase.h>
+
+#include "parser/compile_database.h"
+#include "utils/config.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+/**
+ * @brief Arguments of one compile command
+ */
+typedef struct
+{
+    char *path;                   // Canonical source file path
+    uint64_t hash;
+    char **args;
+    CompileCommandArgs command;   // View of args handed to callers
+} CompileEntry;
+
+struct CompileDatabase
+{
+    CompileEntry *entries;
+    uint32_t count;
+    uint32_t *index;              // Open-addressing table of entry indices by path
+    uint32_t index_size;
+    int file_count;               // Distinct files; later commands for a file are ignored
+    uint32_t fingerprint;         // Hash of every command's path and arguments, stable across runs
+};
+
+/**
+ * @brief Resolve a path for comparison, keeping it as given if it does not exist
+ */
+static char *canonical_path(const char *path)
+{
+    char resolved[PATH_MAX];
+    return strdup(realpath(path, resolved) ? resolved : path);
+}
+
+/**
+ * @brief Resolve a path given relative to a command's directory
+ */
+static void join_command_path(const char *directory, const char *path, char *joined, size_t size)
+{
+    if (path[0] == '/')
+    {
+        snprintf(joined, size, "%s", path);
+    }
+    else
+    {
+        snprintf(joined, size, "%s/%s", directory, path);
+    }
+}
+
+/**
+ * @brief Check whether an argument names the command's source file, however it is spelled
+ */
+static bool is_source_arg(const char *arg, const char *directory, const CompileEntry *entry)
+{
+    if (arg[0] == '-' || !entry->path)
+    {
+        return false;
+    }
+
+    // Only arguments with the source's file name are resolved
+    const char *arg_name = strrchr(arg, '/');
+    const char *source_name = strrchr(entry->path, '/');
+    arg_name = arg_name ? arg_name + 1 : arg;
+    source_name = source_name ? source_name + 1 : entry->path;
+    if (strcmp(arg_name, source_name) != 0)
+    {
+        return false;
+    }
+
+    char joined[MAX_PATH_LENGTH * 2];
+    join_command_path(directory, arg, joined, sizeof(joined));
+    char *path = canonical_path(joined);
+    bool same = path && strcmp(path, entry->path) == 0;
+    free(path);
+    return same;
+}
+
+/**
+ * @brief Number of arguments to drop at an option that only matters to the build
+ *
+ * @return 0 to keep the argument, 1 to drop it, 2 to drop it and its value
+ */
+static int build_only_arg_count(const char *arg)
+{
+    static const char *const flags[] = {"-c", "-S", "-E", "-M", "-MM", "-MD", "-MMD", "-MP", "-MG"};
+    static const char *const flags_with_value[] = {"-o", "-MF", "-MT", "-MQ"};
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+    {
+        if (strcmp(arg, flags[i]) == 0)
+        {
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(flags_with_value) / sizeof(flags_with_value[0]); i++)
+    {
+        if (strcmp(arg, flags_with_value[i]) == 0)
+        {
+            return 2;
+        }
+        // Joined forms such as -MFdeps.d; -o is only recognized separately
+        if (i > 0 && strncmp(arg, flags_with_value[i], strlen(flags_with_value[i])) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void free_entry(CompileEntry *entry)
+{
+    for (int i = 0; i < entry->command.arg_count; i++)
+    {
+        free(entry->args[i]);
+    }
+    free(entry->args);
+    free(entry->path);
+}
+
+static bool push_arg(CompileEntry *entry, const char *arg)
+{
+    char *copy = strdup(arg);
+    if (!copy)
+    {
+        return false;
+    }
+    entry->args[entry->command.arg_count++] = copy;
+    return true;
+}
+
+/**
+ * @brief Extract the parse arguments of one compile command
+ *
+ * @return false on allocation failure
+ */
+static bool read_command(CXCompileCommand command, CompileEntry *entry)
+{
+    memset(entry, 0, sizeof(*entry));
+
+    CXString directory_string = clang_CompileCommand_getDirectory(command);
+    CXString filename_string = clang_CompileCommand_getFilename(command);
+    const char *directory = clang_getCString(directory_string);
+    const char *filename = clang_getCString(filename_string);
+    directory = directory ? directory : ".";
+    filename = filename ? filename : "";
+
+    // Relative sources are relative to the command's directory
+    char joined[MAX_PATH_LENGTH * 2];
+    join_command_path(directory, filename, joined, sizeof(joined));
+
+    // The compiler is dropped and -working-directory <dir> put first, so that
+    // it survives when a caller truncates a long command
+    unsigned arg_total = clang_CompileCommand_getNumArgs(command);
+    entry->path = canonical_path(joined);
+    entry->args = malloc((arg_total + 2) * sizeof(char *));
+    bool ok = entry->path && entry->args;
+    ok = ok && push_arg(entry, "-working-directory") && push_arg(entry, directory);
+
+    for (unsigned i = 1; ok && i < arg_total; i++)
+    {
+        CXString arg_string = clang_CompileCommand_getArg(command, i);
+        const char *arg = clang_getCString(arg_string);
+        if (!arg || strcmp(arg, "--") == 0)
+        {
+            // Only input files follow "--"
+            clang_disposeString(arg_string);
+            break;
+        }
+
+        int skip = build_only_arg_count(arg);
+        if (skip == 2)
+        {
+            i++;
+        }
+        else if (skip == 0 && strcmp(arg, filename) != 0 && strcmp(arg, joined) != 0 &&
+                 !is_source_arg(arg, directory, entry))
+        {
+            ok = push_arg(entry, arg);
+        }
+        clang_disposeString(arg_string);
+    }
+
+    entry->hash = entry->path ? cq_hash_string(entry->path) : 0;
+    entry->command.args = (const char *const *)entry->args;
+
+    clang_disposeString(filename_string);
+    clang_disposeString(directory_string);
+    return ok;
+}
+
+/**
+ * @brief Index entries by path, keeping the first command of each file
+ */
+static bool build_index(CompileDatabase *database)
+{
+    uint32_t size = 64;
+    while (size < database->count * 2)
+    {
+        size *= 2;
+    }
+
+    database->index = malloc(size * sizeof(uint32_t));
+    if (!database->index)
+    {
+        return false;
+    }
+    memset(database->index, 0xFF, size * sizeof(uint32_t));
+    database->index_size = size;
+
+    for (uint32_t i = 0; i < database->count; i++)
+    {
+        const CompileEntry *entry = &database->entries[i];
+        uint32_t bucket = (uint32_t)(entry->hash & (size - 1));
+        bool duplicate = false;
+        while (database->index[bucket] != UINT32_MAX)
+        {
+            const CompileEntry *other = &database->entries[database->index[bucket]];
+            if (other->hash == entry->hash && strcmp(other->path, entry->path) == 0)
+            {
+                duplicate = true;
+                break;
+            }
+            bucket = (bucket + 1) & (size - 1);
+        }
+        if (!duplicate)
+        {
+            database->index[bucket] = i;
+            database->file_count++;
+        }
+    }
+    return true;
+}
+
+CompileDatabase *compile_database_load(const char *directory)
+{
+    if (!directory)
+    {
+        return NULL;
+    }
+
+    // libclang reports a missing database on stderr, so check for the file first
+    char json_path[MAX_PATH_LENGTH + 32];
+    snprintf(json_path, sizeof(json_path), "%s/compile_commands.json", directory);
+    if (access(json_path, R_OK) != 0)
+    {
+        return NULL;
+    }
+
+    CXCompilationDatabase_Error error = CXCompilationDatabase_NoError;
+    CXCompilationDatabase cx_database = clang_CompilationDatabase_fromDirectory(directory, &error);
+    if (error != CXCompilationDatabase_NoError || !cx_database)
+    {
+        LOG_WARNING("Failed to load compilation database: %s", json_path);
+        if (cx_database)
+        {
+            clang_CompilationDatabase_dispose(cx_database);
+        }
+        return NULL;
+    }
+
+    CXCompileCommands commands = clang_CompilationDatabase_getAllCompileCommands(cx_database);
+    unsigned command_count = commands ? clang_CompileCommands_getSize(commands) : 0;
+
+    CompileDatabase *database = calloc(1, sizeof(CompileDatabase));
+    if (database && command_count > 0)
+    {
+        database->entries = calloc(command_count, sizeof(CompileEntry));
+    }
+    bool ok = database && (command_count == 0 || database->entries);
+    for (unsigned i = 0; ok && i < command_count; i++)
+    {
+        CompileEntry *entry = &database->entries[database->count];
+        ok = read_command(clang_CompileCommands_getCommand(commands, i), entry);
+        if (!ok)
+        {
+            free_entry(entry);
+            break;
+        }
+        database->count++;
+    }
+    ok = ok && build_index(database);
+
+    if (ok)
+    {
+        uint64_t fingerprint = 0;
+        for (uint32_t i = 0; i < database->count; i++)
+        {
+            const CompileEntry *entry = &database->entries[i];
+            fingerprint = cq_hash_combine(fingerprint, entry->hash);
+            fingerprint = cq_hash_combine(fingerprint, (uint64_t)entry->command.arg_count);
+            for (int j = 0; j < entry->command.arg_count; j++)
+            {
+                fingerprint = cq_hash_combine(fingerprint, cq_hash_string(entry->args[j]));
+            }
+        }
+        database->fingerprint = (uint32_t)(fingerprint ^ (fingerprint >> 32));
+    }
+
+    if (commands)
+    {
+        clang_CompileCommands_dispose(commands);
+    }
+    clang_CompilationDatabase_dispose(cx_database);
+
+    if (!ok)
+    {
+        LOG_ERROR("Memory allocation failed for compilation database");
+        compile_database_destroy(database);
+        return NULL;
+    }
+    if (database->file_count == 0)
+    {
+        LOG_WARNING("Compilation database has no commands: %s", json_path);
+        compile_database_destroy(database);
+        return NULL;
+    }
+
+    LOG_INFO("Loaded compile commands for %d file(s) from %s", database->file_count, json_path);
+    return database;
+}
+
+CompileDatabase *compile_database_load_for_project(const char *project_path)
+{
+    const Config *config = config_get();
+    if (!project_path || (config && !config->use_compile_commands))
+    {
+        return NULL;
+    }
+
+    char directory[MAX_PATH_LENGTH * 2];
+    const char *configured = config ? config->compile_commands_dir : "";
+    if (configured[0] != '\0')
+    {
+        if (configured[0] == '/')
+        {
+            snprintf(directory, sizeof(directory), "%s", configured);
+        }
+        else
+        {
+            snprintf(directory, sizeof(directory), "%s/%s", project_path, configured);
+        }
+
+        CompileDatabase *database = compile_database_load(directory);
+        if (!database)
+        {
+            LOG_WARNING("No usable compile_commands.json in %s, guessing compiler flags", directory);
+        }
+        return database;
+    }
+
+    // Builds usually write the database next to the sources or into build/
+    static const char *const candidates[] = {"", "/build"};
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++)
+    {
+        snprintf(directory, sizeof(directory), "%s%s", project_path, candidates[i]);
+        CompileDatabase *database = compile_database_load(directory);
+        if (database)
+        {
+            return database;
+        }
+    }
+    return NULL;
+}
+
+void compile_database_destroy(CompileDatabase *database)
+{
+    if (!database)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < database->count; i++)
+    {
+        free_entry(&database->entries[i]);
+    }
+    free(database->entries);
+    free(database->index);
+    free(database);
+}
+
+uint32_t compile_database_fingerprint(const CompileDatabase *database)
+{
+    return database ? database->fingerprint : 0;
+}
+
+int compile_database_file_count(const CompileDatabase *database)
+{
+    return database ? database->file_count : 0;
+}
+
+const CompileCommandArgs *compile_database_lookup(const CompileDatabase *database, const char *filepath)
+{
+    if (!database || !filepath || database->index_size == 0)
+    {
+        return NULL;
+    }
+
+    char *path = canonical_path(filepath);
+    if (!path)
+    {
+        return NULL;
+    }
+
+    uint64_t hash = cq_hash_string(path);
+    uint32_t bucket = (uint32_t)(hash & (database->index_size - 1));
+    const CompileCommandArgs *result = NULL;
+    while (database->index[bucket] != UINT32_MAX)
+    {
+        const CompileEntry *entry = &database->entries[database->index[bucket]];
+        if (entry->hash == hash && strcmp(entry->path, path) == 0)
+        {
+            result = &entry->command;
+            break;
+        }
+        bucket = (bucket + 1) & (database->index_size - 1);
+    }
+
+    free(path);
+    return result;
+}
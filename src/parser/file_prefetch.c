@@ -0,0 +1,669 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "parser/file_prefetch.h"
+#include "utils/logger.h"
+
+// Default number of reader threads when io_uring is unavailable
+#define DEFAULT_PREFETCH_THREADS 4
+
+// Loaded files queued per reader thread before readers wait for the consumers
+#define PREFETCH_FILES_PER_READER 16
+
+// Reads kept in flight on the io_uring
+#define PREFETCH_URING_DEPTH 32
+
+struct FilePrefetch
+{
+    FileScan *scan;
+    size_t memory_budget;
+    bool pass_through;            // Zero budget: files are taken from the scan on request
+
+    // Ring of files ready for the consumers
+    pthread_mutex_t mutex;
+    pthread_cond_t ready_cond;    // A file was queued or the readers finished
+    pthread_cond_t space_cond;    // A queue slot or memory was released
+    PrefetchedFile *queue;
+    int capacity;
+    int head;
+    int count;
+    int reading;                  // Files taken from the scan and not queued yet
+    size_t bytes_held;            // Memory of files being loaded, queued or handed out
+    int readers_running;
+    bool cancelled;
+
+    pthread_t *threads;
+    int thread_count;
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+    bool use_uring;
+#endif
+};
+
+/**
+ * @brief Memory needed to load a file, or 0 if it cannot be loaded
+ */
+static size_t file_memory(const FilePrefetch *prefetch, long long size)
+{
+    if (size < 0 || (unsigned long long)size >= prefetch->memory_budget)
+    {
+        return 0;
+    }
+    return (size_t)size + 1;
+}
+
+/**
+ * @brief Check whether a file taken from the scan can be admitted; caller holds the mutex
+ */
+static bool file_fits(const FilePrefetch *prefetch, size_t needed)
+{
+    if (prefetch->count + prefetch->reading >= prefetch->capacity)
+    {
+        return false;
+    }
+    return needed == 0 || prefetch->cancelled || prefetch->bytes_held + needed <= prefetch->memory_budget;
+}
+
+/**
+ * @brief Admit a file that fits; caller holds the mutex
+ *
+ * @return true if memory was reserved to load the file
+ */
+static bool admit_file(FilePrefetch *prefetch, size_t needed)
+{
+    prefetch->reading++;
+    if (needed == 0 || prefetch->cancelled)
+    {
+        return false;
+    }
+    prefetch->bytes_held += needed;
+    return true;
+}
+
+/**
+ * @brief Hand a file to the consumers, returning its reservation if it was not loaded
+ */
+static void queue_file(FilePrefetch *prefetch, const PrefetchedFile *file, bool reserved)
+{
+    pthread_mutex_lock(&prefetch->mutex);
+    if (reserved && !file->contents)
+    {
+        prefetch->bytes_held -= file_memory(prefetch, file->size);
+        pthread_cond_broadcast(&prefetch->space_cond);
+    }
+    prefetch->reading--;
+    PrefetchedFile *queued = &prefetch->queue[(prefetch->head + prefetch->count) % prefetch->capacity];
+    *queued = *file;
+    queued->budgeted = reserved && file->contents;
+    prefetch->count++;
+    pthread_cond_signal(&prefetch->ready_cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+}
+
+static void reader_done(FilePrefetch *prefetch)
+{
+    pthread_mutex_lock(&prefetch->mutex);
+    prefetch->readers_running--;
+    pthread_cond_broadcast(&prefetch->ready_cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+}
+
+/**
+ * @brief Open a file for loading if it still has the size the scan reported
+ *
+ * A file that changed since the scan is left for the parser to read. The
+ * modification time is taken from the same fstat(), so it describes the
+ * contents read from the descriptor.
+ *
+ * @return File descriptor, or -1
+ */
+static int open_scanned_file(PrefetchedFile *file)
+{
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != file->size)
+    {
+        close(fd);
+        return -1;
+    }
+    file->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return fd;
+}
+
+/**
+ * @brief Load a file with blocking reads
+ */
+static void read_file(PrefetchedFile *file)
+{
+    int fd = open_scanned_file(file);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    size_t size = (size_t)file->size;
+    char *buffer = malloc(size + 1);
+    size_t done = 0;
+    while (buffer && done < size)
+    {
+        ssize_t n = read(fd, buffer + done, size - done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+
+    if (!buffer || done != size)
+    {
+        free(buffer);
+        return;
+    }
+    buffer[size] = '\0';
+    file->contents = buffer;
+    file->length = size;
+}
+
+/**
+ * @brief Reader thread: loads files from the scan with blocking reads
+ */
+static void *prefetch_reader(void *arg)
+{
+    FilePrefetch *prefetch = (FilePrefetch *)arg;
+
+    PrefetchedFile file;
+    while (file_scan_next(prefetch->scan, &file.path, &file.size))
+    {
+        file.contents = NULL;
+        file.length = 0;
+        file.mtime_ns = 0;
+
+        size_t needed = file_memory(prefetch, file.size);
+        pthread_mutex_lock(&prefetch->mutex);
+        while (!file_fits(prefetch, needed))
+        {
+            pthread_cond_wait(&prefetch->space_cond, &prefetch->mutex);
+        }
+        bool reserved = admit_file(prefetch, needed);
+        pthread_mutex_unlock(&prefetch->mutex);
+
+        if (reserved)
+        {
+            read_file(&file);
+        }
+        queue_file(prefetch, &file, reserved);
+    }
+
+    reader_done(prefetch);
+    return NULL;
+}
+
+#ifdef HAVE_LIBURING
+
+/**
+ * @brief Load in flight on the io_uring
+ */
+typedef struct
+{
+    PrefetchedFile file;
+    int fd;
+    size_t done;     // Bytes read so far
+    bool busy;
+} UringRead;
+
+/**
+ * @brief Queue the read of the rest of a file
+ *
+ * A read that could not be submitted right away stays queued and goes out
+ * with the next submission (see uring_wait()).
+ *
+ * @return false if no submission entry was available
+ */
+static bool uring_submit_read(struct io_uring *ring, UringRead *read)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+    if (!sqe)
+    {
+        return false;
+    }
+
+    size_t size = (size_t)read->file.size;
+    io_uring_prep_read(sqe, read->fd, read->file.contents + read->done, (unsigned)(size - read->done),
+                       (__u64)read->done);
+    io_uring_sqe_set_data(sqe, read);
+    io_uring_submit(ring);
+    return true;
+}
+
+/**
+ * @brief Start loading a file on the io_uring
+ *
+ * @return true if a read is in flight; otherwise the file is complete, with
+ *         contents only if it is empty
+ */
+static bool uring_start_read(struct io_uring *ring, UringRead *read)
+{
+    read->fd = open_scanned_file(&read->file);
+    if (read->fd == -1)
+    {
+        return false;
+    }
+
+    read->file.contents = malloc((size_t)read->file.size + 1);
+    read->done = 0;
+    if (read->file.contents && read->file.size > 0 && uring_submit_read(ring, read))
+    {
+        read->busy = true;
+        return true;
+    }
+
+    close(read->fd);
+    if (read->file.contents && read->file.size > 0)
+    {
+        free(read->file.contents);
+        read->file.contents = NULL;
+    }
+    else if (read->file.contents)
+    {
+        read->file.contents[0] = '\0';
+    }
+    return false;
+}
+
+/**
+ * @brief Handle a completed read, continuing short reads
+ *
+ * @return true if the file is finished and was queued
+ */
+static bool uring_complete_read(FilePrefetch *prefetch, struct io_uring_cqe *cqe)
+{
+    UringRead *read = io_uring_cqe_get_data(cqe);
+    int res = cqe->res;
+    io_uring_cqe_seen(&prefetch->ring, cqe);
+
+    size_t size = (size_t)read->file.size;
+    if (res > 0)
+    {
+        read->done += (size_t)res;
+    }
+    bool retry = res == -EINTR || res == -EAGAIN || (res > 0 && read->done < size);
+    if (retry && uring_submit_read(&prefetch->ring, read))
+    {
+        return false;
+    }
+
+    close(read->fd);
+    if (read->done == size)
+    {
+        read->file.contents[size] = '\0';
+        read->file.length = size;
+    }
+    else
+    {
+        free(read->file.contents);
+        read->file.contents = NULL;
+    }
+    read->busy = false;
+    queue_file(prefetch, &read->file, true);
+    return true;
+}
+
+/**
+ * @brief Wait for one completion
+ *
+ * @return true if a file was finished
+ */
+static bool uring_wait(FilePrefetch *prefetch)
+{
+    struct io_uring_cqe *cqe;
+    io_uring_submit(&prefetch->ring);
+    int res = io_uring_wait_cqe(&prefetch->ring, &cqe);
+    if (res < 0)
+    {
+        // Interrupted; the caller waits again
+        return false;
+    }
+    return uring_complete_read(prefetch, cqe);
+}
+
+/**
+ * @brief Reader thread: keeps up to PREFETCH_URING_DEPTH loads in flight on the io_uring
+ *
+ * Completions are collected between scan results and whenever the reader
+ * has to wait for memory, since the memory may be held by its own reads.
+ */
+static void *prefetch_uring_reader(void *arg)
+{
+    FilePrefetch *prefetch = (FilePrefetch *)arg;
+
+    UringRead reads[PREFETCH_URING_DEPTH] = {0};
+    int in_flight = 0;
+    bool scanning = true;
+
+    while (scanning || in_flight > 0)
+    {
+        struct io_uring_cqe *cqe;
+        while (in_flight > 0 && io_uring_peek_cqe(&prefetch->ring, &cqe) == 0)
+        {
+            if (uring_complete_read(prefetch, cqe))
+            {
+                in_flight--;
+            }
+        }
+
+        if (!scanning || in_flight == PREFETCH_URING_DEPTH)
+        {
+            if (in_flight > 0 && uring_wait(prefetch))
+            {
+                in_flight--;
+            }
+            continue;
+        }
+
+        PrefetchedFile file = {0};
+        if (!file_scan_next(prefetch->scan, &file.path, &file.size))
+        {
+            scanning = false;
+            continue;
+        }
+
+        size_t needed = file_memory(prefetch, file.size);
+        pthread_mutex_lock(&prefetch->mutex);
+        while (!file_fits(prefetch, needed))
+        {
+            if (in_flight > 0)
+            {
+                pthread_mutex_unlock(&prefetch->mutex);
+                if (uring_wait(prefetch))
+                {
+                    in_flight--;
+                }
+                pthread_mutex_lock(&prefetch->mutex);
+                continue;
+            }
+            pthread_cond_wait(&prefetch->space_cond, &prefetch->mutex);
+        }
+        bool reserved = admit_file(prefetch, needed);
+        pthread_mutex_unlock(&prefetch->mutex);
+
+        if (reserved)
+        {
+            UringRead *read = reads;
+            while (read->busy)
+            {
+                read++;
+            }
+            read->file = file;
+            if (uring_start_read(&prefetch->ring, read))
+            {
+                in_flight++;
+                continue;
+            }
+            file = read->file;
+        }
+        queue_file(prefetch, &file, reserved);
+    }
+
+    reader_done(prefetch);
+    return NULL;
+}
+
+#endif // HAVE_LIBURING
+
+static void file_prefetch_free(FilePrefetch *prefetch)
+{
+    for (int i = 0; i < prefetch->count; i++)
+    {
+        PrefetchedFile *file = &prefetch->queue[(prefetch->head + i) % prefetch->capacity];
+        free(file->contents);
+        free(file->path);
+    }
+#ifdef HAVE_LIBURING
+    if (prefetch->use_uring)
+    {
+        io_uring_queue_exit(&prefetch->ring);
+    }
+#endif
+    pthread_cond_destroy(&prefetch->space_cond);
+    pthread_cond_destroy(&prefetch->ready_cond);
+    pthread_mutex_destroy(&prefetch->mutex);
+    free(prefetch->queue);
+    free(prefetch->threads);
+    free(prefetch);
+}
+
+FilePrefetch *file_prefetch_start(FileScan *scan, int thread_count, size_t memory_budget)
+{
+    if (!scan)
+    {
+        LOG_ERROR("Invalid arguments to file_prefetch_start");
+        return NULL;
+    }
+
+    FilePrefetch *prefetch = calloc(1, sizeof(FilePrefetch));
+    if (!prefetch)
+    {
+        LOG_ERROR("Memory allocation failed for file prefetch");
+        return NULL;
+    }
+    prefetch->scan = scan;
+    prefetch->memory_budget = memory_budget;
+    prefetch->pass_through = memory_budget == 0;
+    if (pthread_mutex_init(&prefetch->mutex, NULL) != 0)
+    {
+        free(prefetch);
+        return NULL;
+    }
+    if (pthread_cond_init(&prefetch->ready_cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&prefetch->mutex);
+        free(prefetch);
+        return NULL;
+    }
+    if (pthread_cond_init(&prefetch->space_cond, NULL) != 0)
+    {
+        pthread_cond_destroy(&prefetch->ready_cond);
+        pthread_mutex_destroy(&prefetch->mutex);
+        free(prefetch);
+        return NULL;
+    }
+    if (prefetch->pass_through)
+    {
+        return prefetch;
+    }
+
+    if (thread_count <= 0)
+    {
+        thread_count = DEFAULT_PREFETCH_THREADS;
+    }
+    void *(*reader)(void *) = prefetch_reader;
+    prefetch->capacity = thread_count * PREFETCH_FILES_PER_READER;
+
+#ifdef HAVE_LIBURING
+    // One thread drives the ring; the kernel may refuse io_uring (e.g. under seccomp)
+    int res = io_uring_queue_init(PREFETCH_URING_DEPTH, &prefetch->ring, 0);
+    if (res == 0)
+    {
+        prefetch->use_uring = true;
+        reader = prefetch_uring_reader;
+        thread_count = 1;
+        prefetch->capacity = 2 * PREFETCH_URING_DEPTH;
+        LOG_DEBUG("Prefetching files with io_uring");
+    }
+    else
+    {
+        LOG_DEBUG("io_uring unavailable (%s), prefetching files with reader threads", strerror(-res));
+    }
+#endif
+
+    prefetch->queue = calloc(prefetch->capacity, sizeof(PrefetchedFile));
+    prefetch->threads = calloc(thread_count, sizeof(pthread_t));
+    if (!prefetch->queue || !prefetch->threads)
+    {
+        LOG_ERROR("Memory allocation failed for file prefetch");
+        file_prefetch_free(prefetch);
+        return NULL;
+    }
+
+    prefetch->readers_running = thread_count;
+    for (int t = 0; t < thread_count; t++)
+    {
+        if (pthread_create(&prefetch->threads[t], NULL, reader, prefetch) != 0)
+        {
+            LOG_WARNING("Failed to start prefetch thread %d", t);
+            pthread_mutex_lock(&prefetch->mutex);
+            prefetch->readers_running -= thread_count - t;
+            pthread_cond_broadcast(&prefetch->ready_cond);
+            pthread_mutex_unlock(&prefetch->mutex);
+            break;
+        }
+        prefetch->thread_count++;
+    }
+
+    // Without any reader, files are taken from the scan as they are requested
+    if (prefetch->thread_count == 0)
+    {
+        prefetch->pass_through = true;
+    }
+
+    return prefetch;
+}
+
+bool file_prefetch_next(FilePrefetch *prefetch, PrefetchedFile *file)
+{
+    if (!prefetch || !file)
+    {
+        return false;
+    }
+
+    memset(file, 0, sizeof(*file));
+    if (prefetch->pass_through)
+    {
+        return file_scan_next(prefetch->scan, &file->path, &file->size);
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    while (prefetch->count == 0 && prefetch->readers_running > 0)
+    {
+        pthread_cond_wait(&prefetch->ready_cond, &prefetch->mutex);
+    }
+    if (prefetch->count == 0)
+    {
+        pthread_mutex_unlock(&prefetch->mutex);
+        return false;
+    }
+
+    // Hand out the largest buffered file, so that a big file starts early
+    // instead of setting the tail of the run; the head fills its slot
+    int largest = prefetch->head;
+    for (int i = 1; i < prefetch->count; i++)
+    {
+        int slot = (prefetch->head + i) % prefetch->capacity;
+        if (prefetch->queue[slot].size > prefetch->queue[largest].size)
+        {
+            largest = slot;
+        }
+    }
+    *file = prefetch->queue[largest];
+    prefetch->queue[largest] = prefetch->queue[prefetch->head];
+    prefetch->head = (prefetch->head + 1) % prefetch->capacity;
+    prefetch->count--;
+    pthread_cond_broadcast(&prefetch->space_cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+    return true;
+}
+
+bool file_prefetch_load(PrefetchedFile *file)
+{
+    if (!file || !file->path)
+    {
+        return false;
+    }
+
+    if (!file->contents)
+    {
+        read_file(file);
+    }
+    return file->contents != NULL;
+}
+
+void file_prefetch_release(FilePrefetch *prefetch, PrefetchedFile *file)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    if (prefetch && file->budgeted)
+    {
+        pthread_mutex_lock(&prefetch->mutex);
+        prefetch->bytes_held -= file_memory(prefetch, file->size);
+        pthread_cond_broadcast(&prefetch->space_cond);
+        pthread_mutex_unlock(&prefetch->mutex);
+    }
+
+    free(file->contents);
+    free(file->path);
+    memset(file, 0, sizeof(*file));
+}
+
+void file_prefetch_cancel(FilePrefetch *prefetch)
+{
+    if (!prefetch)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    prefetch->cancelled = true;
+    pthread_cond_broadcast(&prefetch->space_cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+
+    file_scan_cancel(prefetch->scan);
+}
+
+void file_prefetch_finish(FilePrefetch *prefetch)
+{
+    if (!prefetch)
+    {
+        return;
+    }
+
+    // Readers exit once the cancelled scan runs dry, which needs queue space
+    file_prefetch_cancel(prefetch);
+    if (!prefetch->pass_through)
+    {
+        PrefetchedFile file;
+        while (file_prefetch_next(prefetch, &file))
+        {
+            file_prefetch_release(prefetch, &file);
+        }
+    }
+    for (int t = 0; t < prefetch->thread_count; t++)
+    {
+        pthread_join(prefetch->threads[t], NULL);
+    }
+
+    file_prefetch_free(prefetch);
+}
@@ -1,31 +1,274 @@
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // d_type constants
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <errno.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 #include "parser/file_scanner.h"
+#include "parser/path_filter.h"
 #include "utils/logger.h"
 
+// Default number of found files buffered ahead of the consumer
+#define DEFAULT_SCAN_BUFFER_CAPACITY 1024
+
+// Upper bound for the default number of scanner threads
+#define MAX_DEFAULT_SCAN_THREADS 8
+
 /**
- * @brief Helper function for recursive directory scanning
+ * @brief Slot of the output ring buffer
+ *
+ * The sequence number tells producers and consumers whose turn the slot is:
+ * equal to the position when free, position + 1 once a file is published.
+ */
+typedef struct
+{
+    atomic_size_t sequence;
+    char *path;
+    long long size;
+} ScanSlot;
+
+/**
+ * @brief Directory waiting to be read
+ */
+typedef struct
+{
+    char *path;
+    int depth;              // Levels below the scan root
+    PathFilterDir *ignore;  // .gitignore rules of the parent directory
+} ScanDir;
+
+struct FileScan
+{
+    // Bounded lock-free multi-producer multi-consumer output buffer
+    ScanSlot *slots;
+    size_t slot_mask;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+
+    // Work queue of directories still to be read
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    ScanDir *dirs;
+    int dir_count;
+    int dir_capacity;
+    int dirs_pending;             // Queued or being read
+
+    pthread_t *threads;
+    int thread_count;
+    pthread_t count_thread;         // Directory-count pre-pass
+    bool has_count_thread;
+    char *root;
+    size_t root_len;
+    const PathFilter *filter;       // Exclusion rules, or NULL
+    atomic_int producers_running;
+    atomic_bool failed;
+    atomic_bool cancelled;
+
+    atomic_int dirs_discovered;
+    atomic_int dirs_scanned;
+    atomic_int dirs_counted;        // Result of the pre-pass, -1 until it is done
+    atomic_int files_found;
+    atomic_int files_returned;
+};
+
+static bool scan_stopped(const FileScan *scan)
+{
+    return atomic_load(&scan->failed) || atomic_load(&scan->cancelled);
+}
+
+/**
+ * @brief Wait a little before retrying a full or empty output buffer
+ */
+static void scan_backoff(int *spins)
+{
+    if (*spins < 16)
+    {
+        sched_yield();
+    }
+    else
+    {
+        struct timespec delay = {0, *spins < 64 ? 50000 : 1000000};
+        nanosleep(&delay, NULL);
+    }
+    (*spins)++;
+}
+
+static bool scan_try_enqueue(FileScan *scan, char *path, long long size)
+{
+    size_t pos = atomic_load_explicit(&scan->enqueue_pos, memory_order_relaxed);
+    for (;;)
+    {
+        ScanSlot *slot = &scan->slots[pos & scan->slot_mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&scan->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                slot->path = path;
+                slot->size = size;
+                atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // Full
+        }
+        else
+        {
+            pos = atomic_load_explicit(&scan->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static bool scan_try_dequeue(FileScan *scan, char **path, long long *size)
+{
+    size_t pos = atomic_load_explicit(&scan->dequeue_pos, memory_order_relaxed);
+    for (;;)
+    {
+        ScanSlot *slot = &scan->slots[pos & scan->slot_mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&scan->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *path = slot->path;
+                if (size)
+                {
+                    *size = slot->size;
+                }
+                atomic_store_explicit(&slot->sequence, pos + scan->slot_mask + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // Empty
+        }
+        else
+        {
+            pos = atomic_load_explicit(&scan->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Publish a found file, waiting while the consumer catches up
+ *
+ * @return true if published, false if the scan was stopped (path is freed)
+ */
+static bool scan_publish_file(FileScan *scan, char *path, long long size)
+{
+    int spins = 0;
+    while (!scan_try_enqueue(scan, path, size))
+    {
+        if (scan_stopped(scan))
+        {
+            free(path);
+            return false;
+        }
+        scan_backoff(&spins);
+    }
+    atomic_fetch_add(&scan->files_found, 1);
+    return true;
+}
+
+/**
+ * @brief Path relative to the scan root ("" for the root itself)
+ */
+static const char *scan_relative_path(const FileScan *scan, const char *path)
+{
+    return strlen(path) > scan->root_len ? path + scan->root_len + 1 : "";
+}
+
+/**
+ * @brief Check whether a subdirectory is to be scanned, before it is opened
+ */
+static bool scan_wants_dir(const FileScan *scan, const PathFilterDir *ignore, const char *path, int depth)
+{
+    return path_filter_allows_depth(scan->filter, depth) &&
+           !path_filter_excludes(scan->filter, ignore, scan_relative_path(scan, path), true);
+}
+
+/**
+ * @brief Add a directory to the work queue
+ */
+static bool scan_push_dir(FileScan *scan, const char *path, int depth, PathFilterDir *ignore)
+{
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        LOG_ERROR("Memory allocation failed for directory path");
+        return false;
+    }
+
+    pthread_mutex_lock(&scan->mutex);
+    if (scan->dir_count == scan->dir_capacity)
+    {
+        int new_capacity = scan->dir_capacity ? scan->dir_capacity * 2 : 64;
+        ScanDir *new_dirs = realloc(scan->dirs, new_capacity * sizeof(ScanDir));
+        if (!new_dirs)
+        {
+            pthread_mutex_unlock(&scan->mutex);
+            LOG_ERROR("Memory allocation failed for directory queue");
+            free(copy);
+            return false;
+        }
+        scan->dirs = new_dirs;
+        scan->dir_capacity = new_capacity;
+    }
+    scan->dirs[scan->dir_count++] = (ScanDir){copy, depth, path_filter_dir_retain(ignore)};
+    scan->dirs_pending++;
+    pthread_cond_signal(&scan->cond);
+    pthread_mutex_unlock(&scan->mutex);
+
+    atomic_fetch_add(&scan->dirs_discovered, 1);
+    return true;
+}
+
+static bool is_any_source_file(const char *filename)
+{
+    SupportedLanguage langs[] = {LANG_C, LANG_CPP, LANG_JAVA, LANG_PYTHON, LANG_JAVASCRIPT, LANG_TYPESCRIPT};
+    for (size_t i = 0; i < sizeof(langs) / sizeof(langs[0]); i++)
+    {
+        if (is_source_file(filename, langs[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Read one directory, queueing subdirectories and publishing source files
+ *
+ * The entry type from readdir() decides most entries without a stat; only
+ * source files (for their size) and file systems without d_type are stat'ed,
+ * relative to the open directory. Excluded subdirectories are never queued.
  *
- * @param path Current directory path
- * @param files Array to store found file paths
- * @param max_files Maximum number of files to find
- * @param count Current count of files found
- * @param progress_callback Optional progress callback
- * @param total_dirs Total directories to scan (for progress estimation)
- * @param current_dir Current directory counter
  * @return 0 on success, -1 on error
  */
-static int scan_directory_recursive(const char *path, char **files, int max_files, int *count,
-                                    ProgressCallback progress_callback, int total_dirs, int *current_dir)
+static int scan_one_directory(FileScan *scan, const ScanDir *item)
 {
+    const char *path = item->path;
     DIR *dir = opendir(path);
     if (!dir)
     {
@@ -49,21 +292,40 @@ static int scan_directory_recursive(const char *path, char **files, int max_file
         return -1;
     }
 
-    // Report progress for directory scanning
-    if (progress_callback && total_dirs > 0)
-    {
-        (*current_dir)++;
-        char status_msg[256];
-        snprintf(status_msg, sizeof(status_msg), "Scanning directory: %s", path);
-        progress_callback(*current_dir, total_dirs, status_msg);
-    }
+    PathFilterDir *ignore = path_filter_enter(scan->filter, item->ignore, dirfd(dir), scan_relative_path(scan, path));
+    int result = 0;
 
     struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL)
+    while (!scan_stopped(scan) && (entry = readdir(dir)) != NULL)
     {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
 
+        bool is_dir = false;
+        bool is_regular = false;
+        bool need_stat = true;
+#ifdef DT_UNKNOWN
+        if (entry->d_type == DT_DIR)
+        {
+            is_dir = true;
+            need_stat = false;
+        }
+        else if (entry->d_type == DT_REG)
+        {
+            is_regular = true;
+            need_stat = false;
+        }
+        else if (entry->d_type != DT_UNKNOWN)
+        {
+            // Symbolic links are ignored to prevent cycles and permission issues
+            continue;
+        }
+#endif
+
+        // Regular files only matter if they are source files
+        if (!need_stat && is_regular && !is_any_source_file(entry->d_name))
+            continue;
+
         char full_path[MAX_PATH_LENGTH];
         int ret = snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
         if (ret < 0 || ret >= (int)sizeof(full_path))
@@ -72,77 +334,551 @@ static int scan_directory_recursive(const char *path, char **files, int max_file
             continue;
         }
 
+        // Known entry types are filtered before any stat, unknown ones once stat'ed
+        const char *rel_path = scan_relative_path(scan, full_path);
+        if (!need_stat && path_filter_excludes(scan->filter, ignore, rel_path, is_dir))
+            continue;
+
         struct stat st;
-        if (lstat(full_path, &st) == -1)
+        st.st_size = 0;
+        if (need_stat || is_regular)
         {
-            // Handle specific stat errors
-            if (errno == EACCES)
+            if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1)
             {
-                LOG_WARNING("Permission denied accessing file: %s", full_path);
+                // Handle specific stat errors
+                if (errno == EACCES)
+                {
+                    LOG_WARNING("Permission denied accessing file: %s", full_path);
+                }
+                else if (errno == ENOENT)
+                {
+                    LOG_WARNING("File no longer exists: %s", full_path);
+                }
+                else if (errno == ENOTDIR)
+                {
+                    LOG_WARNING("Path component is not a directory: %s", full_path);
+                }
+                else
+                {
+                    LOG_WARNING("Failed to stat file: %s (errno: %d)", full_path, errno);
+                }
+                continue;
             }
-            else if (errno == ENOENT)
+            is_dir = S_ISDIR(st.st_mode);
+            is_regular = S_ISREG(st.st_mode);
+            if (need_stat && path_filter_excludes(scan->filter, ignore, rel_path, is_dir))
+                continue;
+        }
+
+        if (is_dir)
+        {
+            if (!path_filter_allows_depth(scan->filter, item->depth + 1))
+                continue;
+            if (!scan_push_dir(scan, full_path, item->depth + 1, ignore))
             {
-                LOG_WARNING("File no longer exists: %s", full_path);
+                result = -1;
+                break;
             }
-            else if (errno == ENOTDIR)
+        }
+        else if (is_regular && is_any_source_file(entry->d_name))
+        {
+            char *file = strdup(full_path);
+            if (!file)
             {
-                LOG_WARNING("Path component is not a directory: %s", full_path);
+                LOG_ERROR("Memory allocation failed for file path");
+                result = -1;
+                break;
             }
-            else
+            if (!scan_publish_file(scan, file, (long long)st.st_size))
             {
-                LOG_WARNING("Failed to stat file: %s (errno: %d)", full_path, errno);
+                break;
             }
-            continue;
         }
+        // Symbolic links are ignored to prevent cycles and permission issues
+    }
+
+    path_filter_dir_release(ignore);
+    closedir(dir);
+    return result;
+}
+
+/**
+ * @brief Stack of directory paths still to be counted
+ */
+typedef struct
+{
+    ScanDir *dirs;
+    int count;
+    int capacity;
+} DirStack;
 
-        if (S_ISDIR(st.st_mode))
+static bool dir_stack_push(DirStack *stack, const char *path, int depth, PathFilterDir *ignore)
+{
+    if (stack->count == stack->capacity)
+    {
+        int new_capacity = stack->capacity ? stack->capacity * 2 : 64;
+        ScanDir *new_dirs = realloc(stack->dirs, new_capacity * sizeof(ScanDir));
+        if (!new_dirs)
         {
-            // Recurse into subdirectory
-            if (scan_directory_recursive(full_path, files, max_files, count,
-                                       progress_callback, total_dirs, current_dir) == -1)
-            {
-                closedir(dir);
-                return -1;
-            }
+            return false;
         }
-        else if (S_ISREG(st.st_mode))
+        stack->dirs = new_dirs;
+        stack->capacity = new_capacity;
+    }
+
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        return false;
+    }
+    stack->dirs[stack->count++] = (ScanDir){copy, depth, path_filter_dir_retain(ignore)};
+    return true;
+}
+
+/**
+ * @brief Queue a subdirectory for counting if the scan will read it
+ */
+static bool count_subdirectory(const FileScan *scan, DirStack *stack, const ScanDir *parent,
+                               PathFilterDir *ignore, const char *name)
+{
+    char path[MAX_PATH_LENGTH];
+    int ret = snprintf(path, sizeof(path), "%s/%s", parent->path, name);
+    if (ret < 0 || ret >= (int)sizeof(path))
+    {
+        return true; // Skipped by the scan as well
+    }
+    if (!scan_wants_dir(scan, ignore, path, parent->depth + 1))
+    {
+        return true;
+    }
+    return dir_stack_push(stack, path, parent->depth + 1, ignore);
+}
+
+/**
+ * @brief Check whether a directory entry is a subdirectory, without following links
+ */
+static bool is_subdirectory(int dir_fd, const char *name, unsigned char type)
+{
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+        return false;
+    }
+#ifdef DT_UNKNOWN
+    if (type != DT_UNKNOWN)
+    {
+        return type == DT_DIR;
+    }
+#else
+    (void)type;
+#endif
+    struct stat st;
+    return fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+/**
+ * @brief Push the subdirectories of one directory onto the stack
+ *
+ * Applies the same exclusion rules as the scan, so both agree on the total.
+ *
+ * @return false on allocation failure
+ */
+static bool push_subdirectories(const FileScan *scan, DirStack *stack, const ScanDir *item)
+{
+    int fd = open(item->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return true; // The scan reports unreadable directories
+    }
+
+    PathFilterDir *ignore = path_filter_enter(scan->filter, item->ignore, fd, scan_relative_path(scan, item->path));
+    bool ok = true;
+#if defined(__linux__) && defined(SYS_getdents64)
+    // Raw getdents64 reads a large batch of entries per system call
+    struct linux_dirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+    _Alignas(8) char buffer[32768];
+    long n;
+    while (ok && (n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (long offset = 0; ok && offset < n;)
         {
-            // Check if it's a source file
-            SupportedLanguage langs[] = {LANG_C, LANG_CPP, LANG_JAVA, LANG_PYTHON, LANG_JAVASCRIPT, LANG_TYPESCRIPT};
-            bool is_source = false;
-            for (size_t i = 0; i < sizeof(langs) / sizeof(langs[0]); i++)
+            struct linux_dirent64 *entry = (struct linux_dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+            if (is_subdirectory(fd, entry->d_name, entry->d_type))
             {
-                if (is_source_file(entry->d_name, langs[i]))
-                {
-                    is_source = true;
-                    break;
-                }
+                ok = count_subdirectory(scan, stack, item, ignore, entry->d_name);
             }
+        }
+    }
+    close(fd);
+#else
+    DIR *dir = fdopendir(fd);
+    if (!dir)
+    {
+        path_filter_dir_release(ignore);
+        close(fd);
+        return true;
+    }
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL)
+    {
+#ifdef DT_UNKNOWN
+        unsigned char type = entry->d_type;
+#else
+        unsigned char type = 0;
+#endif
+        if (is_subdirectory(fd, entry->d_name, type))
+        {
+            ok = count_subdirectory(scan, stack, item, ignore, entry->d_name);
+        }
+    }
+    closedir(dir);
+#endif
+    path_filter_dir_release(ignore);
+    return ok;
+}
+
+/**
+ * @brief Pre-pass thread: counts the directories of the tree, including the root
+ */
+static void *count_worker(void *arg)
+{
+    FileScan *scan = (FileScan *)arg;
+
+    DirStack stack = {0};
+    int count = 0;
+    bool ok = dir_stack_push(&stack, scan->root, 0, NULL);
+    while (ok && stack.count > 0 && !scan_stopped(scan))
+    {
+        ScanDir dir = stack.dirs[--stack.count];
+        count++;
+        ok = push_subdirectories(scan, &stack, &dir);
+        free(dir.path);
+        path_filter_dir_release(dir.ignore);
+    }
+
+    for (int i = 0; i < stack.count; i++)
+    {
+        free(stack.dirs[i].path);
+        path_filter_dir_release(stack.dirs[i].ignore);
+    }
+    free(stack.dirs);
+
+    if (ok && !scan_stopped(scan))
+    {
+        atomic_store(&scan->dirs_counted, count);
+        LOG_DEBUG("Directory pre-pass counted %d directories", count);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Scanner thread: reads queued directories until none are left
+ */
+static void *scan_worker(void *arg)
+{
+    FileScan *scan = (FileScan *)arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&scan->mutex);
+        while (scan->dir_count == 0 && scan->dirs_pending > 0 && !scan_stopped(scan))
+        {
+            pthread_cond_wait(&scan->cond, &scan->mutex);
+        }
+        if (scan->dir_count == 0 || scan_stopped(scan))
+        {
+            pthread_cond_broadcast(&scan->cond);
+            pthread_mutex_unlock(&scan->mutex);
+            break;
+        }
+        ScanDir dir = scan->dirs[--scan->dir_count];
+        pthread_mutex_unlock(&scan->mutex);
+
+        if (scan_one_directory(scan, &dir) == -1)
+        {
+            atomic_store(&scan->failed, true);
+        }
+        free(dir.path);
+        path_filter_dir_release(dir.ignore);
+        atomic_fetch_add(&scan->dirs_scanned, 1);
+
+        pthread_mutex_lock(&scan->mutex);
+        scan->dirs_pending--;
+        if (scan->dirs_pending == 0 || scan_stopped(scan))
+        {
+            pthread_cond_broadcast(&scan->cond);
+        }
+        pthread_mutex_unlock(&scan->mutex);
+    }
+
+    atomic_fetch_sub_explicit(&scan->producers_running, 1, memory_order_release);
+    return NULL;
+}
+
+static void file_scan_free(FileScan *scan)
+{
+    char *path;
+    while (scan_try_dequeue(scan, &path, NULL))
+    {
+        free(path);
+    }
+    for (int i = 0; i < scan->dir_count; i++)
+    {
+        free(scan->dirs[i].path);
+        path_filter_dir_release(scan->dirs[i].ignore);
+    }
+    free(scan->dirs);
+    free(scan->slots);
+    free(scan->threads);
+    free(scan->root);
+    pthread_cond_destroy(&scan->cond);
+    pthread_mutex_destroy(&scan->mutex);
+    free(scan);
+}
+
+FileScan *file_scan_start(const char *path, int thread_count, int buffer_capacity, bool count_directories,
+                          const PathFilter *filter)
+{
+    if (!path)
+    {
+        LOG_ERROR("Invalid arguments to file_scan_start");
+        return NULL;
+    }
+
+    if (thread_count <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (int)cpus : 1;
+        if (thread_count > MAX_DEFAULT_SCAN_THREADS)
+        {
+            thread_count = MAX_DEFAULT_SCAN_THREADS;
+        }
+    }
+
+    // Ring buffer positions are masked, so round the capacity up to a power of two
+    size_t capacity = 2;
+    size_t wanted = buffer_capacity > 0 ? (size_t)buffer_capacity : DEFAULT_SCAN_BUFFER_CAPACITY;
+    while (capacity < wanted)
+    {
+        capacity <<= 1;
+    }
+
+    FileScan *scan = calloc(1, sizeof(FileScan));
+    if (!scan)
+    {
+        LOG_ERROR("Memory allocation failed for file scan");
+        return NULL;
+    }
+    if (pthread_mutex_init(&scan->mutex, NULL) != 0)
+    {
+        free(scan);
+        return NULL;
+    }
+    if (pthread_cond_init(&scan->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&scan->mutex);
+        free(scan);
+        return NULL;
+    }
+
+    scan->slots = calloc(capacity, sizeof(ScanSlot));
+    scan->threads = calloc(thread_count, sizeof(pthread_t));
+    scan->root = strdup(path);
+    if (!scan->slots || !scan->threads || !scan->root)
+    {
+        LOG_ERROR("Memory allocation failed for file scan");
+        file_scan_free(scan);
+        return NULL;
+    }
+    scan->root_len = strlen(path);
+    scan->filter = filter;
+    scan->slot_mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_init(&scan->slots[i].sequence, i);
+    }
+    atomic_init(&scan->enqueue_pos, 0);
+    atomic_init(&scan->dequeue_pos, 0);
+    atomic_init(&scan->failed, false);
+    atomic_init(&scan->cancelled, false);
+    atomic_init(&scan->dirs_discovered, 0);
+    atomic_init(&scan->dirs_scanned, 0);
+    atomic_init(&scan->dirs_counted, -1);
+    atomic_init(&scan->files_found, 0);
+    atomic_init(&scan->files_returned, 0);
+
+    if (!scan_push_dir(scan, path, 0, NULL))
+    {
+        file_scan_free(scan);
+        return NULL;
+    }
+
+    LOG_INFO("Scanning directory: %s", path);
+
+    atomic_init(&scan->producers_running, thread_count);
+    for (int t = 0; t < thread_count; t++)
+    {
+        if (pthread_create(&scan->threads[t], NULL, scan_worker, scan) != 0)
+        {
+            LOG_WARNING("Failed to start scanner thread %d", t);
+            atomic_fetch_sub(&scan->producers_running, thread_count - t);
+            break;
+        }
+        scan->thread_count++;
+    }
+
+    if (scan->thread_count == 0)
+    {
+        LOG_ERROR("Failed to start any scanner thread");
+        file_scan_free(scan);
+        return NULL;
+    }
+
+    // Progress falls back to the discovered directories if the pre-pass cannot start
+    if (count_directories)
+    {
+        scan->has_count_thread = pthread_create(&scan->count_thread, NULL, count_worker, scan) == 0;
+        if (!scan->has_count_thread)
+        {
+            LOG_WARNING("Failed to start directory count pre-pass");
+        }
+    }
+
+    return scan;
+}
+
+bool file_scan_next(FileScan *scan, char **path, long long *size)
+{
+    if (!scan || !path)
+    {
+        return false;
+    }
+
+    int spins = 0;
+    for (;;)
+    {
+        if (scan_try_dequeue(scan, path, size))
+        {
+            atomic_fetch_add(&scan->files_returned, 1);
+            return true;
+        }
 
-            if (is_source)
+        // Everything published before the last scanner exited is visible now
+        if (atomic_load_explicit(&scan->producers_running, memory_order_acquire) == 0)
+        {
+            if (scan_try_dequeue(scan, path, size))
             {
-                if (*count < max_files)
-                {
-                    files[*count] = strdup(full_path);
-                    if (!files[*count])
-                    {
-                        LOG_ERROR("Memory allocation failed for file path");
-                        closedir(dir);
-                        return -1;
-                    }
-                    (*count)++;
-                }
-                else
-                {
-                    LOG_WARNING("Maximum file limit reached (%d)", max_files);
-                }
+                atomic_fetch_add(&scan->files_returned, 1);
+                return true;
             }
+            return false;
         }
-        // Symbolic links are ignored to prevent cycles and permission issues
+        scan_backoff(&spins);
     }
+}
 
-    closedir(dir);
-    return 0;
+void file_scan_cancel(FileScan *scan)
+{
+    if (!scan)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&scan->mutex);
+    atomic_store(&scan->cancelled, true);
+    pthread_cond_broadcast(&scan->cond);
+    pthread_mutex_unlock(&scan->mutex);
+}
+
+void file_scan_progress(const FileScan *scan, FileScanProgress *progress)
+{
+    if (!progress)
+    {
+        return;
+    }
+
+    memset(progress, 0, sizeof(*progress));
+    if (!scan)
+    {
+        return;
+    }
+
+    progress->finished = atomic_load(&scan->producers_running) == 0;
+    progress->dirs_scanned = atomic_load(&scan->dirs_scanned);
+    progress->files_found = atomic_load(&scan->files_found);
+
+    int counted = atomic_load(&scan->dirs_counted);
+    progress->dirs_exact = counted >= 0;
+    progress->dirs_total = progress->dirs_exact ? counted : atomic_load(&scan->dirs_discovered);
+    if (progress->dirs_total < progress->dirs_scanned)
+    {
+        progress->dirs_total = progress->dirs_scanned;
+    }
+
+    // Extrapolate the file density of the scanned part to the rest of the tree
+    progress->files_estimate = progress->files_found;
+    if (!progress->finished && progress->dirs_scanned > 0)
+    {
+        long long estimate = (long long)progress->files_found * progress->dirs_total / progress->dirs_scanned;
+        if (estimate > progress->files_estimate)
+        {
+            progress->files_estimate = estimate < INT32_MAX ? (int)estimate : INT32_MAX;
+        }
+    }
+}
+
+int file_scan_finish(FileScan *scan)
+{
+    if (!scan)
+    {
+        return -1;
+    }
+
+    file_scan_cancel(scan);
+    for (int t = 0; t < scan->thread_count; t++)
+    {
+        pthread_join(scan->threads[t], NULL);
+    }
+    if (scan->has_count_thread)
+    {
+        pthread_join(scan->count_thread, NULL);
+    }
+
+    int result = atomic_load(&scan->failed) ? -1 : atomic_load(&scan->files_returned);
+    file_scan_free(scan);
+    return result;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+bool progress_throttle_ready(ProgressThrottle *throttle)
+{
+    if (!throttle)
+    {
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long now_ns = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (throttle->last_report_ns != 0 &&
+        now_ns - throttle->last_report_ns < (long long)PROGRESS_REPORT_INTERVAL_MS * 1000000LL)
+    {
+        return false;
+    }
+
+    throttle->last_report_ns = now_ns;
+    return true;
 }
 
 /**
@@ -175,21 +911,69 @@ int scan_directory_with_progress(const char *path, char **files, int max_files,
         return -1;
     }
 
-    LOG_INFO("Scanning directory: %s", path);
-
-    // For progress estimation, we could count directories first, but for simplicity
-    // we'll use a basic approach. In a real implementation, you might want to
-    // do a first pass to count directories.
-    int total_dirs_estimate = 10; // Rough estimate
-    int current_dir = 0;
+    // The pre-pass is only worth its extra directory reads when progress is shown
+    PathFilter *filter = path_filter_create_from_config();
+    FileScan *scan = file_scan_start(path, 0, 0, progress_callback != NULL, filter);
+    if (!scan)
+    {
+        path_filter_destroy(filter);
+        return -1;
+    }
 
     int count = 0;
-    if (scan_directory_recursive(path, files, max_files, &count,
-                               progress_callback, total_dirs_estimate, &current_dir) == -1)
+    bool limit_reached = false;
+    ProgressThrottle throttle = {0};
+    FileScanProgress progress;
+    char *file;
+    long long size;
+    while (file_scan_next(scan, &file, &size))
     {
+        if (count < max_files)
+        {
+            files[count++] = file;
+        }
+        else
+        {
+            if (!limit_reached)
+            {
+                LOG_WARNING("Maximum file limit reached (%d)", max_files);
+                file_scan_cancel(scan);
+                limit_reached = true;
+            }
+            free(file);
+        }
+
+        // Report directory progress as scanners get through the tree
+        if (progress_callback && progress_throttle_ready(&throttle))
+        {
+            file_scan_progress(scan, &progress);
+            char status_msg[256];
+            snprintf(status_msg, sizeof(status_msg), "Scanning directories (%d source files found)",
+                     progress.files_found);
+            progress_callback(progress.dirs_scanned, progress.dirs_total, status_msg);
+        }
+    }
+
+    if (progress_callback)
+    {
+        file_scan_progress(scan, &progress);
+        progress_callback(progress.dirs_scanned, progress.dirs_scanned, "Directory scan completed");
+    }
+
+    int result = file_scan_finish(scan);
+    path_filter_destroy(filter);
+    if (result == -1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            free(files[i]);
+        }
         return -1;
     }
 
+    // Sort by path so results do not depend on thread timing
+    qsort(files, count, sizeof(char *), compare_paths);
+
     LOG_INFO("Found %d source files", count);
     return count;
 }
@@ -1,44 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include "parser/generic_parser.h"
 #include "parser/ast_parser.h"
 #include "parser/file_scanner.h"
+#include "parser/file_prefetch.h"
+#include "parser/compile_database.h"
+#include "data/analysis_cache.h"
+#include "utils/config.h"
 #include "utils/logger.h"
 
+// Initial project array capacity; arrays grow as files are merged
+#define PARSE_PROJECT_INITIAL_CAPACITY 256
+
+// Larger C/C++ files are skipped
+#define MAX_PARSE_FILE_SIZE (50LL * 1024 * 1024)
+
+// Scanned files buffered per parse worker before the scanner waits
+#define PARSE_PIPELINE_FILES_PER_WORKER 64
+
 // Forward declarations for language-specific parsers
 static void *parse_python_file(const char *filepath, SupportedLanguage language);
 static void *parse_java_file(const char *filepath, SupportedLanguage language);
 static void *parse_javascript_file(const char *filepath, SupportedLanguage language);
 static void *parse_typescript_file(const char *filepath, SupportedLanguage language);
 
-// Wrapper function for C/C++ parsing
-static void *parse_c_cpp_file(const char *filepath, SupportedLanguage language)
+// C/C++ parsing with an explicit libclang index (NULL uses the shared index), from
+// contents already loaded if given
+static void *parse_c_cpp_file_with_index(const char *filepath, const char *contents, size_t length, void *index)
 {
-    (void)language; // Unused parameter
-
-    // Check file accessibility before parsing
-    if (!is_file_accessible(filepath))
+    if (contents)
     {
-        LOG_ERROR("Cannot access C/C++ file for parsing: %s", filepath);
-        return NULL;
+        if ((long long)length > MAX_PARSE_FILE_SIZE)
+        {
+            LOG_WARNING("Skipping large file: %s (size: %lld bytes)", filepath, (long long)length);
+            return NULL;
+        }
     }
-
-    // Check file size to prevent parsing extremely large files
-    struct stat st;
-    if (stat(filepath, &st) == 0)
+    else
     {
-        const long long MAX_FILE_SIZE = 50 * 1024 * 1024; // 50MB limit
-        if (st.st_size > MAX_FILE_SIZE)
+        // Check file accessibility before parsing
+        if (!is_file_accessible(filepath))
+        {
+            LOG_ERROR("Cannot access C/C++ file for parsing: %s", filepath);
+            return NULL;
+        }
+
+        // Check file size to prevent parsing extremely large files
+        struct stat st;
+        if (stat(filepath, &st) == 0 && st.st_size > MAX_PARSE_FILE_SIZE)
         {
             LOG_WARNING("Skipping large file: %s (size: %lld bytes)", filepath, (long long)st.st_size);
             return NULL;
         }
     }
 
-    void *result = parse_source_file(filepath);
+    void *result = index ? parse_source_buffer_with_index(filepath, contents, length, index)
+                         : parse_source_file(filepath);
     if (!result)
     {
         LOG_WARNING("C/C++ parser failed for file: %s", filepath);
@@ -46,6 +71,14 @@ static void *parse_c_cpp_file(const char *filepath, SupportedLanguage language)
     return result;
 }
 
+// Wrapper function for C/C++ parsing
+static void *parse_c_cpp_file(const char *filepath, SupportedLanguage language)
+{
+    (void)language; // Unused parameter
+
+    return parse_c_cpp_file_with_index(filepath, NULL, 0, NULL);
+}
+
 ParserFunction get_parser_for_language(SupportedLanguage language)
 {
     switch (language)
@@ -342,66 +375,623 @@ static void *parse_typescript_file(const char *filepath, SupportedLanguage langu
 }
 
 /**
- * @brief Parse an entire project with progress reporting
+ * @brief Outcome of parsing a single project file
+ */
+typedef enum
+{
+    FILE_PARSE_PENDING = 0,
+    FILE_PARSE_OK,
+    FILE_PARSE_SKIPPED,
+    FILE_PARSE_ACCESS_ERROR,
+    FILE_PARSE_FAILED
+} FileParseStatus;
+
+/**
+ * @brief Analysis cache state of a single project file
+ */
+typedef struct
+{
+    AnalysisCacheKey key;     // Identity of the file contents seen by the worker
+    bool has_key;             // Whether key describes the contents that were parsed
+    bool from_cache;          // Result was restored instead of parsed
+    AnalysisCacheDependency *dependencies; // Files the parse included, with owned paths
+    uint32_t dependency_count;
+    uint32_t dependency_capacity;
+    int64_t parse_start_ns;   // Included files changed since then may not be what was parsed
+} FileCacheState;
+
+/**
+ * @brief Result of parsing one file, handed from the parse to the merge step
+ */
+typedef struct
+{
+    SupportedLanguage language;
+    FileParseStatus status;
+    FileCacheState cache_state;
+    void *ast;                // Per-file ASTData when status is FILE_PARSE_OK
+    uint32_t *string_map;     // Project string IDs of the file's strings, or NULL
+} FileParseResult;
+
+/**
+ * @brief Shared state of the scan-to-parse pipeline
  *
- * @param project_path Path to the project root directory
- * @param max_files Maximum number of files to parse
- * @param progress_callback Optional progress callback function
- * @return Pointer to parsed project AST data, or NULL on error
+ * Workers take files from the running scan as they are found, parse them
+ * and merge each result into the project right away, so nothing is kept
+ * per file once it has been merged. The prefetcher loads the contents of
+ * upcoming files in the meantime. The scan's bounded buffer throttles the
+ * scanner when parsing falls behind.
  */
-void *parse_project(const char *project_path, int max_files, void (*progress_callback)(int, int, const char *))
+typedef struct
 {
-    if (!project_path)
+    FileScan *scan;                 // Source of file paths
+    FilePrefetch *prefetch;         // Loads scanned files ahead of the workers
+    int max_files;                  // Files to parse at most
+    int claimed;                    // Files taken from the scan so far
+    bool limit_reached;
+    Project *project;               // Merge target, guarded by mutex
+    AnalysisCache *cache;           // Previous results, or NULL when caching is off
+    pthread_rwlock_t cache_lock;    // Lookups share it, stores take it exclusively
+    int completed;                  // Files finished (for progress reporting)
+    int parsed_count;
+    int cached_count;
+    int parse_errors;
+    int access_errors;
+    int skipped_files;
+    pthread_mutex_t mutex;
+    ProgressThrottle throttle;      // Limits progress reports, guarded by mutex
+    void (*progress_callback)(int, int, const char *);
+} ParseJob;
+
+/**
+ * @brief Determine language from a file extension (NULL-safe)
+ */
+static SupportedLanguage language_from_extension(const char *filepath)
+{
+    const char *ext = strrchr(filepath, '.');
+    if (!ext)
     {
-        LOG_ERROR("Invalid project path");
-        return NULL;
+        return LANG_UNKNOWN;
     }
 
-    LOG_INFO("Starting project parsing: %s", project_path);
+    ext++; // Skip the dot
+    if (strcmp(ext, "c") == 0 || strcmp(ext, "h") == 0)
+        return LANG_C;
+    if (strcmp(ext, "cpp") == 0 || strcmp(ext, "hpp") == 0 || strcmp(ext, "cc") == 0 ||
+        strcmp(ext, "cxx") == 0 || strcmp(ext, "hxx") == 0)
+        return LANG_CPP;
+    if (strcmp(ext, "java") == 0)
+        return LANG_JAVA;
+    if (strcmp(ext, "py") == 0)
+        return LANG_PYTHON;
+    if (strcmp(ext, "js") == 0)
+        return LANG_JAVASCRIPT;
+    if (strcmp(ext, "ts") == 0)
+        return LANG_TYPESCRIPT;
+
+    return LANG_UNKNOWN;
+}
+
+static void free_cache_state(FileCacheState *state)
+{
+    for (uint32_t i = 0; i < state->dependency_count; i++)
+    {
+        free((char *)state->dependencies[i].path);
+    }
+    free(state->dependencies);
+    state->dependencies = NULL;
+    state->dependency_count = 0;
+    state->dependency_capacity = 0;
+}
+
+/**
+ * @brief Record an included file with the version that was just parsed
+ *
+ * A file that cannot be checked or that may have changed while it was
+ * being parsed leaves the result uncached.
+ */
+static void add_cache_dependency(const char *path, void *user_data)
+{
+    FileCacheState *state = (FileCacheState *)user_data;
+    if (!state->has_key)
+    {
+        return;
+    }
+
+    // File times come from a clock coarser than CLOCK_REALTIME, so allow a second
+    struct stat st;
+    int64_t mtime_ns = 0;
+    if (stat(path, &st) == 0)
+    {
+        mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    if (mtime_ns == 0 || mtime_ns >= state->parse_start_ns - 1000000000)
+    {
+        state->has_key = false;
+        return;
+    }
+
+    if (state->dependency_count == state->dependency_capacity)
+    {
+        uint32_t new_capacity = state->dependency_capacity ? state->dependency_capacity * 2 : 32;
+        AnalysisCacheDependency *dependencies =
+            realloc(state->dependencies, new_capacity * sizeof(AnalysisCacheDependency));
+        if (!dependencies)
+        {
+            state->has_key = false;
+            return;
+        }
+        state->dependencies = dependencies;
+        state->dependency_capacity = new_capacity;
+    }
+
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        state->has_key = false;
+        return;
+    }
+    state->dependencies[state->dependency_count++] = (AnalysisCacheDependency){copy, mtime_ns, (int64_t)st.st_size};
+}
+
+static int compare_cache_dependencies(const void *a, const void *b)
+{
+    return strcmp(((const AnalysisCacheDependency *)a)->path, ((const AnalysisCacheDependency *)b)->path);
+}
+
+/**
+ * @brief Collect the files a parse included, so the cached result is dropped when one changes
+ */
+static void collect_cache_dependencies(void *file_ast, FileCacheState *state)
+{
+    ast_parser_visit_included_files(file_ast, add_cache_dependency, state);
+    if (!state->has_key)
+    {
+        free_cache_state(state);
+        return;
+    }
+
+    // A header included more than once is recorded once
+    qsort(state->dependencies, state->dependency_count, sizeof(AnalysisCacheDependency), compare_cache_dependencies);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < state->dependency_count; i++)
+    {
+        if (kept > 0 && strcmp(state->dependencies[kept - 1].path, state->dependencies[i].path) == 0)
+        {
+            free((char *)state->dependencies[i].path);
+            continue;
+        }
+        state->dependencies[kept++] = state->dependencies[i];
+    }
+    state->dependency_count = kept;
+}
+
+/**
+ * @brief Parse one file using the worker's own libclang index
+ */
+static void parse_job_file(ParseJob *job, PrefetchedFile *file, void *index, FileParseResult *result)
+{
+    const char *path = file->path;
+    SupportedLanguage language = language_from_extension(path);
+    result->language = language;
+
+    if (language == LANG_UNKNOWN)
+    {
+        LOG_WARNING("Unknown file type, skipping: %s", path);
+        result->status = FILE_PARSE_SKIPPED;
+        return;
+    }
+
+    // Get appropriate parser
+    ParserFunction parser = get_parser_for_language(language);
+    if (!parser)
+    {
+        LOG_WARNING("No parser available for language, skipping: %s", path);
+        result->status = FILE_PARSE_SKIPPED;
+        return;
+    }
+
+    // Files the prefetcher passed on are read here, so the cache key and the parser see the same bytes
+    if (!file->contents && file->size <= MAX_PARSE_FILE_SIZE)
+    {
+        file_prefetch_load(file);
+    }
+
+    // Check if file is accessible before parsing; a loaded file was just read
+    if (!file->contents && !is_file_accessible(path))
+    {
+        LOG_WARNING("Skipping inaccessible file: %s", path);
+        result->status = FILE_PARSE_ACCESS_ERROR;
+        return;
+    }
+
+    // Unchanged files are restored from the analysis cache instead of being parsed
+    FileCacheState *state = &result->cache_state;
+    if (job->cache && file->contents)
+    {
+        analysis_cache_key_init(&state->key, file->mtime_ns, file->length);
+        state->has_key = true;
+
+        pthread_rwlock_rdlock(&job->cache_lock);
+        Project *cached = analysis_cache_lookup(job->cache, path, &state->key, file->contents);
+        pthread_rwlock_unlock(&job->cache_lock);
+        if (cached)
+        {
+            ASTData *cached_ast = calloc(1, sizeof(ASTData));
+            if (cached_ast)
+            {
+                cached_ast->project = cached;
+                state->from_cache = true;
+                result->ast = cached_ast;
+                result->status = FILE_PARSE_OK;
+                return;
+            }
+            project_destroy(cached);
+            free(cached);
+        }
+    }
+
+    if (state->has_key)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        state->parse_start_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    }
+
+    // C/C++ files go through the worker's index; libclang indexes are not shared across threads
+    void *file_ast = (language == LANG_C || language == LANG_CPP)
+                         ? parse_c_cpp_file_with_index(path, file->contents, file->length, index)
+                         : parser(path, language);
+    if (!file_ast)
+    {
+        LOG_WARNING("Failed to parse file (possibly malformed or too large): %s", path);
+        result->status = FILE_PARSE_FAILED;
+        return;
+    }
+
+    // Included files are only known while the translation unit is alive
+    if (state->has_key)
+    {
+        collect_cache_dependencies(file_ast, state);
+    }
+
+    // The translation unit belongs to this worker's index and must not outlive it
+    ast_parser_release_translation_unit(file_ast);
+
+    // Results are stored at merge time under the cache lock; hash the parsed contents here
+    if (state->has_key)
+    {
+        analysis_cache_key_hash(&state->key, file->contents);
+    }
+
+    result->ast = file_ast;
+    result->status = FILE_PARSE_OK;
+}
+
+/**
+ * @brief Merge a per-file parse result into the project
+ *
+ * Moves the functions, classes and variables extracted for the file into
+ * the shared project. The per-file ASTData must still be freed afterwards.
+ */
+static CQError merge_file_ast(Project *project, const char *filepath, SupportedLanguage language, void *file_ast,
+                              const uint32_t *string_map)
+{
+    ASTData *ast_data = (ASTData *)file_ast;
+    if (!ast_data || !ast_data->project)
+    {
+        return project_add_file(project, filepath, language, NULL);
+    }
+
+    // Placeholder parsers may not record the file themselves
+    if (ast_data->project->files.count == 0)
+    {
+        return project_add_file(project, filepath, language, NULL);
+    }
+
+    // Strings interned ahead of the merge only need their IDs remapped
+    uint32_t first_file = 0;
+    CQError result = string_map ? project_merge_mapped(project, ast_data->project, string_map, &first_file)
+                                : project_merge(project, ast_data->project, &first_file);
+    if (result != CQ_SUCCESS)
+    {
+        return result;
+    }
+
+    // Per-language parsers may not know the exact language variant
+    for (uint32_t i = first_file; i < project->files.count; i++)
+    {
+        project->files.files[i].language = language;
+    }
+
+    return CQ_SUCCESS;
+}
+
+/**
+ * @brief Record a parsed file in the project; caller holds the job mutex
+ */
+static void merge_job_result(ParseJob *job, const char *path, FileParseResult *result)
+{
+    switch (result->status)
+    {
+    case FILE_PARSE_OK:
+        // Record fresh results before merging, which takes ownership of class method lists
+        if (job->cache)
+        {
+            pthread_rwlock_wrlock(&job->cache_lock);
+            if (result->cache_state.from_cache)
+            {
+                analysis_cache_retain(job->cache, path, &result->cache_state.key);
+                job->cached_count++;
+            }
+            else if (result->cache_state.has_key && ((ASTData *)result->ast)->project)
+            {
+                if (analysis_cache_store(job->cache, path, &result->cache_state.key,
+                                         ((ASTData *)result->ast)->project, result->cache_state.dependencies,
+                                         result->cache_state.dependency_count) != CQ_SUCCESS)
+                {
+                    LOG_WARNING("Failed to cache parse results for file: %s", path);
+                }
+            }
+            pthread_rwlock_unlock(&job->cache_lock);
+        }
 
-    // Allocate memory for file paths
-    char **file_paths = calloc(max_files, sizeof(char *));
-    if (!file_paths)
+        if (merge_file_ast(job->project, path, result->language, result->ast, result->string_map) == CQ_SUCCESS)
+        {
+            job->parsed_count++;
+        }
+        else
+        {
+            LOG_WARNING("Failed to merge parse results for file: %s", path);
+            job->parse_errors++;
+        }
+        break;
+    case FILE_PARSE_SKIPPED:
+        job->skipped_files++;
+        break;
+    case FILE_PARSE_ACCESS_ERROR:
+        job->access_errors++;
+        break;
+    case FILE_PARSE_FAILED:
+        job->parse_errors++;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Parse worker: takes files from the scan until it is exhausted
+ */
+static void *parse_worker(void *arg)
+{
+    ParseJob *job = (ParseJob *)arg;
+
+    void *index = ast_parser_create_index();
+    if (!index)
+    {
+        LOG_WARNING("Parse worker running without a libclang index; C/C++ files will fail");
+    }
+
+    PrefetchedFile file;
+    while (file_prefetch_next(job->prefetch, &file))
+    {
+        const char *path = file.path;
+
+        // Files beyond the limit are drained so the scanner can stop
+        pthread_mutex_lock(&job->mutex);
+        bool take = job->claimed < job->max_files;
+        if (take)
+        {
+            job->claimed++;
+        }
+        else if (!job->limit_reached)
+        {
+            LOG_WARNING("Maximum file limit reached (%d)", job->max_files);
+            job->limit_reached = true;
+            file_prefetch_cancel(job->prefetch);
+        }
+        pthread_mutex_unlock(&job->mutex);
+        if (!take)
+        {
+            file_prefetch_release(job->prefetch, &file);
+            continue;
+        }
+
+        FileParseResult result = {0};
+        parse_job_file(job, &file, index, &result);
+
+        // The project pool is concurrent, so the file's strings are interned before taking the lock
+        ASTData *file_ast = (ASTData *)result.ast;
+        if (result.status == FILE_PARSE_OK && file_ast && file_ast->project && file_ast->project->files.count > 0 &&
+            project_intern_strings(job->project, file_ast->project, &result.string_map) != CQ_SUCCESS)
+        {
+            result.string_map = NULL;
+        }
+
+        pthread_mutex_lock(&job->mutex);
+        merge_job_result(job, path, &result);
+        job->completed++;
+        if (job->progress_callback && progress_throttle_ready(&job->throttle))
+        {
+            // Until the scan is done, the total is extrapolated from the directories scanned
+            FileScanProgress progress;
+            file_scan_progress(job->scan, &progress);
+            int total = job->claimed;
+            if (!progress.finished && progress.files_estimate > total)
+            {
+                total = progress.files_estimate < job->max_files ? progress.files_estimate : job->max_files;
+            }
+            char status_msg[256];
+            snprintf(status_msg, sizeof(status_msg), "Parsing file: %s", path);
+            job->progress_callback(job->completed, total, status_msg);
+        }
+        pthread_mutex_unlock(&job->mutex);
+
+        free(result.string_map);
+        free_cache_state(&result.cache_state);
+        free_ast_data(result.ast);
+        file_prefetch_release(job->prefetch, &file);
+    }
+
+    ast_parser_dispose_index(index);
+    return NULL;
+}
+
+/**
+ * @brief Resolve the number of parse worker threads from configuration
+ *
+ * Uses Config.thread_count; a value <= 0 means one worker per online CPU.
+ * Falls back to a single worker when the configuration is not initialized.
+ */
+static int resolve_parse_thread_count(void)
+{
+    int thread_count = 1;
+
+    const Config *config = config_get();
+    if (config)
+    {
+        thread_count = config->thread_count;
+        if (thread_count <= 0)
+        {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            thread_count = cpus > 0 ? (int)cpus : 1;
+        }
+    }
+
+    return thread_count > 0 ? thread_count : 1;
+}
+
+/**
+ * @brief Run the parse job on a pool of worker threads
+ *
+ * @return Number of worker threads used
+ */
+static int run_parse_job(ParseJob *job, int thread_count)
+{
+    pthread_t *threads = thread_count > 1 ? calloc(thread_count, sizeof(pthread_t)) : NULL;
+    if (!threads)
+    {
+        if (thread_count > 1)
+        {
+            LOG_WARNING("Failed to allocate parse worker threads, parsing sequentially");
+        }
+        parse_worker(job);
+        return 1;
+    }
+
+    int started = 0;
+    for (int t = 0; t < thread_count; t++)
+    {
+        if (pthread_create(&threads[t], NULL, parse_worker, job) != 0)
+        {
+            LOG_WARNING("Failed to start parse worker %d", t);
+            break;
+        }
+        started++;
+    }
+
+    // If no worker could be started at all, do the work on the calling thread
+    if (started == 0)
+    {
+        parse_worker(job);
+    }
+
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(threads);
+    return started > 0 ? started : 1;
+}
+
+/**
+ * @brief Open the analysis cache for a project if caching is enabled
+ *
+ * @param project_path Project root directory
+ * @param variant Parser settings the results are produced with
+ * @param cache_path Output buffer receiving the cache file path
+ * @param cache_path_size Size of cache_path
+ * @return Loaded cache, or NULL when caching is disabled or unavailable
+ */
+static AnalysisCache *open_parse_cache(const char *project_path, uint32_t variant, char *cache_path,
+                                       size_t cache_path_size)
+{
+    const Config *config = config_get();
+    if (!config || !config->enable_parse_cache)
     {
-        LOG_ERROR("Memory allocation failed for file paths");
         return NULL;
     }
 
-    // Scan directory for source files with progress
-    int file_count = scan_directory_with_progress(project_path, file_paths, max_files,
-                                                 (ProgressCallback)progress_callback);
-    if (file_count == -1)
+    int ret;
+    if (config->parse_cache_path[0] != '\0')
     {
-        LOG_ERROR("Failed to scan directory");
-        free(file_paths);
+        ret = snprintf(cache_path, cache_path_size, "%s", config->parse_cache_path);
+    }
+    else
+    {
+        ret = snprintf(cache_path, cache_path_size, "%s/.cqanalyzer.cache", project_path);
+    }
+
+    if (ret < 0 || (size_t)ret >= cache_path_size)
+    {
+        LOG_WARNING("Analysis cache path too long, caching disabled");
         return NULL;
     }
 
-    if (file_count == 0)
+    return analysis_cache_load(cache_path, variant);
+}
+
+/**
+ * @brief Free a project AST created by parse_project()
+ */
+static void destroy_project_ast(ASTData *project_ast)
+{
+    project_destroy(project_ast->project);
+    free(project_ast->project);
+    free(project_ast);
+}
+
+/**
+ * @brief Parse an entire project with progress reporting
+ *
+ * Scanning and parsing run as a pipeline: Config.thread_count workers, each
+ * with its own libclang index, parse files as soon as the scanner finds
+ * them and merge each result into the shared project. Once everything is
+ * merged, files are sorted by path so the project layout does not depend on
+ * thread timing. Upcoming files are loaded into memory ahead of the workers,
+ * within Config.prefetch_memory_mb, and handed to libclang as unsaved files.
+ * Files listed in the project's compile_commands.json are parsed with their
+ * compile command (see compile_database_load_for_project()). When
+ * Config.enable_parse_cache is set, files whose contents are unchanged since
+ * the previous run are restored from the analysis cache instead of parsed.
+ *
+ * @param project_path Path to the project root directory
+ * @param max_files Maximum number of files to parse (PARSE_PROJECT_NO_FILE_LIMIT for all)
+ * @param progress_callback Optional progress callback function
+ * @return Pointer to parsed project AST data, or NULL on error
+ */
+void *parse_project(const char *project_path, int max_files, void (*progress_callback)(int, int, const char *))
+{
+    if (!project_path)
     {
-        LOG_WARNING("No source files found in project");
-        free(file_paths);
+        LOG_ERROR("Invalid project path");
         return NULL;
     }
 
-    LOG_INFO("Found %d files to parse", file_count);
+    if (max_files <= 0)
+    {
+        LOG_ERROR("Invalid maximum file count: %d", max_files);
+        return NULL;
+    }
 
-    // Track parsing statistics
-    int parse_errors = 0;
-    int access_errors = 0;
-    int skipped_files = 0;
+    LOG_INFO("Starting project parsing: %s", project_path);
 
     // Create main AST data structure
     ASTData *project_ast = calloc(1, sizeof(ASTData));
     if (!project_ast)
     {
         LOG_ERROR("Memory allocation failed for project AST");
-        // Free allocated file paths
-        for (int i = 0; i < file_count; i++)
-        {
-            free(file_paths[i]);
-        }
-        free(file_paths);
         return NULL;
     }
 
@@ -411,116 +1001,158 @@ void *parse_project(const char *project_path, int max_files, void (*progress_cal
     {
         LOG_ERROR("Memory allocation failed for project structure");
         free(project_ast);
-        // Free allocated file paths
-        for (int i = 0; i < file_count; i++)
-        {
-            free(file_paths[i]);
-        }
-        free(file_paths);
         return NULL;
     }
 
-    // Initialize project with proper data structures
-    if (project_init(project_ast->project, project_path, max_files) != CQ_SUCCESS) {
+    // The file count is unknown until the scan ends; arrays grow as files are merged
+    uint32_t initial_capacity = max_files < PARSE_PROJECT_INITIAL_CAPACITY ? (uint32_t)max_files
+                                                                           : PARSE_PROJECT_INITIAL_CAPACITY;
+    if (project_init(project_ast->project, project_path, initial_capacity) != CQ_SUCCESS) {
         LOG_ERROR("Failed to initialize project data structures");
         free(project_ast->project);
         free(project_ast);
-        // Free allocated file paths
-        for (int i = 0; i < file_count; i++)
-        {
-            free(file_paths[i]);
-        }
-        free(file_paths);
         return NULL;
     }
+    project_ast->owns_project = true;
 
-    // Parse each file
-    FileInfo *last_file = NULL;
-    int parsed_count = 0;
-
-    for (int i = 0; i < file_count; i++)
+    // Workers intern their files' strings into the project without holding the merge lock
+    if (string_pool_enable_concurrent(&project_ast->project->string_pool) != CQ_SUCCESS)
     {
-        // Report progress for parsing
-        if (progress_callback)
-        {
-            char status_msg[256];
-            snprintf(status_msg, sizeof(status_msg), "Parsing file: %s", file_paths[i]);
-            progress_callback(i + 1, file_count, status_msg);
-        }
+        LOG_WARNING("Interning project strings under the merge lock");
+    }
 
-        // Determine language from file extension
-        SupportedLanguage language = LANG_UNKNOWN;
-        const char *ext = strrchr(file_paths[i], '.');
-        if (ext)
-        {
-            ext++; // Skip the dot
-            if (strcmp(ext, "c") == 0 || strcmp(ext, "h") == 0)
-                language = LANG_C;
-            else if (strcmp(ext, "cpp") == 0 || strcmp(ext, "hpp") == 0 || strcmp(ext, "cc") == 0 ||
-                     strcmp(ext, "cxx") == 0 || strcmp(ext, "hxx") == 0)
-                language = LANG_CPP;
-            else if (strcmp(ext, "java") == 0)
-                language = LANG_JAVA;
-            else if (strcmp(ext, "py") == 0)
-                language = LANG_PYTHON;
-            else if (strcmp(ext, "js") == 0)
-                language = LANG_JAVASCRIPT;
-            else if (strcmp(ext, "ts") == 0)
-                language = LANG_TYPESCRIPT;
-        }
+    // Set up the pipeline shared by all workers
+    ParseJob job = {0};
+    job.max_files = max_files;
+    job.project = project_ast->project;
+    job.progress_callback = progress_callback;
 
-        if (language == LANG_UNKNOWN)
-        {
-            LOG_WARNING("Unknown file type, skipping: %s", file_paths[i]);
-            free(file_paths[i]);
-            continue;
-        }
+    // Declaration-only runs skip function bodies; results differ, so they are cached separately
+    AnalysisProfile profile = config_resolve_analysis_profile(config_get());
 
-        // Get appropriate parser
-        ParserFunction parser = get_parser_for_language(language);
-        if (!parser)
-        {
-            LOG_WARNING("No parser available for language, skipping: %s", file_paths[i]);
-            free(file_paths[i]);
-            continue;
-        }
+    // Files built by the project are parsed with their exact compiler flags
+    CompileDatabase *compile_database = compile_database_load_for_project(project_path);
 
-        // Check if file is accessible before parsing
-        if (!is_file_accessible(file_paths[i]))
-        {
-            LOG_WARNING("Skipping inaccessible file: %s", file_paths[i]);
-            access_errors++;
-            free(file_paths[i]);
-            continue;
-        }
+    // Records also depend on the compile commands; the profile takes the low two bits
+    uint32_t cache_variant = (compile_database_fingerprint(compile_database) & ~UINT32_C(3)) | (uint32_t)profile;
+    char cache_path[MAX_PATH_LENGTH];
+    job.cache = open_parse_cache(project_path, cache_variant, cache_path, sizeof(cache_path));
+
+    if (pthread_mutex_init(&job.mutex, NULL) != 0)
+    {
+        LOG_ERROR("Failed to initialize parse job");
+        analysis_cache_destroy(job.cache);
+        compile_database_destroy(compile_database);
+        destroy_project_ast(project_ast);
+        return NULL;
+    }
+    if (pthread_rwlock_init(&job.cache_lock, NULL) != 0)
+    {
+        LOG_ERROR("Failed to initialize parse job");
+        pthread_mutex_destroy(&job.mutex);
+        analysis_cache_destroy(job.cache);
+        compile_database_destroy(compile_database);
+        destroy_project_ast(project_ast);
+        return NULL;
+    }
 
-        // Parse the file
-        void *file_ast = parser(file_paths[i], language);
-        if (!file_ast)
+    // Preambles shared by at least two files are precompiled once for all workers
+    const Config *config = config_get();
+    PchCache *pch = (config && config->enable_pch) ? pch_cache_create(2) : NULL;
+    ast_parser_set_pch_cache(pch);
+    ast_parser_set_profile(profile);
+
+    // Each file uses the include directories under its own directory. They
+    // come from one walk of the project, done here before the workers start
+    // and checked against the tree once per run.
+    preprocessor_include_paths_begin_run();
+    const IncludePathSet *project_includes = preprocessor_include_paths_acquire(project_path);
+
+    // Macros defined by several files are stored once for the whole project
+    MacroTable *macro_table = preprocessor_macro_table_create();
+    ast_parser_set_macro_table(macro_table);
+
+    ast_parser_set_compile_database(compile_database);
+
+    // Workers start on the first file while the scanner is still walking the tree
+    int thread_count = resolve_parse_thread_count();
+    int scan_result = -1;
+    bool count_directories = progress_callback && config && config->scan_count_directories;
+    PathFilter *filter = path_filter_create_from_config();
+    job.scan = file_scan_start(project_path, 0, thread_count * PARSE_PIPELINE_FILES_PER_WORKER, count_directories,
+                               filter);
+    if (job.scan)
+    {
+        // File contents are loaded ahead of the workers, within the configured memory
+        size_t prefetch_budget = config && config->prefetch_memory_mb > 0
+                                     ? (size_t)config->prefetch_memory_mb * 1024 * 1024
+                                     : 0;
+        job.prefetch = file_prefetch_start(job.scan, 0, prefetch_budget);
+        if (job.prefetch)
         {
-            LOG_WARNING("Failed to parse file (possibly malformed or too large): %s", file_paths[i]);
-            parse_errors++;
-            free(file_paths[i]);
-            continue;
+            LOG_INFO("Parsing with %d worker thread(s)%s", thread_count,
+                     profile == ANALYSIS_PROFILE_DECLARATIONS ? ", declarations only" : "");
+            run_parse_job(&job, thread_count);
+            file_prefetch_finish(job.prefetch);
         }
+        scan_result = file_scan_finish(job.scan);
+    }
+    path_filter_destroy(filter);
+
+    ast_parser_set_compile_database(NULL);
+    compile_database_destroy(compile_database);
+    ast_parser_set_macro_table(NULL);
+    preprocessor_macro_table_destroy(macro_table);
+    preprocessor_include_paths_release(project_includes);
+    preprocessor_include_paths_end_run();
+    ast_parser_set_profile(ANALYSIS_PROFILE_FULL);
+    ast_parser_set_pch_cache(NULL);
+    pch_cache_destroy(pch);
+    pthread_rwlock_destroy(&job.cache_lock);
+    pthread_mutex_destroy(&job.mutex);
+
+    if (scan_result == -1)
+    {
+        LOG_ERROR("Failed to scan directory");
+        analysis_cache_destroy(job.cache);
+        destroy_project_ast(project_ast);
+        return NULL;
+    }
 
-        // For now, we have placeholder parsers that return ASTData
-        // In a real implementation, we'd need to merge these into the project structure
-        // For this basic implementation, we'll just count successful parses
-        free(file_ast); // Placeholder cleanup
+    int file_count = job.claimed;
+    if (file_count == 0)
+    {
+        LOG_WARNING("No source files found in project");
+        analysis_cache_destroy(job.cache);
+        destroy_project_ast(project_ast);
+        return NULL;
+    }
 
-        parsed_count++;
-        free(file_paths[i]);
+    // Results were merged in completion order
+    if (project_sort_files(project_ast->project) != CQ_SUCCESS)
+    {
+        LOG_WARNING("Failed to sort project files; file order depends on parse timing");
     }
 
-    free(file_paths);
+    if (job.cache)
+    {
+        LOG_INFO("Restored %d of %d file(s) from the analysis cache", job.cached_count, file_count);
+        analysis_cache_save(job.cache, cache_path);
+        analysis_cache_destroy(job.cache);
+    }
+
+    int parsed_count = job.parsed_count;
+    int parse_errors = job.parse_errors;
+    int access_errors = job.access_errors;
+    int skipped_files = job.skipped_files;
 
     // Calculate total errors
     int total_errors = access_errors + parse_errors + skipped_files;
 
-    // The project statistics are automatically maintained by the array structures
-    // parsed_count is already reflected in project->files.count
-    // total_functions and total_classes are maintained by the respective arrays
+    // The project statistics are maintained by project_merge()
+    LOG_INFO("  Functions: %u, classes: %u, variables: %u",
+             project_ast->project->total_functions, project_ast->project->total_classes,
+             project_ast->project->total_variables);
 
     // Log comprehensive parsing results
     LOG_INFO("Project parsing completed:");
@@ -543,6 +1175,7 @@ void *parse_project(const char *project_path, int max_files, void (*progress_cal
             // Clean up and return NULL to indicate complete failure
             if (project_ast->project)
             {
+                project_destroy(project_ast->project);
                 free(project_ast->project);
             }
             free(project_ast);
@@ -567,4 +1200,4 @@ void *parse_project(const char *project_path, int max_files, void (*progress_cal
     }
 
     return project_ast;
-}
\ No newline at end of file
+}
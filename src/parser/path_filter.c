@@ -0,0 +1,495 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "parser/path_filter.h"
+#include "utils/config.h"
+#include "utils/logger.h"
+
+/**
+ * @brief One exclusion pattern
+ */
+typedef struct
+{
+    char *pattern;
+    bool negate;    // '!' prefix: re-include matching paths
+    bool dir_only;  // '/' suffix: match directories only
+    bool anchored;  // Contains '/': match the whole relative path, not the name
+} PathRule;
+
+typedef struct
+{
+    PathRule *rules;
+    int count;
+    int capacity;
+} PathRuleSet;
+
+struct PathFilter
+{
+    PathRuleSet rules; // Configured patterns, relative to the scan root
+    bool use_gitignore;
+    int max_depth;
+};
+
+struct PathFilterDir
+{
+    atomic_int refs;
+    PathFilterDir *parent;
+    size_t base_len;   // Length of the directory's path relative to the scan root
+    PathRuleSet rules; // Patterns of the directory's .gitignore
+};
+
+/**
+ * @brief Match a bracket expression; p points just after '['
+ *
+ * @return Pattern position after the closing ']', or NULL if c does not
+ *         match; *literal is set if the expression is unterminated
+ */
+static const char *match_bracket(const char *p, char c, bool *literal)
+{
+    bool negate = (*p == '!' || *p == '^');
+    if (negate)
+    {
+        p++;
+    }
+
+    bool matched = false;
+    bool first = true;
+    while (*p && (*p != ']' || first))
+    {
+        char lo = *p;
+        if (lo == '\\' && p[1])
+        {
+            lo = *++p;
+        }
+        char hi = lo;
+        if (p[1] == '-' && p[2] && p[2] != ']')
+        {
+            p += 2;
+            hi = *p;
+            if (hi == '\\' && p[1])
+            {
+                hi = *++p;
+            }
+        }
+        if (c >= lo && c <= hi)
+        {
+            matched = true;
+        }
+        p++;
+        first = false;
+    }
+
+    if (*p != ']')
+    {
+        *literal = true;
+        return NULL;
+    }
+    return (matched != negate && c != '/') ? p + 1 : NULL;
+}
+
+/**
+ * @brief Match a glob pattern against a path
+ */
+static bool glob_match(const char *p, const char *s)
+{
+    while (*p)
+    {
+        if (p[0] == '*' && p[1] == '*')
+        {
+            p += 2;
+            if (*p == '/')
+            {
+                // "**/" matches zero or more leading directories
+                p++;
+                for (const char *t = s;; t++)
+                {
+                    if (glob_match(p, t))
+                    {
+                        return true;
+                    }
+                    t = strchr(t, '/');
+                    if (!t)
+                    {
+                        return false;
+                    }
+                }
+            }
+            if (*p == '\0')
+            {
+                return true;
+            }
+            for (;; s++)
+            {
+                if (glob_match(p, s))
+                {
+                    return true;
+                }
+                if (*s == '\0')
+                {
+                    return false;
+                }
+            }
+        }
+
+        switch (*p)
+        {
+        case '*':
+            p++;
+            for (;; s++)
+            {
+                if (glob_match(p, s))
+                {
+                    return true;
+                }
+                if (*s == '\0' || *s == '/')
+                {
+                    return false;
+                }
+            }
+        case '?':
+            if (*s == '\0' || *s == '/')
+            {
+                return false;
+            }
+            p++;
+            s++;
+            break;
+        case '[':
+        {
+            if (*s == '\0')
+            {
+                return false;
+            }
+            bool literal = false;
+            const char *next = match_bracket(p + 1, *s, &literal);
+            if (literal)
+            {
+                if (*s != '[')
+                {
+                    return false;
+                }
+                p++;
+                s++;
+                break;
+            }
+            if (!next)
+            {
+                return false;
+            }
+            p = next;
+            s++;
+            break;
+        }
+        case '\\':
+            if (p[1])
+            {
+                p++;
+            }
+            // fall through
+        default:
+            if (*p != *s)
+            {
+                return false;
+            }
+            p++;
+            s++;
+            break;
+        }
+    }
+    return *s == '\0';
+}
+
+/**
+ * @brief Parse one pattern line and add it to a rule set
+ *
+ * @return false on allocation failure
+ */
+static bool rule_set_add(PathRuleSet *set, const char *line, size_t len)
+{
+    // Surrounding whitespace is not part of the pattern, unless escaped
+    while (len > 0 && isspace((unsigned char)*line))
+    {
+        line++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)line[len - 1]) && !(len > 1 && line[len - 2] == '\\'))
+    {
+        len--;
+    }
+    if (len == 0 || line[0] == '#')
+    {
+        return true;
+    }
+
+    PathRule rule = {0};
+    if (line[0] == '!')
+    {
+        rule.negate = true;
+        line++;
+        len--;
+    }
+    if (len > 0 && line[len - 1] == '/')
+    {
+        rule.dir_only = true;
+        len--;
+    }
+    if (len > 0 && line[0] == '/')
+    {
+        rule.anchored = true;
+        line++;
+        len--;
+    }
+    if (len == 0)
+    {
+        return true;
+    }
+    if (memchr(line, '/', len))
+    {
+        rule.anchored = true;
+    }
+
+    if (set->count == set->capacity)
+    {
+        int new_capacity = set->capacity ? set->capacity * 2 : 8;
+        PathRule *new_rules = realloc(set->rules, new_capacity * sizeof(PathRule));
+        if (!new_rules)
+        {
+            return false;
+        }
+        set->rules = new_rules;
+        set->capacity = new_capacity;
+    }
+
+    rule.pattern = strndup(line, len);
+    if (!rule.pattern)
+    {
+        return false;
+    }
+    set->rules[set->count++] = rule;
+    return true;
+}
+
+/**
+ * @brief Add every pattern of a separator-delimited list to a rule set
+ */
+static bool rule_set_add_list(PathRuleSet *set, const char *list, char separator)
+{
+    while (*list)
+    {
+        const char *end = strchr(list, separator);
+        size_t len = end ? (size_t)(end - list) : strlen(list);
+        if (len > 0 && list[len - 1] == '\r')
+        {
+            len--;
+        }
+        if (!rule_set_add(set, list, len))
+        {
+            return false;
+        }
+        if (!end)
+        {
+            break;
+        }
+        list = end + 1;
+    }
+    return true;
+}
+
+static void rule_set_free(PathRuleSet *set)
+{
+    for (int i = 0; i < set->count; i++)
+    {
+        free(set->rules[i].pattern);
+    }
+    free(set->rules);
+    memset(set, 0, sizeof(*set));
+}
+
+/**
+ * @brief Apply a rule set to a path relative to the set's directory
+ *
+ * @return 1 if excluded, 0 if re-included, -1 if no pattern matches
+ */
+static int rule_set_match(const PathRuleSet *set, const char *rel_path, bool is_dir)
+{
+    const char *name = strrchr(rel_path, '/');
+    name = name ? name + 1 : rel_path;
+
+    for (int i = set->count - 1; i >= 0; i--)
+    {
+        const PathRule *rule = &set->rules[i];
+        if (rule->dir_only && !is_dir)
+        {
+            continue;
+        }
+        if (glob_match(rule->pattern, rule->anchored ? rel_path : name))
+        {
+            return rule->negate ? 0 : 1;
+        }
+    }
+    return -1;
+}
+
+PathFilter *path_filter_create(const char *patterns, bool use_gitignore, int max_depth)
+{
+    PathFilter *filter = calloc(1, sizeof(PathFilter));
+    if (!filter)
+    {
+        LOG_ERROR("Memory allocation failed for path filter");
+        return NULL;
+    }
+
+    filter->use_gitignore = use_gitignore;
+    filter->max_depth = max_depth;
+    if (patterns && !rule_set_add_list(&filter->rules, patterns, ','))
+    {
+        LOG_ERROR("Memory allocation failed for path filter patterns");
+        path_filter_destroy(filter);
+        return NULL;
+    }
+
+    return filter;
+}
+
+PathFilter *path_filter_create_from_config(void)
+{
+    const Config *config = config_get();
+    if (!config)
+    {
+        return NULL;
+    }
+
+    return path_filter_create(config->scan_exclude, config->scan_use_gitignore, config->scan_max_depth);
+}
+
+void path_filter_destroy(PathFilter *filter)
+{
+    if (!filter)
+    {
+        return;
+    }
+
+    rule_set_free(&filter->rules);
+    free(filter);
+}
+
+bool path_filter_allows_depth(const PathFilter *filter, int depth)
+{
+    return !filter || filter->max_depth <= 0 || depth <= filter->max_depth;
+}
+
+/**
+ * @brief Read the patterns of a .gitignore file
+ *
+ * @return false on allocation failure
+ */
+static bool read_gitignore(int dir_fd, PathRuleSet *set)
+{
+    int fd = openat(dir_fd, ".gitignore", O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return true;
+    }
+
+    FILE *file = fdopen(fd, "r");
+    if (!file)
+    {
+        close(fd);
+        return true;
+    }
+
+    bool ok = true;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while (ok && (len = getline(&line, &size, file)) != -1)
+    {
+        ok = rule_set_add_list(set, line, '\n');
+    }
+
+    free(line);
+    fclose(file);
+    return ok;
+}
+
+PathFilterDir *path_filter_enter(const PathFilter *filter, PathFilterDir *parent, int dir_fd,
+                                 const char *rel_path)
+{
+    if (!filter || !filter->use_gitignore)
+    {
+        return path_filter_dir_retain(parent);
+    }
+
+    PathRuleSet rules = {0};
+    if (!read_gitignore(dir_fd, &rules))
+    {
+        LOG_WARNING("Memory allocation failed reading .gitignore in: %s", rel_path);
+    }
+    if (rules.count == 0)
+    {
+        rule_set_free(&rules);
+        return path_filter_dir_retain(parent);
+    }
+
+    PathFilterDir *dir = malloc(sizeof(PathFilterDir));
+    if (!dir)
+    {
+        LOG_WARNING("Memory allocation failed for .gitignore rules in: %s", rel_path);
+        rule_set_free(&rules);
+        return path_filter_dir_retain(parent);
+    }
+
+    atomic_init(&dir->refs, 1);
+    dir->parent = path_filter_dir_retain(parent);
+    dir->base_len = strlen(rel_path);
+    dir->rules = rules;
+    return dir;
+}
+
+PathFilterDir *path_filter_dir_retain(PathFilterDir *dir)
+{
+    if (dir)
+    {
+        atomic_fetch_add_explicit(&dir->refs, 1, memory_order_relaxed);
+    }
+    return dir;
+}
+
+void path_filter_dir_release(PathFilterDir *dir)
+{
+    while (dir && atomic_fetch_sub_explicit(&dir->refs, 1, memory_order_acq_rel) == 1)
+    {
+        PathFilterDir *parent = dir->parent;
+        rule_set_free(&dir->rules);
+        free(dir);
+        dir = parent;
+    }
+}
+
+bool path_filter_excludes(const PathFilter *filter, const PathFilterDir *dir, const char *rel_path, bool is_dir)
+{
+    if (!filter || !rel_path)
+    {
+        return false;
+    }
+
+    int verdict = rule_set_match(&filter->rules, rel_path, is_dir);
+    for (; verdict < 0 && dir; dir = dir->parent)
+    {
+        // .gitignore patterns are relative to the directory holding the file
+        const char *local = rel_path + dir->base_len;
+        if (dir->base_len > 0 && *local == '/')
+        {
+            local++;
+        }
+        verdict = rule_set_match(&dir->rules, local, is_dir);
+    }
+    return verdict > 0;
+}
@@ -0,0 +1,532 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <clang-c/Index.h>
+
+#include "parser/pch_cache.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+// Preambles longer than this are truncated to their first includes
+#define MAX_PREAMBLE_INCLUDES 256
+
+typedef enum
+{
+    PCH_STATE_PENDING = 0,    // Seen, not yet worth building
+    PCH_STATE_BUILDING,       // Being compiled by one worker
+    PCH_STATE_READY,          // pch_path can be used
+    PCH_STATE_FAILED          // Build failed or PCH rejected; parse normally
+} PchState;
+
+/**
+ * @brief One distinct preamble and argument set
+ */
+typedef struct
+{
+    uint64_t key;
+    int uses;
+    PchState state;
+    char *header_path;        // Generated prefix header (NULL until built)
+    char *pch_path;           // Precompiled header (NULL until built)
+} PchEntry;
+
+struct PchCache
+{
+    char directory[MAX_PATH_LENGTH];
+    int min_uses;
+    PchEntry *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *index;          // Open-addressing table of entry indices by key
+    uint32_t index_size;
+    int built_count;
+    int reuse_count;
+    pthread_mutex_t mutex;
+};
+
+/**
+ * @brief Lines of a source file, from its loaded contents or from disk
+ */
+typedef struct
+{
+    FILE *file;               // NULL when reading from the buffer
+    const char *next;         // Unread part of the buffer
+    const char *end;
+} PreambleReader;
+
+/**
+ * @brief Read the next line like fgets(), so long lines are cut the same way
+ */
+static bool preamble_next_line(PreambleReader *reader, char *line, size_t line_size)
+{
+    if (reader->file)
+    {
+        return fgets(line, (int)line_size, reader->file) != NULL;
+    }
+
+    if (reader->next >= reader->end)
+    {
+        return false;
+    }
+    size_t available = (size_t)(reader->end - reader->next);
+    size_t chunk = available < line_size - 1 ? available : line_size - 1;
+    const char *newline = memchr(reader->next, '\n', chunk);
+    if (newline)
+    {
+        chunk = (size_t)(newline - reader->next) + 1;
+    }
+    memcpy(line, reader->next, chunk);
+    line[chunk] = '\0';
+    reader->next += chunk;
+    return true;
+}
+
+/**
+ * @brief Collect the leading system includes of a file as a prefix header
+ *
+ * Only blank lines, comments and #include <...> directives are accepted;
+ * the preamble ends at the first other line so that the headers injected
+ * by the PCH are exactly the ones the file would include first anyway.
+ * The file is only opened when contents is NULL.
+ *
+ * @return Number of includes written to prefix (0 if none)
+ */
+static int read_preamble(const char *filepath, const char *contents, size_t contents_length, char *prefix,
+                         size_t prefix_size)
+{
+    PreambleReader reader = {NULL, contents, contents ? contents + contents_length : NULL};
+    if (!contents)
+    {
+        reader.file = fopen(filepath, "r");
+        if (!reader.file)
+        {
+            return 0;
+        }
+    }
+
+    char line[1024];
+    size_t length = 0;
+    int include_count = 0;
+    bool in_comment = false;
+    prefix[0] = '\0';
+
+    while (include_count < MAX_PREAMBLE_INCLUDES && preamble_next_line(&reader, line, sizeof(line)))
+    {
+        char *p = line;
+
+        if (in_comment)
+        {
+            char *end = strstr(p, "*/");
+            if (!end)
+            {
+                continue;
+            }
+            in_comment = false;
+            p = end + 2;
+        }
+
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+
+        if (*p == '\0' || strncmp(p, "//", 2) == 0)
+        {
+            continue;
+        }
+
+        if (strncmp(p, "/*", 2) == 0)
+        {
+            char *end = strstr(p + 2, "*/");
+            if (!end)
+            {
+                in_comment = true;
+                continue;
+            }
+            // Anything after a closing comment on the same line ends the preamble
+            p = end + 2;
+            while (isspace((unsigned char)*p))
+            {
+                p++;
+            }
+            if (*p == '\0')
+            {
+                continue;
+            }
+        }
+
+        if (*p != '#')
+        {
+            break;
+        }
+        p++;
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (strncmp(p, "include", 7) != 0)
+        {
+            break;
+        }
+        p += 7;
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (*p != '<')
+        {
+            break;
+        }
+
+        char *close = strchr(p, '>');
+        if (!close)
+        {
+            break;
+        }
+
+        int written = snprintf(prefix + length, prefix_size - length, "#include %.*s\n",
+                               (int)(close - p + 1), p);
+        if (written < 0 || (size_t)written >= prefix_size - length)
+        {
+            break;
+        }
+        length += written;
+        include_count++;
+    }
+
+    if (reader.file)
+    {
+        fclose(reader.file);
+    }
+
+    // Keep only complete directives if the buffer ran out mid-way
+    prefix[length] = '\0';
+    return include_count;
+}
+
+static const char *prefix_header_extension(const char *filepath)
+{
+    const char *ext = strrchr(filepath, '.');
+    return (ext && strcmp(ext, ".c") == 0) ? ".h" : ".hpp";
+}
+
+static bool has_errors(CXTranslationUnit tu)
+{
+    unsigned count = clang_getNumDiagnostics(tu);
+    for (unsigned i = 0; i < count; i++)
+    {
+        CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+        enum CXDiagnosticSeverity severity = clang_getDiagnosticSeverity(diagnostic);
+        clang_disposeDiagnostic(diagnostic);
+        if (severity >= CXDiagnostic_Error)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Find or add the entry for a key; caller must hold the mutex
+ */
+static PchEntry *find_or_add_entry(PchCache *cache, uint64_t key)
+{
+    if (cache->index_size > 0)
+    {
+        uint32_t bucket = (uint32_t)(key % cache->index_size);
+        while (cache->index[bucket] != UINT32_MAX)
+        {
+            if (cache->entries[cache->index[bucket]].key == key)
+            {
+                return &cache->entries[cache->index[bucket]];
+            }
+            bucket = (bucket + 1) % cache->index_size;
+        }
+    }
+
+    if (cache->count >= cache->capacity)
+    {
+        uint32_t new_capacity = cache->capacity ? cache->capacity * 2 : 32;
+        PchEntry *entries = (PchEntry *)realloc(cache->entries, new_capacity * sizeof(PchEntry));
+        if (!entries)
+        {
+            return NULL;
+        }
+        cache->entries = entries;
+        cache->capacity = new_capacity;
+    }
+
+    // Keep the key index at most half full
+    if ((cache->count + 1) * 2 > cache->index_size)
+    {
+        uint32_t new_size = cache->index_size ? cache->index_size * 2 : 64;
+        uint32_t *index = (uint32_t *)malloc(new_size * sizeof(uint32_t));
+        if (!index)
+        {
+            return NULL;
+        }
+        memset(index, 0xFF, new_size * sizeof(uint32_t));
+        for (uint32_t i = 0; i < cache->count; i++)
+        {
+            uint32_t bucket = (uint32_t)(cache->entries[i].key % new_size);
+            while (index[bucket] != UINT32_MAX)
+            {
+                bucket = (bucket + 1) % new_size;
+            }
+            index[bucket] = i;
+        }
+        free(cache->index);
+        cache->index = index;
+        cache->index_size = new_size;
+    }
+
+    PchEntry *entry = &cache->entries[cache->count];
+    memset(entry, 0, sizeof(PchEntry));
+    entry->key = key;
+
+    uint32_t bucket = (uint32_t)(key % cache->index_size);
+    while (cache->index[bucket] != UINT32_MAX)
+    {
+        bucket = (bucket + 1) % cache->index_size;
+    }
+    cache->index[bucket] = cache->count++;
+
+    return entry;
+}
+
+/**
+ * @brief Write the prefix header and compile it; runs without the mutex held
+ */
+static bool build_pch(const PchCache *cache, CXIndex index, uint64_t key, const char *prefix, const char *extension,
+                      const char *const *args, int arg_count, char **header_path_out, char **pch_path_out)
+{
+    char header_path[MAX_PATH_LENGTH];
+    char pch_path[MAX_PATH_LENGTH];
+    int ret1 = snprintf(header_path, sizeof(header_path), "%s/preamble_%016llx%s", cache->directory,
+                        (unsigned long long)key, extension);
+    int ret2 = snprintf(pch_path, sizeof(pch_path), "%s/preamble_%016llx.pch", cache->directory,
+                        (unsigned long long)key);
+    if (ret1 < 0 || ret1 >= (int)sizeof(header_path) || ret2 < 0 || ret2 >= (int)sizeof(pch_path))
+    {
+        return false;
+    }
+
+    FILE *header = fopen(header_path, "w");
+    if (!header)
+    {
+        LOG_WARNING("Could not write prefix header: %s", header_path);
+        return false;
+    }
+    fputs(prefix, header);
+    fclose(header);
+
+    CXTranslationUnit tu = clang_parseTranslationUnit(index, header_path, args, arg_count, NULL, 0,
+                                                      CXTranslationUnit_ForSerialization |
+                                                          CXTranslationUnit_Incomplete);
+    bool ok = tu && !has_errors(tu) &&
+              clang_saveTranslationUnit(tu, pch_path, clang_defaultSaveOptions(tu)) == CXSaveError_None;
+    if (tu)
+    {
+        clang_disposeTranslationUnit(tu);
+    }
+
+    if (!ok)
+    {
+        remove(header_path);
+        remove(pch_path);
+        return false;
+    }
+
+    *header_path_out = strdup(header_path);
+    *pch_path_out = strdup(pch_path);
+    if (!*header_path_out || !*pch_path_out)
+    {
+        free(*header_path_out);
+        free(*pch_path_out);
+        *header_path_out = NULL;
+        *pch_path_out = NULL;
+        remove(header_path);
+        remove(pch_path);
+        return false;
+    }
+
+    return true;
+}
+
+PchCache *pch_cache_create(int min_uses)
+{
+    PchCache *cache = calloc(1, sizeof(PchCache));
+    if (!cache)
+    {
+        LOG_ERROR("Memory allocation failed for PCH cache");
+        return NULL;
+    }
+
+    const char *tmpdir = getenv("TMPDIR");
+    if (!tmpdir || tmpdir[0] == '\0')
+    {
+        tmpdir = "/tmp";
+    }
+
+    int ret = snprintf(cache->directory, sizeof(cache->directory), "%s/cqanalyzer-pch-XXXXXX", tmpdir);
+    if (ret < 0 || ret >= (int)sizeof(cache->directory) || !mkdtemp(cache->directory))
+    {
+        LOG_ERROR("Failed to create PCH directory under %s", tmpdir);
+        free(cache);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0)
+    {
+        LOG_ERROR("Failed to initialize PCH cache mutex");
+        rmdir(cache->directory);
+        free(cache);
+        return NULL;
+    }
+
+    cache->min_uses = min_uses > 0 ? min_uses : 1;
+    LOG_INFO("Precompiled headers enabled in %s", cache->directory);
+    return cache;
+}
+
+void pch_cache_destroy(PchCache *cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+
+    LOG_INFO("Built %d precompiled header(s), reused them for %d file(s)", cache->built_count,
+             cache->reuse_count);
+
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        if (cache->entries[i].header_path)
+        {
+            remove(cache->entries[i].header_path);
+            free(cache->entries[i].header_path);
+        }
+        if (cache->entries[i].pch_path)
+        {
+            remove(cache->entries[i].pch_path);
+            free(cache->entries[i].pch_path);
+        }
+    }
+    rmdir(cache->directory);
+
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->entries);
+    free(cache->index);
+    free(cache);
+}
+
+const char *pch_cache_acquire(PchCache *cache, void *index, const char *filepath, const char *contents,
+                              size_t length, const char *const *args, int arg_count)
+{
+    if (!cache || !index || !filepath)
+    {
+        return NULL;
+    }
+
+    char prefix[16384];
+    if (read_preamble(filepath, contents, length, prefix, sizeof(prefix)) == 0)
+    {
+        return NULL;
+    }
+
+    // A PCH is only valid for the language and arguments it was built with
+    const char *extension = prefix_header_extension(filepath);
+    // The key only names files of this run's private directory, so it need not be stable across runs
+    uint64_t key = cq_hash_combine(cq_hash_string(extension), cq_hash_string(prefix));
+    for (int i = 0; i < arg_count; i++)
+    {
+        key = cq_hash_combine(key, cq_hash_string(args[i]));
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    PchEntry *entry = find_or_add_entry(cache, key);
+    if (!entry)
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return NULL;
+    }
+
+    entry->uses++;
+    if (entry->state == PCH_STATE_READY)
+    {
+        cache->reuse_count++;
+        const char *path = entry->pch_path;
+        pthread_mutex_unlock(&cache->mutex);
+        return path;
+    }
+
+    if (entry->state != PCH_STATE_PENDING || entry->uses < cache->min_uses)
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return NULL;
+    }
+
+    entry->state = PCH_STATE_BUILDING;
+    pthread_mutex_unlock(&cache->mutex);
+
+    char *header_path = NULL;
+    char *pch_path = NULL;
+    bool built = build_pch(cache, (CXIndex)index, key, prefix, extension, args, arg_count,
+                           &header_path, &pch_path);
+
+    // Entries may have moved while the mutex was released
+    pthread_mutex_lock(&cache->mutex);
+    entry = find_or_add_entry(cache, key);
+    if (!entry)
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        free(header_path);
+        free(pch_path);
+        return NULL;
+    }
+
+    const char *result = NULL;
+    if (built)
+    {
+        entry->header_path = header_path;
+        entry->pch_path = pch_path;
+        entry->state = PCH_STATE_READY;
+        cache->built_count++;
+        cache->reuse_count++;
+        result = entry->pch_path;
+        LOG_DEBUG("Built precompiled header %s for %s", pch_path, filepath);
+    }
+    else
+    {
+        entry->state = PCH_STATE_FAILED;
+        LOG_DEBUG("Could not build precompiled header for preamble of %s", filepath);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    return result;
+}
+
+void pch_cache_invalidate(PchCache *cache, const char *pch_path)
+{
+    if (!cache || !pch_path)
+    {
+        return;
+    }
+
+    // The path stays allocated (other parses may still hold it); only new acquires stop using it
+    pthread_mutex_lock(&cache->mutex);
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        if (cache->entries[i].pch_path == pch_path)
+        {
+            cache->entries[i].state = PCH_STATE_FAILED;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
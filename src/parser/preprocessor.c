@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,102 +8,515 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "parser/preprocessor.h"
+#include "utils/hash.h"
 #include "utils/logger.h"
 
+// Directory trees kept for roots that are no longer in use
+#define MAX_CACHED_INCLUDE_TREES 16
+
+// Levels below a directory searched for its include directories
+#define INCLUDE_SCAN_DEPTH 6
+
+// Initial slots of a macro table; the table doubles when half full
+#define MACRO_TABLE_INITIAL_SLOTS 256
+
+// Initial capacity of a context's macro list
+#define INITIAL_MACRO_CAPACITY 16
+
+// Searched after the project's own include directories
+static const char *const system_include_args[] = {
+    "-I/usr/local/include",
+    "-I/usr/include"
+};
+#define SYSTEM_INCLUDE_COUNT (sizeof(system_include_args) / sizeof(system_include_args[0]))
+
 /**
- * @brief Check if directory contains header files
+ * @brief Directory listed while discovering include paths
  */
-static bool has_header_files(const char *path)
+typedef struct
 {
-    DIR *dir = opendir(path);
-    if (!dir)
-    {
-        return false;
-    }
+    char *path;
+    struct timespec mtime;
+    char *include_arg;             // "-I<path>" if this is an include directory, else NULL
+    uint32_t level;                // Levels below the tree root
+    uint32_t end;                  // Index past its last descendant
+} ScannedDir;
 
-    struct dirent *entry;
-    bool has_headers = false;
+typedef struct IncludeTree IncludeTree;
 
-    while ((entry = readdir(dir)) != NULL)
-    {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            continue;
+struct IncludePathSet
+{
+    IncludeTree *tree;             // Owns the set and its arguments
+    const char **include_args;     // Per include directory, in -I order
+    uint32_t path_count;
+};
 
-        const char *ext = strrchr(entry->d_name, '.');
-        if (ext && (strcmp(ext, ".h") == 0 || strcmp(ext, ".hpp") == 0))
+/**
+ * @brief Directories under a root, listed once and shared by the sets of all of them
+ */
+struct IncludeTree
+{
+    char root[MAX_PATH_LENGTH];
+    ScannedDir *dirs;              // Preorder, so each directory's descendants follow it
+    uint32_t dir_count;
+    uint32_t dir_capacity;
+    uint32_t *slots;               // Open addressing by path hash; index + 1, 0 when empty
+    uint32_t slot_count;
+    IncludePathSet **sets;         // Per directory, derived on first acquire
+    int refs;                      // One for the cache plus one per acquired set
+    bool building;                 // Being walked outside the lock
+    uint64_t checked_run;          // include_cache_run when dirs were last found unchanged
+    IncludeTree *next;
+};
+
+static pthread_mutex_t include_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t include_cache_cond = PTHREAD_COND_INITIALIZER; // A tree finished building
+static IncludeTree *include_cache = NULL;
+
+// Parse runs in progress, and the number of the latest; 0 until the first run
+static int include_cache_active_runs = 0;
+static uint64_t include_cache_run = 0;
+
+/**
+ * @brief Interned definition with the key it is looked up by
+ */
+typedef struct
+{
+    MacroDefinition definition;
+    uint64_t hash;
+    size_t name_length;
+    size_t value_length;
+} MacroEntry;
+
+struct MacroTable
+{
+    pthread_mutex_t mutex;
+    MemoryArena arena;             // Entries and their strings
+    MacroEntry **slots;            // Open addressing by hash of name and value
+    uint32_t slot_count;
+    uint32_t count;
+};
+
+/**
+ * @brief Append a directory to a tree and its modification time for invalidation
+ *
+ * @return Index of the directory, or UINT32_MAX if out of memory
+ */
+static uint32_t include_tree_add_dir(IncludeTree *tree, const char *path, const struct stat *st, uint32_t level)
+{
+    if (tree->dir_count == tree->dir_capacity)
+    {
+        uint32_t new_capacity = tree->dir_capacity ? tree->dir_capacity * 2 : 32;
+        ScannedDir *new_dirs = realloc(tree->dirs, new_capacity * sizeof(ScannedDir));
+        if (!new_dirs)
         {
-            has_headers = true;
-            break;
+            return UINT32_MAX;
         }
+        tree->dirs = new_dirs;
+        tree->dir_capacity = new_capacity;
     }
 
-    closedir(dir);
-    return has_headers;
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        return UINT32_MAX;
+    }
+
+    tree->dirs[tree->dir_count] = (ScannedDir){copy, st->st_mtim, NULL, level, tree->dir_count + 1};
+    return tree->dir_count++;
 }
 
 /**
- * @brief Recursively scan for include directories
+ * @brief Mark a directory of a tree as an include directory
  */
-static void scan_include_dirs_recursive(PreprocessingContext *context, const char *path, int depth)
+static bool include_tree_mark_include(IncludeTree *tree, uint32_t index)
 {
-    if (depth > 5) // Limit recursion depth
+    ScannedDir *dir = &tree->dirs[index];
+    if (dir->include_arg)
     {
-        return;
+        return true;
     }
 
-    DIR *dir = opendir(path);
+    size_t arg_size = strlen(dir->path) + 3; // "-I" + path + null
+    dir->include_arg = malloc(arg_size);
+    if (!dir->include_arg)
+    {
+        return false;
+    }
+    snprintf(dir->include_arg, arg_size, "-I%s", dir->path);
+    LOG_DEBUG("Added include path: %s", dir->path);
+    return true;
+}
+
+/**
+ * @brief List a directory of a tree and walk its subdirectories
+ *
+ * @return false if out of memory
+ */
+static bool include_tree_walk(IncludeTree *tree, uint32_t index)
+{
+    DIR *dir = opendir(tree->dirs[index].path);
     if (!dir)
     {
-        return;
+        return true;
     }
 
+    bool ok = true;
+    bool has_headers = false;
     struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL)
+    while (ok && (entry = readdir(dir)) != NULL)
     {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
 
+        const char *ext = strrchr(entry->d_name, '.');
+        if (ext && (strcmp(ext, ".h") == 0 || strcmp(ext, ".hpp") == 0))
+        {
+            has_headers = true;
+        }
+
         char full_path[MAX_PATH_LENGTH];
-        int ret = snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        int ret = snprintf(full_path, sizeof(full_path), "%s/%s", tree->dirs[index].path, entry->d_name);
         if (ret < 0 || ret >= (int)sizeof(full_path))
         {
             continue;
         }
 
         struct stat st;
-        if (lstat(full_path, &st) == -1)
+        if (lstat(full_path, &st) == -1 || !S_ISDIR(st.st_mode))
         {
             continue;
         }
 
-        if (S_ISDIR(st.st_mode))
+        uint32_t child = include_tree_add_dir(tree, full_path, &st, tree->dirs[index].level + 1);
+        ok = child != UINT32_MAX;
+
+        // Common include directory names; others qualify by holding headers
+        if (ok && (strcmp(entry->d_name, "inc") == 0 || strncmp(entry->d_name, "include", 7) == 0))
+        {
+            ok = include_tree_mark_include(tree, child);
+        }
+        ok = ok && include_tree_walk(tree, child);
+    }
+    closedir(dir);
+
+    if (ok && has_headers)
+    {
+        ok = include_tree_mark_include(tree, index);
+    }
+    tree->dirs[index].end = tree->dir_count;
+    return ok;
+}
+
+/**
+ * @brief Walk the directories under a tree's root and index them by path
+ *
+ * @return false if out of memory
+ */
+static bool include_tree_build(IncludeTree *tree)
+{
+    LOG_INFO("Scanning for include directories in: %s", tree->root);
+
+    struct stat st;
+    if (stat(tree->root, &st) != 0)
+    {
+        memset(&st, 0, sizeof(st));
+    }
+    if (include_tree_add_dir(tree, tree->root, &st, 0) == UINT32_MAX || !include_tree_walk(tree, 0))
+    {
+        return false;
+    }
+
+    uint32_t slot_count = 16;
+    while (slot_count < tree->dir_count * 2)
+    {
+        slot_count *= 2;
+    }
+    tree->slots = calloc(slot_count, sizeof(uint32_t));
+    tree->sets = calloc(tree->dir_count, sizeof(IncludePathSet *));
+    if (!tree->slots || !tree->sets)
+    {
+        return false;
+    }
+    tree->slot_count = slot_count;
+    for (uint32_t i = 0; i < tree->dir_count; i++)
+    {
+        uint32_t slot = (uint32_t)cq_hash_string(tree->dirs[i].path) & (slot_count - 1);
+        while (tree->slots[slot])
+        {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        tree->slots[slot] = i + 1;
+    }
+
+    LOG_INFO("Found %u directories under %s", tree->dir_count, tree->root);
+    return true;
+}
+
+/**
+ * @brief Find a directory of a built tree by path
+ *
+ * @return Index of the directory, or UINT32_MAX if the tree did not list it
+ */
+static uint32_t include_tree_find(const IncludeTree *tree, const char *path)
+{
+    if (!tree->slot_count)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t slot = (uint32_t)cq_hash_string(path) & (tree->slot_count - 1);
+    while (tree->slots[slot])
+    {
+        uint32_t index = tree->slots[slot] - 1;
+        if (strcmp(tree->dirs[index].path, path) == 0)
+        {
+            return index;
+        }
+        slot = (slot + 1) & (tree->slot_count - 1);
+    }
+    return UINT32_MAX;
+}
+
+/**
+ * @brief Get the set of a tree's directory, deriving it on first use
+ *
+ * The set holds the include directories up to INCLUDE_SCAN_DEPTH levels
+ * below the directory, then the system directories.
+ */
+static IncludePathSet *include_tree_set(IncludeTree *tree, uint32_t index)
+{
+    if (tree->sets[index])
+    {
+        return tree->sets[index];
+    }
+
+    const ScannedDir *base = &tree->dirs[index];
+    uint32_t count = SYSTEM_INCLUDE_COUNT;
+    for (uint32_t i = index + 1; i < base->end; i++)
+    {
+        count += tree->dirs[i].include_arg && tree->dirs[i].level - base->level <= INCLUDE_SCAN_DEPTH;
+    }
+
+    IncludePathSet *set = calloc(1, sizeof(IncludePathSet));
+    const char **args = malloc(count * sizeof(char *));
+    if (!set || !args)
+    {
+        free(set);
+        free(args);
+        return NULL;
+    }
+
+    set->tree = tree;
+    set->include_args = args;
+    for (uint32_t i = index + 1; i < base->end; i++)
+    {
+        if (tree->dirs[i].include_arg && tree->dirs[i].level - base->level <= INCLUDE_SCAN_DEPTH)
+        {
+            args[set->path_count++] = tree->dirs[i].include_arg;
+        }
+    }
+    for (size_t i = 0; i < SYSTEM_INCLUDE_COUNT; i++)
+    {
+        args[set->path_count++] = system_include_args[i];
+    }
+
+    tree->sets[index] = set;
+    return set;
+}
+
+static IncludeTree *include_tree_create(const char *root)
+{
+    IncludeTree *tree = calloc(1, sizeof(IncludeTree));
+    if (tree)
+    {
+        strncpy(tree->root, root, sizeof(tree->root) - 1);
+    }
+    return tree;
+}
+
+static void include_tree_free(IncludeTree *tree)
+{
+    for (uint32_t i = 0; i < tree->dir_count; i++)
+    {
+        free(tree->dirs[i].path);
+        free(tree->dirs[i].include_arg);
+        if (tree->sets && tree->sets[i])
+        {
+            free(tree->sets[i]->include_args);
+            free(tree->sets[i]);
+        }
+    }
+    free(tree->dirs);
+    free(tree->slots);
+    free(tree->sets);
+    free(tree);
+}
+
+static uint64_t macro_hash(const char *name, size_t name_length, const char *value, size_t value_length)
+{
+    // Hashed as two parts so "AB" + "C" differs from "A" + "BC"
+    return cq_hash_combine(cq_hash_bytes(name, name_length), cq_hash_bytes(value, value_length));
+}
+
+/**
+ * @brief Double the slots of a macro table; caller holds its mutex
+ */
+static bool macro_table_grow(MacroTable *table)
+{
+    uint32_t slot_count = table->slot_count * 2;
+    MacroEntry **slots = calloc(slot_count, sizeof(MacroEntry *));
+    if (!slots)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < table->slot_count; i++)
+    {
+        MacroEntry *entry = table->slots[i];
+        if (entry)
         {
-            // Check common include directory names
-            if (strcmp(entry->d_name, "include") == 0 ||
-                strcmp(entry->d_name, "inc") == 0 ||
-                strncmp(entry->d_name, "include", 7) == 0 ||
-                has_header_files(full_path))
+            uint32_t slot = (uint32_t)(entry->hash & (slot_count - 1));
+            while (slots[slot])
             {
-                // Add to include paths
-                IncludePath *new_path = calloc(1, sizeof(IncludePath));
-                if (new_path)
-                {
-                    strncpy(new_path->path, full_path, sizeof(new_path->path) - 1);
-                    new_path->next = context->include_paths;
-                    context->include_paths = new_path;
-                    context->include_count++;
-                    LOG_DEBUG("Added include path: %s", full_path);
-                }
+                slot = (slot + 1) & (slot_count - 1);
             }
+            slots[slot] = entry;
+        }
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return true;
+}
+
+/**
+ * @brief Copy a definition into the table's arena; caller holds its mutex
+ */
+static MacroEntry *macro_entry_create(MacroTable *table, uint64_t hash, const char *name, size_t name_length,
+                                      const char *value, size_t value_length)
+{
+    MacroEntry *entry = memory_arena_alloc(&table->arena, sizeof(MacroEntry));
+    // "-D" + name + "=" + value + null, then name + null + value + null
+    char *arg = memory_arena_alloc(&table->arena, 2 * (name_length + value_length) + 6);
+    if (!entry || !arg)
+    {
+        return NULL;
+    }
+
+    char *end = arg;
+    memcpy(end, "-D", 2);
+    end += 2;
+    memcpy(end, name, name_length);
+    end += name_length;
+    if (value_length > 0)
+    {
+        *end++ = '=';
+        memcpy(end, value, value_length);
+        end += value_length;
+    }
+    *end++ = '\0';
+
+    char *name_copy = end;
+    memcpy(name_copy, name, name_length);
+    name_copy[name_length] = '\0';
+    char *value_copy = name_copy + name_length + 1;
+    memcpy(value_copy, value, value_length);
+    value_copy[value_length] = '\0';
+
+    entry->definition.name = name_copy;
+    entry->definition.value = value_copy;
+    entry->definition.arg = arg;
+    entry->hash = hash;
+    entry->name_length = name_length;
+    entry->value_length = value_length;
+    return entry;
+}
+
+/**
+ * @brief Get the stored copy of a definition, adding it if it is new
+ */
+static const MacroDefinition *macro_table_intern(MacroTable *table, const char *name, size_t name_length,
+                                                 const char *value, size_t value_length)
+{
+    uint64_t hash = macro_hash(name, name_length, value, value_length);
+
+    pthread_mutex_lock(&table->mutex);
+
+    if ((table->count + 1) * 2 > table->slot_count && !macro_table_grow(table))
+    {
+        pthread_mutex_unlock(&table->mutex);
+        LOG_ERROR("Memory allocation failed for macro table");
+        return NULL;
+    }
 
-            // Recurse into subdirectory
-            scan_include_dirs_recursive(context, full_path, depth + 1);
+    uint32_t slot = (uint32_t)(hash & (table->slot_count - 1));
+    while (table->slots[slot])
+    {
+        const MacroEntry *entry = table->slots[slot];
+        if (entry->hash == hash && entry->name_length == name_length && entry->value_length == value_length &&
+            memcmp(entry->definition.name, name, name_length) == 0 &&
+            memcmp(entry->definition.value, value, value_length) == 0)
+        {
+            pthread_mutex_unlock(&table->mutex);
+            return &entry->definition;
         }
+        slot = (slot + 1) & (table->slot_count - 1);
     }
 
-    closedir(dir);
+    MacroEntry *entry = macro_entry_create(table, hash, name, name_length, value, value_length);
+    if (entry)
+    {
+        table->slots[slot] = entry;
+        table->count++;
+    }
+
+    pthread_mutex_unlock(&table->mutex);
+    if (!entry)
+    {
+        LOG_ERROR("Memory allocation failed for macro definition");
+        return NULL;
+    }
+    return &entry->definition;
+}
+
+/**
+ * @brief Get the table a context interns into, creating a private one if it has none
+ */
+static MacroTable *context_macro_table(PreprocessingContext *context)
+{
+    if (!context->macro_table)
+    {
+        context->macro_table = preprocessor_macro_table_create();
+        context->owns_macro_table = context->macro_table != NULL;
+    }
+    return context->macro_table;
+}
+
+/**
+ * @brief Append an interned definition to a context's macros
+ */
+static bool context_add_macro(PreprocessingContext *context, const MacroDefinition *macro)
+{
+    if (context->macro_count == context->macro_capacity)
+    {
+        uint32_t new_capacity = context->macro_capacity ? context->macro_capacity * 2 : INITIAL_MACRO_CAPACITY;
+        const MacroDefinition **new_macros = realloc(context->macros, new_capacity * sizeof(MacroDefinition *));
+        if (!new_macros)
+        {
+            LOG_ERROR("Memory allocation failed for macro list");
+            return false;
+        }
+        context->macros = new_macros;
+        context->macro_capacity = new_capacity;
+    }
+
+    context->macros[context->macro_count++] = macro;
+    return true;
 }
 
 /**
@@ -142,10 +557,6 @@ static void extract_macro_from_line(PreprocessingContext *context, const char *l
         return;
     }
 
-    char macro_name[MAX_NAME_LENGTH];
-    strncpy(macro_name, name_start, name_len);
-    macro_name[name_len] = '\0';
-
     // Skip whitespace and parameters if any
     while (*line && isspace(*line))
     {
@@ -183,19 +594,12 @@ static void extract_macro_from_line(PreprocessingContext *context, const char *l
     }
 
     // Add macro definition
-    MacroDefinition *new_macro = calloc(1, sizeof(MacroDefinition));
-    if (new_macro)
+    MacroTable *table = context_macro_table(context);
+    const MacroDefinition *macro = table ? macro_table_intern(table, name_start, name_len, value_start, value_len)
+                                         : NULL;
+    if (macro && context_add_macro(context, macro))
     {
-        strncpy(new_macro->name, macro_name, sizeof(new_macro->name) - 1);
-        if (value_len > 0)
-        {
-            strncpy(new_macro->value, value_start, value_len);
-            new_macro->value[value_len] = '\0';
-        }
-        new_macro->next = context->macros;
-        context->macros = new_macro;
-        context->macro_count++;
-        LOG_DEBUG("Extracted macro: %s = %s", macro_name, new_macro->value);
+        LOG_DEBUG("Extracted macro: %s = %s", macro->name, macro->value);
     }
 }
 
@@ -209,11 +613,38 @@ PreprocessingContext *preprocessor_init(void)
         LOG_ERROR("Failed to allocate preprocessing context");
         return NULL;
     }
+    memory_arena_init(&context->arena, 0);
 
     LOG_INFO("Preprocessor initialized successfully");
     return context;
 }
 
+/**
+ * @brief Add system include paths and the include directories under a root
+ */
+static void scan_includes(PreprocessingContext *context, const char *project_root)
+{
+    IncludeTree *tree = include_tree_create(project_root);
+    const IncludePathSet *set = tree && include_tree_build(tree) ? include_tree_set(tree, 0) : NULL;
+    for (uint32_t i = 0; set && i < set->path_count; i++)
+    {
+        IncludePath *new_path = calloc(1, sizeof(IncludePath));
+        if (new_path)
+        {
+            strncpy(new_path->path, set->include_args[i] + 2, sizeof(new_path->path) - 1);
+            new_path->next = context->include_paths;
+            context->include_paths = new_path;
+            context->include_count++;
+        }
+    }
+    if (tree)
+    {
+        include_tree_free(tree);
+    }
+
+    LOG_INFO("Found %u include paths", context->include_count);
+}
+
 CQError preprocessor_scan_includes(PreprocessingContext *context, const char *project_root)
 {
     if (!context || !project_root)
@@ -222,31 +653,370 @@ CQError preprocessor_scan_includes(PreprocessingContext *context, const char *pr
         return CQ_ERROR_INVALID_ARGUMENT;
     }
 
-    LOG_INFO("Scanning for include directories in: %s", project_root);
+    scan_includes(context, project_root);
+    return CQ_SUCCESS;
+}
 
-    // Add standard system include paths
-    const char *system_paths[] = {
-        "/usr/include",
-        "/usr/local/include",
-        NULL
-    };
+/**
+ * @brief Drop one reference to a tree; caller holds include_cache_mutex
+ */
+static void include_tree_unref(IncludeTree *tree)
+{
+    if (--tree->refs == 0)
+    {
+        include_tree_free(tree);
+    }
+}
 
-    for (int i = 0; system_paths[i]; i++)
+/**
+ * @brief Check that no listed directory was added, removed or modified
+ */
+static bool include_tree_is_current(const IncludeTree *tree)
+{
+    for (uint32_t i = 0; i < tree->dir_count; i++)
     {
-        IncludePath *new_path = calloc(1, sizeof(IncludePath));
-        if (new_path)
+        struct stat st;
+        if (stat(tree->dirs[i].path, &st) != 0 ||
+            st.st_mtim.tv_sec != tree->dirs[i].mtime.tv_sec ||
+            st.st_mtim.tv_nsec != tree->dirs[i].mtime.tv_nsec)
         {
-            strncpy(new_path->path, system_paths[i], sizeof(new_path->path) - 1);
-            new_path->next = context->include_paths;
-            context->include_paths = new_path;
-            context->include_count++;
+            return false;
         }
     }
+    return true;
+}
 
-    // Scan project directory
-    scan_include_dirs_recursive(context, project_root, 0);
+/**
+ * @brief Check whether a tree was found unchanged during the current parse run
+ */
+static bool include_tree_checked_this_run(const IncludeTree *tree)
+{
+    return include_cache_active_runs > 0 && tree->checked_run == include_cache_run;
+}
 
-    LOG_INFO("Found %u include paths", context->include_count);
+/**
+ * @brief Unlink a tree from the cache if it is still there; caller holds include_cache_mutex
+ */
+static bool include_cache_unlink(IncludeTree *tree)
+{
+    for (IncludeTree **link = &include_cache; *link; link = &(*link)->next)
+    {
+        if (*link == tree)
+        {
+            *link = tree->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Find the cached tree holding a directory; caller holds include_cache_mutex
+ *
+ * A tree still being built is returned if the directory is at or under its
+ * root, with *index left unset.
+ */
+static IncludeTree *include_cache_find(const char *root, uint32_t *index)
+{
+    for (IncludeTree *tree = include_cache; tree; tree = tree->next)
+    {
+        size_t length = strlen(tree->root);
+        if (strncmp(root, tree->root, length) != 0 || (root[length] != '\0' && root[length] != '/'))
+        {
+            continue;
+        }
+        if (tree->building)
+        {
+            return tree;
+        }
+        *index = include_tree_find(tree, root);
+        if (*index != UINT32_MAX)
+        {
+            return tree;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Evict idle trees beyond the cache limit; caller holds include_cache_mutex
+ */
+static void include_cache_evict(void)
+{
+    uint32_t kept = 0;
+    IncludeTree **link = &include_cache;
+    while (*link)
+    {
+        IncludeTree *entry = *link;
+        if (++kept > MAX_CACHED_INCLUDE_TREES && entry->refs == 1 && !entry->building)
+        {
+            *link = entry->next;
+            include_tree_unref(entry);
+            continue;
+        }
+        link = &entry->next;
+    }
+}
+
+/**
+ * @brief Walk a root into a new cached tree; caller holds include_cache_mutex
+ *
+ * The walk runs without the lock. Other threads wanting a directory under
+ * the root wait for it instead of walking the same directories.
+ *
+ * @return The tree with a reference for the caller, or NULL on error
+ */
+static IncludeTree *include_cache_build(const char *root)
+{
+    IncludeTree *tree = include_tree_create(root);
+    if (!tree)
+    {
+        return NULL;
+    }
+    tree->refs = 2;
+    tree->building = true;
+    tree->next = include_cache;
+    include_cache = tree;
+
+    pthread_mutex_unlock(&include_cache_mutex);
+    bool ok = include_tree_build(tree);
+    pthread_mutex_lock(&include_cache_mutex);
+
+    tree->building = false;
+    tree->checked_run = include_cache_run;
+    pthread_cond_broadcast(&include_cache_cond);
+    if (!ok)
+    {
+        LOG_ERROR("Failed to scan include directories under %s", root);
+        if (include_cache_unlink(tree))
+        {
+            include_tree_unref(tree);
+        }
+        include_tree_unref(tree);
+        return NULL;
+    }
+    include_cache_evict();
+    return tree;
+}
+
+const IncludePathSet *preprocessor_include_paths_acquire(const char *root)
+{
+    if (!root)
+    {
+        LOG_ERROR("Invalid arguments to preprocessor_include_paths_acquire");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&include_cache_mutex);
+
+    // Use the tree of this directory or of a parent unless it changed
+    IncludeTree *tree = NULL;
+    uint32_t index = UINT32_MAX;
+    char stale_root[MAX_PATH_LENGTH] = "";
+    while (!tree)
+    {
+        tree = include_cache_find(root, &index);
+        if (!tree)
+        {
+            // Rescan a changed tree from its own root, so its other directories are covered again
+            tree = include_cache_build(stale_root[0] ? stale_root : root);
+            index = tree ? include_tree_find(tree, root) : UINT32_MAX;
+            if (!tree || index != UINT32_MAX)
+            {
+                break;
+            }
+
+            // The directory is gone from the rescanned tree; walk it on its own
+            include_tree_unref(tree);
+            tree = include_cache_build(root);
+            index = tree ? include_tree_find(tree, root) : UINT32_MAX;
+            break;
+        }
+
+        if (tree->building)
+        {
+            pthread_cond_wait(&include_cache_cond, &include_cache_mutex);
+            tree = NULL;
+            continue;
+        }
+
+        tree->refs++;
+        bool current = include_tree_checked_this_run(tree);
+        if (!current)
+        {
+            // The directories of a tree never change, so they are checked without the lock
+            uint64_t run = include_cache_run;
+            pthread_mutex_unlock(&include_cache_mutex);
+            current = include_tree_is_current(tree);
+            pthread_mutex_lock(&include_cache_mutex);
+            if (current)
+            {
+                tree->checked_run = run;
+            }
+        }
+        if (current)
+        {
+            break;
+        }
+
+        LOG_DEBUG("Include directories under %s changed, rescanning", tree->root);
+        strncpy(stale_root, tree->root, sizeof(stale_root) - 1);
+        if (include_cache_unlink(tree))
+        {
+            include_tree_unref(tree);
+        }
+        include_tree_unref(tree);
+        tree = NULL;
+    }
+
+    IncludePathSet *set = tree && index != UINT32_MAX ? include_tree_set(tree, index) : NULL;
+    if (set)
+    {
+        // Move to the front so eviction drops the least recently used roots
+        if (include_cache_unlink(tree))
+        {
+            tree->next = include_cache;
+            include_cache = tree;
+        }
+        LOG_DEBUG("Using %u include paths for %s", set->path_count, root);
+    }
+    else if (tree)
+    {
+        include_tree_unref(tree);
+    }
+
+    pthread_mutex_unlock(&include_cache_mutex);
+    return set;
+}
+
+void preprocessor_include_paths_begin_run(void)
+{
+    pthread_mutex_lock(&include_cache_mutex);
+    include_cache_active_runs++;
+    include_cache_run++;
+    pthread_mutex_unlock(&include_cache_mutex);
+}
+
+void preprocessor_include_paths_end_run(void)
+{
+    pthread_mutex_lock(&include_cache_mutex);
+    if (include_cache_active_runs > 0)
+    {
+        include_cache_active_runs--;
+    }
+    pthread_mutex_unlock(&include_cache_mutex);
+}
+
+void preprocessor_include_paths_release(const IncludePathSet *set)
+{
+    if (!set)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&include_cache_mutex);
+    include_tree_unref(set->tree);
+    pthread_mutex_unlock(&include_cache_mutex);
+}
+
+uint32_t preprocessor_include_paths_count(const IncludePathSet *set)
+{
+    return set ? set->path_count : 0;
+}
+
+void preprocessor_include_paths_clear_cache(void)
+{
+    pthread_mutex_lock(&include_cache_mutex);
+    IncludeTree **link = &include_cache;
+    while (*link)
+    {
+        // Trees being built are still waited on
+        IncludeTree *tree = *link;
+        if (tree->building)
+        {
+            link = &tree->next;
+            continue;
+        }
+        *link = tree->next;
+        include_tree_unref(tree);
+    }
+    pthread_mutex_unlock(&include_cache_mutex);
+}
+
+CQError preprocessor_use_include_paths(PreprocessingContext *context, const IncludePathSet *set)
+{
+    if (!context || !set)
+    {
+        LOG_ERROR("Invalid arguments to preprocessor_use_include_paths");
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    context->shared_includes = set;
+    return CQ_SUCCESS;
+}
+
+MacroTable *preprocessor_macro_table_create(void)
+{
+    MacroTable *table = calloc(1, sizeof(MacroTable));
+    if (!table)
+    {
+        LOG_ERROR("Failed to allocate macro table");
+        return NULL;
+    }
+
+    table->slots = calloc(MACRO_TABLE_INITIAL_SLOTS, sizeof(MacroEntry *));
+    if (!table->slots || pthread_mutex_init(&table->mutex, NULL) != 0)
+    {
+        LOG_ERROR("Failed to initialize macro table");
+        free(table->slots);
+        free(table);
+        return NULL;
+    }
+    table->slot_count = MACRO_TABLE_INITIAL_SLOTS;
+    memory_arena_init(&table->arena, 0);
+    return table;
+}
+
+void preprocessor_macro_table_destroy(MacroTable *table)
+{
+    if (!table)
+    {
+        return;
+    }
+
+    memory_arena_destroy(&table->arena);
+    pthread_mutex_destroy(&table->mutex);
+    free(table->slots);
+    free(table);
+}
+
+uint32_t preprocessor_macro_table_count(const MacroTable *table)
+{
+    if (!table)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock((pthread_mutex_t *)&table->mutex);
+    uint32_t count = table->count;
+    pthread_mutex_unlock((pthread_mutex_t *)&table->mutex);
+    return count;
+}
+
+CQError preprocessor_use_macro_table(PreprocessingContext *context, MacroTable *table)
+{
+    if (!context || !table || context->macro_count > 0)
+    {
+        LOG_ERROR("Invalid arguments to preprocessor_use_macro_table");
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (context->owns_macro_table)
+    {
+        preprocessor_macro_table_destroy(context->macro_table);
+    }
+    context->macro_table = table;
+    context->owns_macro_table = false;
     return CQ_SUCCESS;
 }
 
@@ -278,6 +1048,37 @@ CQError preprocessor_extract_macros(PreprocessingContext *context, const char *f
     return CQ_SUCCESS;
 }
 
+CQError preprocessor_extract_macros_from_buffer(PreprocessingContext *context, const char *text, size_t length)
+{
+    if (!context || (!text && length > 0))
+    {
+        LOG_ERROR("Invalid arguments to preprocessor_extract_macros_from_buffer");
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Split like fgets() into a line buffer, so long lines are cut the same way
+    char line[1024];
+    const char *p = text;
+    const char *end = text + length;
+    while (p < end)
+    {
+        size_t available = (size_t)(end - p);
+        size_t chunk = available < sizeof(line) - 1 ? available : sizeof(line) - 1;
+        const char *newline = memchr(p, '\n', chunk);
+        if (newline)
+        {
+            chunk = (size_t)(newline - p) + 1;
+        }
+        memcpy(line, p, chunk);
+        line[chunk] = '\0';
+        extract_macro_from_line(context, line);
+        p += chunk;
+    }
+
+    LOG_INFO("Extracted %u macros from buffer", context->macro_count);
+    return CQ_SUCCESS;
+}
+
 int preprocessor_build_args(PreprocessingContext *context, const char **args, int max_args)
 {
     if (!context || !args)
@@ -287,47 +1088,59 @@ int preprocessor_build_args(PreprocessingContext *context, const char **args, in
 
     int arg_count = 0;
 
-    // Add include paths
-    IncludePath *path = context->include_paths;
-    while (path && arg_count < max_args - 1)
+    // Macros and -std=c11 are kept; include paths get the slots that remain
+    int macro_slots = max_args - 1 < (int)context->macro_count ? max_args - 1 : (int)context->macro_count;
+    if (macro_slots < 0)
     {
-        char include_arg[MAX_PATH_LENGTH + 3]; // "-I" + path + null
-        int ret = snprintf(include_arg, sizeof(include_arg), "-I%s", path->path);
-        if (ret > 0 && ret < (int)sizeof(include_arg))
-        {
-            args[arg_count] = strdup(include_arg);
-            if (args[arg_count])
-            {
-                arg_count++;
-            }
-        }
-        path = path->next;
+        macro_slots = 0;
     }
+    int include_limit = max_args - 1 - macro_slots;
+    uint32_t dropped = 0;
 
-    // Add macro definitions
-    MacroDefinition *macro = context->macros;
-    while (macro && arg_count < max_args - 1)
+    // Add shared include paths, then the context's own
+    const IncludePathSet *shared = context->shared_includes;
+    for (uint32_t i = 0; shared && i < shared->path_count; i++)
     {
-        char macro_arg[MAX_NAME_LENGTH + MAX_VALUE_LENGTH + 10]; // "-D" + name + "=" + value + null
-        int ret;
-        if (strlen(macro->value) > 0)
+        if (arg_count < include_limit)
         {
-            ret = snprintf(macro_arg, sizeof(macro_arg), "-D%s=%s", macro->name, macro->value);
+            args[arg_count++] = shared->include_args[i];
         }
         else
         {
-            ret = snprintf(macro_arg, sizeof(macro_arg), "-D%s", macro->name);
+            dropped++;
         }
+    }
 
-        if (ret > 0 && ret < (int)sizeof(macro_arg))
+    for (IncludePath *path = context->include_paths; path; path = (IncludePath *)path->next)
+    {
+        if (arg_count >= include_limit)
         {
-            args[arg_count] = strdup(macro_arg);
-            if (args[arg_count])
-            {
-                arg_count++;
-            }
+            dropped++;
+            continue;
+        }
+        size_t arg_size = strlen(path->path) + 3; // "-I" + path + null
+        char *include_arg = memory_arena_alloc(&context->arena, arg_size);
+        if (include_arg)
+        {
+            snprintf(include_arg, arg_size, "-I%s", path->path);
+            args[arg_count++] = include_arg;
         }
-        macro = macro->next;
+    }
+
+    if (dropped > 0)
+    {
+        LOG_WARNING("Argument limit reached: dropped %u include path(s)", dropped);
+    }
+    if (macro_slots < (int)context->macro_count)
+    {
+        LOG_WARNING("Argument limit reached: dropped %u macro definition(s)",
+                    context->macro_count - (uint32_t)macro_slots);
+    }
+
+    // Add macro definitions
+    for (int i = 0; i < macro_slots; i++)
+    {
+        args[arg_count++] = context->macros[i]->arg;
     }
 
     // Add standard arguments
@@ -357,15 +1170,14 @@ void preprocessor_free(PreprocessingContext *context)
         path = next;
     }
 
-    // Free macros
-    MacroDefinition *macro = context->macros;
-    while (macro)
+    // Free macros; the definitions belong to the macro table
+    free(context->macros);
+    if (context->owns_macro_table)
     {
-        MacroDefinition *next = macro->next;
-        free(macro);
-        macro = next;
+        preprocessor_macro_table_destroy(context->macro_table);
     }
 
+    memory_arena_destroy(&context->arena);
     free(context);
     LOG_INFO("Preprocessing context freed");
-}
\ No newline at end of file
+}
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +12,8 @@ static char current_title[256];
 static int total_items = 0;
 static int current_item = 0;
 static clock_t start_time;
+static int report_total = -1;
+static struct timespec report_start;
 
 CQError progress_display_init(void)
 {
@@ -109,6 +113,60 @@ void progress_update(int item, const char *status)
     }
 }
 
+/**
+ * @brief Seconds elapsed since a monotonic timestamp
+ */
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void progress_report(int current, int total, const char *status)
+{
+    if (total <= 0)
+    {
+        return;
+    }
+
+    // A phase starts with its first report; the clock restarts when it does
+    if (report_total < 0 || current <= 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &report_start);
+    }
+    report_total = total;
+
+    if (current > total)
+    {
+        current = total;
+    }
+    double progress = (double)current / (double)total;
+    double elapsed = seconds_since(&report_start);
+    double eta = (progress > 0.0) ? (elapsed / progress - elapsed) : 0.0;
+
+    printf("\r  [%d/%d] %d%%", current, total, (int)(progress * 100.0));
+
+    if (status && strlen(status) > 0)
+    {
+        printf(" - %.60s", status);
+    }
+
+    if (eta > 0.0 && current < total)
+    {
+        printf(" ETA: %.1fs", eta);
+    }
+
+    // Clear what is left of a longer previous line
+    printf("\033[K");
+    if (current == total)
+    {
+        printf("\n");
+        report_total = -1;
+    }
+    fflush(stdout);
+}
+
 void progress_complete(const char *message)
 {
     // Complete the progress bar
@@ -137,6 +195,7 @@ void progress_complete(const char *message)
     memset(current_title, 0, sizeof(current_title));
     total_items = 0;
     current_item = 0;
+    report_total = -1;
 }
 
 void progress_display_error(const char *message)
@@ -21,6 +21,10 @@ static CQError config_set_defaults(void)
     current_config.enable_visualization = true;
     current_config.max_file_size_mb = 100;
     current_config.thread_count = 4;
+    strcpy(current_config.scan_exclude, ".git/,.hg/,.svn/,node_modules/");
+    current_config.scan_use_gitignore = true;
+    current_config.prefetch_memory_mb = 64;
+    current_config.use_compile_commands = true;
 
     // Enable common metrics by default (legacy support)
     current_config.enable_metrics[0] = true; // Cyclomatic complexity
@@ -223,6 +227,20 @@ CQError config_save_to_file(const char *filepath)
     fprintf(file, "enable_visualization=%s\n", current_config.enable_visualization ? "true" : "false");
     fprintf(file, "max_file_size_mb=%d\n", current_config.max_file_size_mb);
     fprintf(file, "thread_count=%d\n", current_config.thread_count);
+    fprintf(file, "enable_parse_cache=%s\n", current_config.enable_parse_cache ? "true" : "false");
+    fprintf(file, "parse_cache_path=%s\n", current_config.parse_cache_path);
+    fprintf(file, "enable_pch=%s\n", current_config.enable_pch ? "true" : "false");
+    fprintf(file, "scan_count_directories=%s\n", current_config.scan_count_directories ? "true" : "false");
+    fprintf(file, "scan_exclude=%s\n", current_config.scan_exclude);
+    fprintf(file, "scan_use_gitignore=%s\n", current_config.scan_use_gitignore ? "true" : "false");
+    fprintf(file, "scan_max_depth=%d\n", current_config.scan_max_depth);
+    fprintf(file, "prefetch_memory_mb=%d\n", current_config.prefetch_memory_mb);
+    fprintf(file, "use_compile_commands=%s\n", current_config.use_compile_commands ? "true" : "false");
+    fprintf(file, "compile_commands_dir=%s\n", current_config.compile_commands_dir);
+    fprintf(file, "analysis_profile=%s\n",
+            current_config.analysis_profile == ANALYSIS_PROFILE_FULL           ? "full"
+            : current_config.analysis_profile == ANALYSIS_PROFILE_DECLARATIONS ? "declarations"
+                                                                               : "auto");
 
     fprintf(file, "\n# Enabled metrics (bitfield)\n");
     fprintf(file, "enable_metrics=");
@@ -367,6 +385,66 @@ CQError config_set(const char *key, const char *value)
     {
         current_config.thread_count = atoi(value);
     }
+    else if (strcmp(key, "enable_parse_cache") == 0)
+    {
+        current_config.enable_parse_cache = (strcmp(value, "true") == 0);
+    }
+    else if (strcmp(key, "parse_cache_path") == 0)
+    {
+        strncpy(current_config.parse_cache_path, value, sizeof(current_config.parse_cache_path) - 1);
+    }
+    else if (strcmp(key, "enable_pch") == 0)
+    {
+        current_config.enable_pch = (strcmp(value, "true") == 0);
+    }
+    else if (strcmp(key, "scan_count_directories") == 0)
+    {
+        current_config.scan_count_directories = (strcmp(value, "true") == 0);
+    }
+    else if (strcmp(key, "scan_exclude") == 0)
+    {
+        strncpy(current_config.scan_exclude, value, sizeof(current_config.scan_exclude) - 1);
+    }
+    else if (strcmp(key, "scan_use_gitignore") == 0)
+    {
+        current_config.scan_use_gitignore = (strcmp(value, "true") == 0);
+    }
+    else if (strcmp(key, "scan_max_depth") == 0)
+    {
+        current_config.scan_max_depth = atoi(value);
+    }
+    else if (strcmp(key, "prefetch_memory_mb") == 0)
+    {
+        current_config.prefetch_memory_mb = atoi(value);
+    }
+    else if (strcmp(key, "use_compile_commands") == 0)
+    {
+        current_config.use_compile_commands = (strcmp(value, "true") == 0);
+    }
+    else if (strcmp(key, "compile_commands_dir") == 0)
+    {
+        strncpy(current_config.compile_commands_dir, value, sizeof(current_config.compile_commands_dir) - 1);
+    }
+    else if (strcmp(key, "analysis_profile") == 0)
+    {
+        if (strcmp(value, "auto") == 0)
+        {
+            current_config.analysis_profile = ANALYSIS_PROFILE_AUTO;
+        }
+        else if (strcmp(value, "full") == 0)
+        {
+            current_config.analysis_profile = ANALYSIS_PROFILE_FULL;
+        }
+        else if (strcmp(value, "declarations") == 0)
+        {
+            current_config.analysis_profile = ANALYSIS_PROFILE_DECLARATIONS;
+        }
+        else
+        {
+            LOG_WARNING("Unknown analysis profile: %s", value);
+            return CQ_ERROR_INVALID_ARGUMENT;
+        }
+    }
     else if (strcmp(key, "enable_metrics") == 0)
     {
         // Parse bitfield string
@@ -541,6 +619,18 @@ const char *config_get_string(const char *key)
     {
         return current_config.log_file;
     }
+    else if (strcmp(key, "parse_cache_path") == 0)
+    {
+        return current_config.parse_cache_path;
+    }
+    else if (strcmp(key, "scan_exclude") == 0)
+    {
+        return current_config.scan_exclude;
+    }
+    else if (strcmp(key, "compile_commands_dir") == 0)
+    {
+        return current_config.compile_commands_dir;
+    }
 
     return NULL;
 }
@@ -568,6 +658,14 @@ int config_get_int(const char *key, int default_value)
     {
         return current_config.thread_count;
     }
+    else if (strcmp(key, "scan_max_depth") == 0)
+    {
+        return current_config.scan_max_depth;
+    }
+    else if (strcmp(key, "prefetch_memory_mb") == 0)
+    {
+        return current_config.prefetch_memory_mb;
+    }
 
     return default_value;
 }
@@ -583,6 +681,26 @@ bool config_get_bool(const char *key, bool default_value)
     {
         return current_config.enable_visualization;
     }
+    else if (strcmp(key, "enable_parse_cache") == 0)
+    {
+        return current_config.enable_parse_cache;
+    }
+    else if (strcmp(key, "enable_pch") == 0)
+    {
+        return current_config.enable_pch;
+    }
+    else if (strcmp(key, "scan_count_directories") == 0)
+    {
+        return current_config.scan_count_directories;
+    }
+    else if (strcmp(key, "scan_use_gitignore") == 0)
+    {
+        return current_config.scan_use_gitignore;
+    }
+    else if (strcmp(key, "use_compile_commands") == 0)
+    {
+        return current_config.use_compile_commands;
+    }
 
     return default_value;
 }
@@ -656,3 +774,24 @@ double config_get_error_threshold(void)
 {
     return config_initialized ? current_config.error_threshold : 40.0;
 }
+
+AnalysisProfile config_resolve_analysis_profile(const Config *config)
+{
+    if (!config)
+    {
+        return ANALYSIS_PROFILE_FULL;
+    }
+
+    if (config->analysis_profile != ANALYSIS_PROFILE_AUTO)
+    {
+        return config->analysis_profile;
+    }
+
+    // Complexity and nesting are measured inside function bodies
+    if (config->cyclomatic_complexity.enabled || config->maintainability_index.enabled)
+    {
+        return ANALYSIS_PROFILE_FULL;
+    }
+
+    return ANALYSIS_PROFILE_DECLARATIONS;
+}
@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "utils/hash.h"
+
+// Default wyhash secrets: odd 64-bit constants with balanced bits
+static const uint64_t HASH_SECRET[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+/**
+ * @brief Full 128-bit product of a and b, low half in a and high half in b
+ */
+static inline void hash_multiply(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 product = (unsigned __int128)*a * *b;
+    *a = (uint64_t)product;
+    *b = (uint64_t)(product >> 64);
+#else
+    // Schoolbook multiply on 32-bit halves; the cross sum cannot overflow
+    uint64_t a_high = *a >> 32, a_low = (uint32_t)*a;
+    uint64_t b_high = *b >> 32, b_low = (uint32_t)*b;
+    uint64_t low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t cross = (low >> 32) + (uint32_t)high_low + low_high;
+    *a = (cross << 32) | (uint32_t)low;
+    *b = a_high * b_high + (high_low >> 32) + (cross >> 32);
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_multiply(&a, &b);
+    return a ^ b;
+}
+
+// Unaligned loads; memcpy compiles to a single move
+static inline uint64_t read_8(const uint8_t *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read_4(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// 1 to 3 bytes: first, middle and last byte
+static inline uint64_t read_3(const uint8_t *p, size_t length)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+}
+
+uint64_t cq_hash_bytes(const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t seed = HASH_SECRET[0] ^ hash_mix(HASH_SECRET[0], HASH_SECRET[1]);
+    uint64_t a;
+    uint64_t b;
+
+    if (length <= 16)
+    {
+        // Short keys, the bulk of identifiers, are read as two overlapping words
+        if (length >= 4)
+        {
+            size_t step = (length >> 3) << 2;
+            a = (read_4(p) << 32) | read_4(p + step);
+            b = (read_4(p + length - 4) << 32) | read_4(p + length - 4 - step);
+        }
+        else if (length > 0)
+        {
+            a = read_3(p, length);
+            b = 0;
+        }
+        else
+        {
+            a = 0;
+            b = 0;
+        }
+    }
+    else
+    {
+        size_t remaining = length;
+        if (remaining > 48)
+        {
+            // Three independent lanes keep the multipliers busy on long keys
+            uint64_t seed_1 = seed;
+            uint64_t seed_2 = seed;
+            do
+            {
+                seed = hash_mix(read_8(p) ^ HASH_SECRET[1], read_8(p + 8) ^ seed);
+                seed_1 = hash_mix(read_8(p + 16) ^ HASH_SECRET[2], read_8(p + 24) ^ seed_1);
+                seed_2 = hash_mix(read_8(p + 32) ^ HASH_SECRET[3], read_8(p + 40) ^ seed_2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= seed_1 ^ seed_2;
+        }
+        while (remaining > 16)
+        {
+            seed = hash_mix(read_8(p) ^ HASH_SECRET[1], read_8(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        // The last 16 bytes, overlapping what was already consumed
+        a = read_8(p + remaining - 16);
+        b = read_8(p + remaining - 8);
+    }
+
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    hash_multiply(&a, &b);
+    return hash_mix(a ^ HASH_SECRET[0] ^ length, b ^ HASH_SECRET[1]);
+}
+
+uint64_t cq_hash_string(const char *str)
+{
+    return cq_hash_bytes(str, strlen(str));
+}
+
+uint64_t cq_hash_combine(uint64_t seed, uint64_t hash)
+{
+    return hash_mix(seed ^ HASH_SECRET[2], hash ^ HASH_SECRET[3]);
+}
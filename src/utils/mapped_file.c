@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/mapped_file.h"
+#include "utils/logger.h"
+
+// Initial buffer size for files whose size is not known up front
+#define MAPPED_FILE_READ_CHUNK 65536
+
+/**
+ * @brief Read a descriptor to the end into a heap buffer
+ */
+static CQError read_whole_file(int fd, size_t capacity, MappedFile *file)
+{
+    char *buffer = malloc(capacity);
+    if (!buffer)
+    {
+        return CQ_ERROR_MEMORY_ALLOCATION;
+    }
+
+    size_t size = 0;
+    for (;;)
+    {
+        if (size == capacity)
+        {
+            char *new_buffer = realloc(buffer, capacity * 2);
+            if (!new_buffer)
+            {
+                free(buffer);
+                return CQ_ERROR_MEMORY_ALLOCATION;
+            }
+            buffer = new_buffer;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, buffer + size, capacity - size);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            free(buffer);
+            return CQ_ERROR_FILE_NOT_FOUND;
+        }
+        size += (size_t)n;
+    }
+
+    file->data = buffer;
+    file->size = size;
+    file->mapped = false;
+    return CQ_SUCCESS;
+}
+
+CQError mapped_file_open(const char *filepath, MappedFile *file)
+{
+    if (!filepath || !file)
+    {
+        return CQ_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return CQ_ERROR_FILE_NOT_FOUND;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        close(fd);
+        return CQ_ERROR_FILE_NOT_FOUND;
+    }
+
+    // Empty and special files cannot be mapped; read them instead
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            close(fd);
+            file->data = data;
+            file->size = (size_t)st.st_size;
+            file->mapped = true;
+            return CQ_SUCCESS;
+        }
+        LOG_DEBUG("mmap failed for %s (errno: %d), reading instead", filepath, errno);
+    }
+
+    // One spare byte lets a regular file's read hit end of file without growing
+    size_t capacity = S_ISREG(st.st_mode) ? (size_t)st.st_size + 1 : MAPPED_FILE_READ_CHUNK;
+    CQError result = read_whole_file(fd, capacity, file);
+    close(fd);
+    return result;
+}
+
+void mapped_file_close(MappedFile *file)
+{
+    if (!file || !file->data)
+    {
+        return;
+    }
+
+    if (file->mapped)
+    {
+        munmap((void *)file->data, file->size);
+    }
+    else
+    {
+        free((void *)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
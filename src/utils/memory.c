@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "utils/memory.h"
 #include "utils/logger.h"
@@ -94,3 +96,116 @@ CQError cq_memcpy_safe(void *dest, size_t dest_size, const void *src, size_t src
 
     return CQ_SUCCESS;
 }
+
+// Arena block size when none is given
+#define DEFAULT_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Alignment of arena allocations
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+
+struct MemoryArenaBlock
+{
+    MemoryArenaBlock *next;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) unsigned char data[];
+};
+
+void memory_arena_init(MemoryArena *arena, size_t block_size)
+{
+    if (!arena)
+    {
+        return;
+    }
+
+    arena->blocks = NULL;
+    arena->block_size = block_size ? block_size : DEFAULT_ARENA_BLOCK_SIZE;
+    arena->allocated_bytes = 0;
+}
+
+/**
+ * @brief Allocate from the current block, or from a new one if it is full
+ */
+static void *arena_alloc(MemoryArena *arena, size_t size, size_t alignment)
+{
+    if (!arena || size == 0 || size > SIZE_MAX - ARENA_ALIGNMENT - sizeof(MemoryArenaBlock))
+    {
+        return NULL;
+    }
+
+    MemoryArenaBlock *block = arena->blocks;
+    size_t offset = block ? (block->used + alignment - 1) & ~(alignment - 1) : 0;
+    if (!block || offset > block->size || block->size - offset < size)
+    {
+        size_t block_size = size > arena->block_size ? size : arena->block_size;
+        MemoryArenaBlock *new_block = malloc(sizeof(MemoryArenaBlock) + block_size);
+        if (!new_block)
+        {
+            LOG_ERROR("Memory allocation failed for arena block of %zu bytes", block_size);
+            return NULL;
+        }
+        new_block->size = block_size;
+        new_block->used = 0;
+
+        // An oversized allocation does not retire the partly used current block
+        if (block && block_size > arena->block_size)
+        {
+            new_block->next = block->next;
+            block->next = new_block;
+        }
+        else
+        {
+            new_block->next = block;
+            arena->blocks = new_block;
+        }
+        block = new_block;
+        offset = 0;
+    }
+
+    void *ptr = block->data + offset;
+    block->used = offset + size;
+    arena->allocated_bytes += size;
+    return ptr;
+}
+
+void *memory_arena_alloc(MemoryArena *arena, size_t size)
+{
+    return arena_alloc(arena, size, ARENA_ALIGNMENT);
+}
+
+char *memory_arena_strndup(MemoryArena *arena, const char *str, size_t length)
+{
+    if (!str)
+    {
+        return NULL;
+    }
+
+    // Strings need no alignment, so they are packed back to back
+    char *copy = arena_alloc(arena, length + 1, 1);
+    if (!copy)
+    {
+        return NULL;
+    }
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void memory_arena_destroy(MemoryArena *arena)
+{
+    if (!arena)
+    {
+        return;
+    }
+
+    MemoryArenaBlock *block = arena->blocks;
+    while (block)
+    {
+        MemoryArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->allocated_bytes = 0;
+}
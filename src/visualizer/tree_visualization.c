@@ -243,7 +243,7 @@ static void traverse_project_recursive(const Project *project, uint32_t file_ind
         {
             uint32_t func_idx = file->function_start + i;
             FunctionInfo *func = function_array_get(&project->functions, func_idx);
-            if (func && func->class_id == 0) // Global function
+            if (func && func->class_id == CLASS_ID_NONE) // Global function
             {
                 traverse_project_recursive(project, file_index, UINT32_MAX, func_idx,
                                          &child_x_start, depth + 1, tree_nodes[current_node_index].node_id);
@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils/hash.h"
+#include "utils/mapped_file.h"
+#include "utils/memory.h"
+
+/**
+ * @file benchmark_hash.c
+ * @brief Compare the string hash against the hash*31 it replaced
+ *
+ * Usage: cqanalyzer_hash_benchmark [source_dir]
+ *
+ * Keys are taken from a real source tree: the relative paths of its C
+ * files, and the distinct identifiers found in them. For each corpus the
+ * time per key and the average probes per insert into a half-full
+ * linear-probing table are printed.
+ */
+
+#ifndef CQ_SOURCE_DIR
+#define CQ_SOURCE_DIR "."
+#endif
+
+/**
+ * @brief Growable array of keys copied into an arena
+ */
+typedef struct
+{
+    MemoryArena arena;
+    const char **keys;
+    int count;
+    int capacity;
+} KeyCorpus;
+
+static KeyCorpus paths;
+static KeyCorpus identifiers;
+static size_t root_length;
+
+static bool corpus_add(KeyCorpus *corpus, const char *key, size_t length)
+{
+    if (corpus->count == corpus->capacity)
+    {
+        int capacity = corpus->capacity ? corpus->capacity * 2 : 1024;
+        const char **keys = realloc(corpus->keys, capacity * sizeof(char *));
+        if (!keys)
+        {
+            return false;
+        }
+        corpus->keys = keys;
+        corpus->capacity = capacity;
+    }
+
+    const char *copy = memory_arena_strndup(&corpus->arena, key, length);
+    if (!copy)
+    {
+        return false;
+    }
+    corpus->keys[corpus->count++] = copy;
+    return true;
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Duplicate keys would always collide, so each key is kept once
+static void corpus_unique(KeyCorpus *corpus)
+{
+    if (corpus->count == 0)
+    {
+        return;
+    }
+    qsort(corpus->keys, corpus->count, sizeof(char *), compare_keys);
+    int unique = 1;
+    for (int i = 1; i < corpus->count; i++)
+    {
+        if (strcmp(corpus->keys[i], corpus->keys[unique - 1]) != 0)
+        {
+            corpus->keys[unique++] = corpus->keys[i];
+        }
+    }
+    corpus->count = unique;
+}
+
+static void corpus_destroy(KeyCorpus *corpus)
+{
+    free(corpus->keys);
+    memory_arena_destroy(&corpus->arena);
+}
+
+static bool is_identifier_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_identifier_char(char c)
+{
+    return is_identifier_start(c) || (c >= '0' && c <= '9');
+}
+
+// Identifiers as the source lexer splits them; comments and literals are not skipped
+static bool add_identifiers(const char *text, size_t size)
+{
+    const char *p = text;
+    const char *end = text + size;
+    while (p < end)
+    {
+        if (is_identifier_start(*p))
+        {
+            const char *start = p;
+            while (p < end && is_identifier_char(*p))
+            {
+                p++;
+            }
+            if (!corpus_add(&identifiers, start, p - start))
+            {
+                return false;
+            }
+        }
+        else if (is_identifier_char(*p))
+        {
+            // Skip the rest of a number so its suffix is not an identifier
+            while (p < end && is_identifier_char(*p))
+            {
+                p++;
+            }
+        }
+        else
+        {
+            p++;
+        }
+    }
+    return true;
+}
+
+static int visit_file(const char *path, const struct stat *info, int type, struct FTW *ftw)
+{
+    (void)info;
+    (void)ftw;
+    if (type != FTW_F)
+    {
+        return 0;
+    }
+    size_t length = strlen(path);
+    if (length < 2 || path[length - 2] != '.' || (path[length - 1] != 'c' && path[length - 1] != 'h'))
+    {
+        return 0;
+    }
+
+    const char *relative = path + root_length;
+    while (*relative == '/')
+    {
+        relative++;
+    }
+    if (!corpus_add(&paths, relative, strlen(relative)))
+    {
+        return 1;
+    }
+
+    MappedFile file;
+    if (mapped_file_open(path, &file) != CQ_SUCCESS)
+    {
+        return 0;
+    }
+    bool added = add_identifiers(file.data, file.size);
+    mapped_file_close(&file);
+    return added ? 0 : 1;
+}
+
+static uint64_t hash_31(const char *str, size_t length)
+{
+    uint32_t hash = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = hash * 31 + str[i];
+    }
+    return hash;
+}
+
+static uint64_t hash_cq(const char *str, size_t length)
+{
+    return cq_hash_bytes(str, length);
+}
+
+/**
+ * @brief Average probes per insert into a half-full linear-probing table
+ */
+static double measure_probes(uint64_t (*hash)(const char *, size_t), const char **keys, int count)
+{
+    uint32_t size = 1;
+    while (size < (uint32_t)count * 2)
+    {
+        size *= 2;
+    }
+    bool *used = calloc(size, sizeof(bool));
+    if (!used)
+    {
+        return 0.0;
+    }
+
+    long probes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t bucket = (uint32_t)hash(keys[i], strlen(keys[i])) & (size - 1);
+        for (probes++; used[bucket]; probes++)
+        {
+            bucket = (bucket + 1) & (size - 1);
+        }
+        used[bucket] = true;
+    }
+    free(used);
+    return (double)probes / count;
+}
+
+/**
+ * @brief Nanoseconds per key, best of several rounds
+ */
+static double measure_time(uint64_t (*hash)(const char *, size_t), const char **keys, const size_t *lengths,
+                           int count)
+{
+    const int rounds = 20;
+    volatile uint64_t sink = 0;
+    double best = 0.0;
+    for (int round = 0; round < rounds; round++)
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < count; i++)
+        {
+            sink += hash(keys[i], lengths[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        if (round == 0 || ns < best)
+        {
+            best = ns;
+        }
+    }
+    (void)sink;
+    return best / count;
+}
+
+static bool run_corpus(const char *name, const KeyCorpus *corpus)
+{
+    if (corpus->count == 0)
+    {
+        printf("%s: no keys\n", name);
+        return true;
+    }
+
+    size_t *lengths = malloc(corpus->count * sizeof(size_t));
+    if (!lengths)
+    {
+        return false;
+    }
+    for (int i = 0; i < corpus->count; i++)
+    {
+        lengths[i] = strlen(corpus->keys[i]);
+    }
+
+    printf("%s (%d keys): hash*31 %.2f ns/key, %.2f probes; cq_hash %.2f ns/key, %.2f probes\n", name,
+           corpus->count, measure_time(hash_31, corpus->keys, lengths, corpus->count),
+           measure_probes(hash_31, corpus->keys, corpus->count),
+           measure_time(hash_cq, corpus->keys, lengths, corpus->count),
+           measure_probes(hash_cq, corpus->keys, corpus->count));
+    free(lengths);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *root = argc > 1 ? argv[1] : CQ_SOURCE_DIR;
+    root_length = strlen(root);
+    memory_arena_init(&paths.arena, 0);
+    memory_arena_init(&identifiers.arena, 0);
+
+    int status = 0;
+    if (nftw(root, visit_file, 16, FTW_PHYS) != 0)
+    {
+        fprintf(stderr, "Failed to scan %s\n", root);
+        status = 1;
+    }
+    else
+    {
+        corpus_unique(&paths);
+        corpus_unique(&identifiers);
+        if (!run_corpus("paths", &paths) || !run_corpus("identifiers", &identifiers))
+        {
+            status = 1;
+        }
+    }
+
+    corpus_destroy(&paths);
+    corpus_destroy(&identifiers);
+    return status;
+}
@@ -463,6 +463,168 @@ void test_metric_array_normalization(void)
     CU_ASSERT_EQUAL(result, CQ_ERROR_INVALID_ARGUMENT);
 }
 
+/**
+ * @brief Test token classification and line categories of the source lexer
+ */
+void test_source_lexer(void)
+{
+    const char *text = "if (a <<= 0x1F) // shift\n"
+                       "  s = \"// not a comment\";\n"
+                       "\n"
+                       "/* one */ /* two\n"
+                       "*/ return 1.5e+3;";
+    SourceLexResult lex;
+    CU_ASSERT_EQUAL(source_lex(text, strlen(text), true, &lex), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(lex.physical_lines, 5);
+    CU_ASSERT_EQUAL(lex.code_lines, 3);
+    CU_ASSERT_EQUAL(lex.comment_lines, 1);
+    CU_ASSERT_EQUAL(lex.blank_lines, 1);
+
+    const SourceTokenKind expected[] = {
+        SOURCE_TOKEN_KEYWORD, SOURCE_TOKEN_PUNCTUATION, SOURCE_TOKEN_IDENTIFIER, SOURCE_TOKEN_OPERATOR,
+        SOURCE_TOKEN_NUMBER, SOURCE_TOKEN_PUNCTUATION, SOURCE_TOKEN_IDENTIFIER, SOURCE_TOKEN_OPERATOR,
+        SOURCE_TOKEN_STRING, SOURCE_TOKEN_PUNCTUATION, SOURCE_TOKEN_KEYWORD, SOURCE_TOKEN_NUMBER,
+        SOURCE_TOKEN_PUNCTUATION};
+    int count = (int)(sizeof(expected) / sizeof(expected[0]));
+    CU_ASSERT_EQUAL(lex.token_count, count);
+    for (int i = 0; i < count && i < lex.token_count; i++)
+    {
+        CU_ASSERT_EQUAL(lex.tokens[i].kind, expected[i]);
+    }
+
+    // Tokens are identified by the hash of their text
+    if (lex.token_count == count)
+    {
+        CU_ASSERT_EQUAL(lex.tokens[9].hash, lex.tokens[12].hash);
+        CU_ASSERT_NOT_EQUAL(lex.tokens[1].hash, lex.tokens[5].hash);
+    }
+    source_lex_result_free(&lex);
+
+    // Lines can be counted without storing tokens
+    CU_ASSERT_EQUAL(source_lex(text, strlen(text), false, &lex), CQ_SUCCESS);
+    CU_ASSERT_PTR_NULL(lex.tokens);
+    CU_ASSERT_EQUAL(lex.code_lines, 3);
+    CU_ASSERT_EQUAL(source_lex(NULL, 1, false, &lex), CQ_ERROR_INVALID_ARGUMENT);
+}
+
+/**
+ * @brief Check that both line counters agree with the lexer on a text
+ */
+static void assert_line_counts_match(const char *text, size_t length)
+{
+    SourceLexResult lex;
+    SourceLineCounts fast, scalar;
+    CU_ASSERT_EQUAL(source_lex(text, length, false, &lex), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(source_count_lines(text, length, &fast), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(source_count_lines_scalar(text, length, &scalar), CQ_SUCCESS);
+
+    CU_ASSERT_EQUAL(memcmp(&fast, &scalar, sizeof(fast)), 0);
+    CU_ASSERT_EQUAL(fast.physical_lines, lex.physical_lines);
+    CU_ASSERT_EQUAL(fast.code_lines, lex.code_lines);
+    CU_ASSERT_EQUAL(fast.comment_lines, lex.comment_lines);
+    CU_ASSERT_EQUAL(fast.blank_lines, lex.blank_lines);
+}
+
+/**
+ * @brief Test the vectorized line counter against the scalar path and the lexer
+ */
+void test_source_line_counts(void)
+{
+    // Comments and literals straddling 32-byte chunk boundaries
+    const char *text = "int a;                         /* spans\n"
+                       "                                          the boundary */ x\n"
+                       "   \t\t                                                          \n"
+                       "s = \"escaped \\\" quote /* not a comment */ \"; // trailing comment text\n"
+                       "/*                                                              */\n"
+                       "c = '\\'';                        // ends exactly at a chunk edge /\n"
+                       "/";
+    SourceLineCounts counts;
+    CU_ASSERT_EQUAL(source_count_lines(text, strlen(text), &counts), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(counts.physical_lines, 7);
+    CU_ASSERT_EQUAL(counts.code_lines, 5);
+    CU_ASSERT_EQUAL(counts.comment_lines, 1);
+    CU_ASSERT_EQUAL(counts.blank_lines, 1);
+    for (size_t offset = 0; offset < 40; offset++)
+    {
+        assert_line_counts_match(text + offset, strlen(text) - offset);
+    }
+
+    // Random texts dense in delimiters, at every length around the chunk size
+    static const char alphabet[] = "  \t\n\n/*\"'\\ax1;\r\x80";
+    char random[4096];
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < sizeof(random); i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        random[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    for (size_t length = 0; length < 200; length++)
+    {
+        assert_line_counts_match(random, length);
+    }
+    assert_line_counts_match(random, sizeof(random));
+
+    CU_ASSERT_EQUAL(source_count_lines(NULL, 1, &counts), CQ_ERROR_INVALID_ARGUMENT);
+    CU_ASSERT_EQUAL(source_count_lines(text, 0, NULL), CQ_ERROR_INVALID_ARGUMENT);
+}
+
+/**
+ * @brief Test the text analyzers on in-memory contents and a mapped file
+ */
+void test_text_metrics(void)
+{
+    // A code line longer than any fixed line buffer is still a single line
+    char long_line[3000];
+    memset(long_line, 'a', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+
+    char text[4096];
+    snprintf(text, sizeof(text), "int x = 1;\n\n   \n// note\n/* block\n   end */\nint %s = x + x;\nreturn", long_line);
+    size_t length = strlen(text);
+
+    int physical, logical, comment;
+    CU_ASSERT_EQUAL(calculate_lines_of_code_from_buffer(text, length, &physical, &logical, &comment), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(physical, 8);
+    CU_ASSERT_EQUAL(logical, 3);
+    CU_ASSERT_EQUAL(comment, 3);
+
+    // Operators: "=" twice, "+" and "return"; operands: identifiers and "1"
+    HalsteadMetrics metrics;
+    CU_ASSERT_EQUAL(calculate_halstead_metrics_from_buffer(text, length, &metrics), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(metrics.N1, 4);
+    CU_ASSERT_EQUAL(metrics.N2, 7);
+
+    double ratio;
+    CU_ASSERT_EQUAL(detect_duplication_from_buffer(text, length, &ratio), CQ_SUCCESS);
+    CU_ASSERT(ratio >= 0.0 && ratio <= 1.0);
+
+    CU_ASSERT_EQUAL(calculate_lines_of_code_from_buffer(NULL, 0, &physical, &logical, &comment), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(physical, 0);
+
+    // The combined pass over a mapped file matches the individual analyzers
+    const char *path = "test_text_metrics.c";
+    FILE *file = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL(file);
+    if (!file)
+    {
+        return;
+    }
+    fputs(text, file);
+    fclose(file);
+
+    TextMetrics text_metrics;
+    CU_ASSERT_EQUAL(calculate_text_metrics(path, &text_metrics), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(text_metrics.physical_loc, 8);
+    CU_ASSERT_EQUAL(text_metrics.logical_loc, 3);
+    CU_ASSERT_EQUAL(text_metrics.comment_loc, 3);
+    CU_ASSERT_EQUAL(text_metrics.halstead.N1, metrics.N1);
+    CU_ASSERT_EQUAL(text_metrics.halstead.N2, metrics.N2);
+    CU_ASSERT_DOUBLE_EQUAL(text_metrics.duplication_ratio, ratio, 0.0001);
+    remove(path);
+
+    CU_ASSERT_EQUAL(calculate_text_metrics("non_existent_file.c", &text_metrics), CQ_ERROR_FILE_NOT_FOUND);
+}
+
 /**
  * @brief Add analyzer tests to suite
  */
@@ -474,6 +636,9 @@ void add_analyzer_tests(CU_pSuite suite)
     CU_add_test(suite, "Nesting Depth Analyzer Test", test_nesting_depth_analyzer);
     CU_add_test(suite, "Halstead Metrics Test", test_halstead_metrics);
     CU_add_test(suite, "Duplication Detector Test", test_duplication_detector);
+    CU_add_test(suite, "Source Lexer Test", test_source_lexer);
+    CU_add_test(suite, "Source Line Counts Test", test_source_line_counts);
+    CU_add_test(suite, "Text Metrics Test", test_text_metrics);
     CU_add_test(suite, "Class Coupling Test", test_class_coupling);
     CU_add_test(suite, "Dead Code Detector Test", test_dead_code_detector);
     CU_add_test(suite, "Metric Normalization Test", test_metric_normalization);
@@ -1,12 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include <math.h>
 #include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "data/data_store.h"
 #include "data/metric_aggregator.h"
 #include "data/serialization.h"
+#include "data/ast_types.h"
+#include "data/analysis_cache.h"
 
 /**
  * @brief Test data store
@@ -24,6 +31,63 @@ void test_data_store(void)
     data_store_shutdown();
 }
 
+/**
+ * @brief Test metric columns with missing values and more files than the initial capacity
+ */
+void test_data_store_columns(void)
+{
+    enum { FILE_COUNT = 5000 };
+    CU_ASSERT_EQUAL(data_store_init(), CQ_SUCCESS);
+
+    // Every file has "loc"; only every third file has "complexity"
+    char filename[64];
+    bool all_added = true;
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        snprintf(filename, sizeof(filename), "src/module_%d/file_%d.c", i % 10, i);
+        all_added = all_added && data_store_add_file(filename, LANG_C) == CQ_SUCCESS &&
+                    data_store_add_metric(filename, "loc", (double)i) == CQ_SUCCESS;
+        if (i % 3 == 0)
+        {
+            all_added = all_added && data_store_add_metric(filename, "complexity", (double)i / 3) == CQ_SUCCESS;
+        }
+    }
+    CU_ASSERT_TRUE(all_added);
+
+    // Adding a file again keeps its values; adding a metric again replaces the value
+    CU_ASSERT_EQUAL(data_store_add_file("src/module_1/file_1.c", LANG_CPP), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(data_store_add_metric("src/module_1/file_1.c", "loc", 42.0), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(data_store_get_metric("src/module_1/file_1.c", "loc"), 42.0);
+    CU_ASSERT_EQUAL(data_store_get_metric("src/module_1/file_1.c", "complexity"), -1.0);
+    CU_ASSERT_EQUAL(data_store_get_metric("src/module_3/file_3.c", "complexity"), 1.0);
+    CU_ASSERT_EQUAL(data_store_get_metric("missing.c", "loc"), -1.0);
+    CU_ASSERT_EQUAL(data_store_get_metric("src/module_3/file_3.c", "missing"), -1.0);
+    CU_ASSERT_EQUAL(data_store_add_metric("missing.c", "loc", 1.0), CQ_ERROR_INVALID_ARGUMENT);
+
+    // Files and values come back in the order the files were added
+    static char filepaths[FILE_COUNT][MAX_PATH_LENGTH];
+    CU_ASSERT_EQUAL(data_store_get_all_files(filepaths, FILE_COUNT), FILE_COUNT);
+    CU_ASSERT_STRING_EQUAL(filepaths[FILE_COUNT - 1], "src/module_9/file_4999.c");
+
+    double *values = malloc(FILE_COUNT * sizeof(double));
+    CU_ASSERT_PTR_NOT_NULL(values);
+    if (values)
+    {
+        CU_ASSERT_EQUAL(data_store_get_all_metric_values("loc", values, FILE_COUNT), FILE_COUNT);
+        CU_ASSERT_EQUAL(values[1], 42.0);
+        CU_ASSERT_EQUAL(values[FILE_COUNT - 1], (double)(FILE_COUNT - 1));
+
+        int complexity_count = data_store_get_all_metric_values("complexity", values, FILE_COUNT);
+        CU_ASSERT_EQUAL(complexity_count, (FILE_COUNT + 2) / 3);
+        CU_ASSERT_EQUAL(values[complexity_count - 1], (double)(complexity_count - 1));
+        CU_ASSERT_EQUAL(data_store_get_all_metric_values("complexity", values, 10), 10);
+        CU_ASSERT_EQUAL(data_store_get_all_metric_values("missing", values, FILE_COUNT), 0);
+        free(values);
+    }
+
+    data_store_shutdown();
+}
+
 /**
  * @brief Test metric aggregation
  */
@@ -198,14 +262,542 @@ void test_batch_processing(void)
     data_store_shutdown();
 }
 
+/**
+ * @brief Test that interned strings keep their IDs while the pool grows
+ */
+void test_string_pool(void)
+{
+    StringPool pool;
+    CU_ASSERT_EQUAL(string_pool_init(&pool, 2), CQ_SUCCESS);
+
+    enum { STRING_COUNT = 50000 };
+    char str[64];
+    bool ids_match = true;
+    for (int i = 0; i < STRING_COUNT; i++)
+    {
+        snprintf(str, sizeof(str), "src/module_%d/file_%d.c", i % 97, i);
+        ids_match = ids_match && string_pool_intern(&pool, str) == (uint32_t)i;
+    }
+    CU_ASSERT_TRUE(ids_match);
+    CU_ASSERT_EQUAL(pool.count, STRING_COUNT);
+
+    // The lookup table grew with the pool instead of filling up
+    CU_ASSERT(pool.slot_count >= STRING_COUNT + STRING_COUNT / 3);
+
+    // Existing strings resolve to their first ID and keep their contents
+    bool lookups_match = true;
+    for (int i = 0; i < STRING_COUNT; i += 7)
+    {
+        snprintf(str, sizeof(str), "src/module_%d/file_%d.c", i % 97, i);
+        lookups_match = lookups_match && string_pool_intern(&pool, str) == (uint32_t)i &&
+                        strcmp(string_pool_get(&pool, (uint32_t)i), str) == 0;
+    }
+    CU_ASSERT_TRUE(lookups_match);
+    CU_ASSERT_EQUAL(pool.count, STRING_COUNT);
+
+    uint32_t found_id = 0;
+    CU_ASSERT_TRUE(string_pool_find(&pool, "src/module_3/file_100.c", &found_id));
+    CU_ASSERT_EQUAL(found_id, 100);
+    CU_ASSERT_FALSE(string_pool_find(&pool, "src/module_3/file_missing.c", &found_id));
+    CU_ASSERT_EQUAL(pool.count, STRING_COUNT);
+
+    uint32_t empty_id = string_pool_intern(&pool, "");
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&pool, empty_id), "");
+    CU_ASSERT_EQUAL(string_pool_intern(&pool, ""), empty_id);
+    CU_ASSERT_PTR_NULL(string_pool_get(&pool, pool.count));
+
+    string_pool_destroy(&pool);
+}
+
+enum { CONCURRENT_STRING_COUNT = 4000, CONCURRENT_THREAD_COUNT = 4 };
+
+typedef struct
+{
+    StringPool *pool;
+    int offset;
+    uint32_t ids[CONCURRENT_STRING_COUNT];
+} ConcurrentInternJob;
+
+static void *concurrent_intern_thread(void *arg)
+{
+    ConcurrentInternJob *job = (ConcurrentInternJob *)arg;
+    char str[64];
+
+    // Threads start at different strings so that both new and existing strings race
+    for (int n = 0; n < CONCURRENT_STRING_COUNT; n++)
+    {
+        int i = (n + job->offset) % CONCURRENT_STRING_COUNT;
+        snprintf(str, sizeof(str), "identifier_%d", i);
+        job->ids[i] = string_pool_intern(job->pool, str);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Test interning from several threads and merging with pre-interned strings
+ */
+void test_string_pool_concurrent(void)
+{
+    Project project = {0};
+    CU_ASSERT_EQUAL(project_init(&project, "/project", 4), CQ_SUCCESS);
+    StringPool *pool = &project.string_pool;
+    uint32_t before_id = string_pool_intern(pool, "identifier_7");
+
+    CU_ASSERT_EQUAL(string_pool_enable_concurrent(pool), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(string_pool_intern(pool, "identifier_7"), before_id);
+
+    static ConcurrentInternJob jobs[CONCURRENT_THREAD_COUNT];
+    pthread_t threads[CONCURRENT_THREAD_COUNT];
+    for (int t = 0; t < CONCURRENT_THREAD_COUNT; t++)
+    {
+        jobs[t].pool = pool;
+        jobs[t].offset = t * CONCURRENT_STRING_COUNT / CONCURRENT_THREAD_COUNT;
+        CU_ASSERT_EQUAL(pthread_create(&threads[t], NULL, concurrent_intern_thread, &jobs[t]), 0);
+    }
+    for (int t = 0; t < CONCURRENT_THREAD_COUNT; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    // Every thread got the same ID for a string, and each string was stored once
+    bool ids_match = true;
+    char str[64];
+    for (int i = 0; i < CONCURRENT_STRING_COUNT; i++)
+    {
+        snprintf(str, sizeof(str), "identifier_%d", i);
+        const char *stored = string_pool_get(pool, jobs[0].ids[i]);
+        ids_match = ids_match && stored && strcmp(stored, str) == 0;
+        for (int t = 1; t < CONCURRENT_THREAD_COUNT; t++)
+        {
+            ids_match = ids_match && jobs[t].ids[i] == jobs[0].ids[i];
+        }
+    }
+    CU_ASSERT_TRUE(ids_match);
+    CU_ASSERT_EQUAL(jobs[0].ids[7], before_id);
+    CU_ASSERT_EQUAL(pool->count, CONCURRENT_STRING_COUNT + 1);
+
+    // Strings interned ahead of the merge give the same result as project_merge()
+    Project src = {0};
+    CU_ASSERT_EQUAL(project_init(&src, "/project/a.c", 4), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(project_add_file(&src, "/project/a.c", LANG_C, NULL), CQ_SUCCESS);
+    FunctionInfo func = {0};
+    func.name_id = string_pool_intern(&src.string_pool, "identifier_42");
+    CU_ASSERT_EQUAL(project_add_function(&src, &func, NULL), CQ_SUCCESS);
+
+    uint32_t *string_map = NULL;
+    uint32_t first_file = 0;
+    CU_ASSERT_EQUAL(project_intern_strings(&project, &src, &string_map), CQ_SUCCESS);
+    CU_ASSERT_PTR_NOT_NULL(string_map);
+    CU_ASSERT_EQUAL(project_merge_mapped(&project, &src, string_map, &first_file), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(project.functions.count, 1);
+    CU_ASSERT_EQUAL(function_array_get(&project.functions, 0)->name_id, jobs[0].ids[42]);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(pool, file_array_get(&project.files, first_file)->filepath_id),
+                           "/project/a.c");
+
+    free(string_map);
+    project_destroy(&src);
+    project_destroy(&project);
+}
+
+/**
+ * @brief Test the column view of function metrics against the records
+ */
+void test_function_columns(void)
+{
+    enum { FUNCTION_COUNT = 200000 };
+    FunctionArray functions;
+    CU_ASSERT_EQUAL(function_array_init(&functions, 16), CQ_SUCCESS);
+    bool all_added = true;
+    for (uint32_t i = 0; i < FUNCTION_COUNT; i++)
+    {
+        FunctionInfo func = {0};
+        func.complexity = (i * 7919) % 41;
+        func.nesting_depth = i % 9;
+        func.lines_of_code = 5 + i % 300;
+        func.parameter_count = i % 6;
+        all_added = all_added && function_array_add(&functions, &func) == CQ_SUCCESS;
+    }
+    CU_ASSERT_TRUE(all_added);
+    if (!all_added)
+    {
+        function_array_destroy(&functions);
+        return;
+    }
+
+    FunctionColumns columns = {0};
+    CU_ASSERT_EQUAL(function_columns_build(&columns, &functions), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(columns.count, FUNCTION_COUNT);
+
+    bool columns_match = true;
+    uint64_t expected_lines = 0;
+    for (uint32_t i = 0; i < FUNCTION_COUNT; i++)
+    {
+        const FunctionInfo *func = function_array_get(&functions, i);
+        columns_match = columns_match && columns.columns[FUNCTION_METRIC_COMPLEXITY][i] == func->complexity &&
+                        columns.columns[FUNCTION_METRIC_NESTING_DEPTH][i] == func->nesting_depth &&
+                        columns.columns[FUNCTION_METRIC_LINES_OF_CODE][i] == func->lines_of_code &&
+                        columns.columns[FUNCTION_METRIC_PARAMETER_COUNT][i] == func->parameter_count;
+        expected_lines += func->lines_of_code;
+    }
+    CU_ASSERT_TRUE(columns_match);
+    CU_ASSERT_EQUAL(function_columns_sum(&columns, FUNCTION_METRIC_LINES_OF_CODE), expected_lines);
+
+    // Selecting from the column finds the same functions as scanning the records
+    uint32_t *indices = malloc(FUNCTION_COUNT * sizeof(uint32_t));
+    uint32_t *expected_indices = malloc(FUNCTION_COUNT * sizeof(uint32_t));
+    CU_ASSERT_PTR_NOT_NULL(indices);
+    CU_ASSERT_PTR_NOT_NULL(expected_indices);
+    if (indices && expected_indices)
+    {
+        clock_t start = clock();
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < FUNCTION_COUNT; i++)
+        {
+            if (functions.functions[i].complexity > 20)
+            {
+                expected_indices[expected++] = i;
+            }
+        }
+        double record_ms = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+
+        start = clock();
+        uint32_t selected = function_columns_select_above(&columns, FUNCTION_METRIC_COMPLEXITY, 20, indices);
+        double column_ms = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+        printf("Benchmark: complexity > 20 over %d functions: records %.2f ms, column %.2f ms\n", FUNCTION_COUNT,
+               record_ms, column_ms);
+
+        CU_ASSERT_EQUAL(selected, expected);
+        CU_ASSERT(selected == expected && memcmp(indices, expected_indices, selected * sizeof(uint32_t)) == 0);
+    }
+    free(indices);
+    free(expected_indices);
+
+    // A rebuild picks up changed and added functions
+    function_array_get(&functions, 3)->complexity = 99;
+    FunctionInfo extra = {0};
+    extra.parameter_count = 12;
+    CU_ASSERT_EQUAL(function_array_add(&functions, &extra), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(function_columns_build(&columns, &functions), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(columns.count, FUNCTION_COUNT + 1);
+    CU_ASSERT_EQUAL(columns.columns[FUNCTION_METRIC_COMPLEXITY][3], 99);
+    CU_ASSERT_EQUAL(columns.columns[FUNCTION_METRIC_PARAMETER_COUNT][FUNCTION_COUNT], 12);
+
+    function_columns_destroy(&columns);
+    CU_ASSERT_PTR_NULL(columns.columns[0]);
+    function_array_destroy(&functions);
+}
+
+/**
+ * @brief Test merging a per-file project into a project
+ */
+void test_project_merge(void)
+{
+    Project dest = {0};
+    Project src = {0};
+    CU_ASSERT_EQUAL(project_init(&dest, "/project", 4), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(project_init(&src, "/project/b.c", 4), CQ_SUCCESS);
+
+    // dest already holds one file with one function and one class
+    CU_ASSERT_EQUAL(project_add_file(&dest, "/project/a.c", LANG_C, NULL), CQ_SUCCESS);
+    FunctionInfo existing = {0};
+    existing.name_id = string_pool_intern(&dest.string_pool, "alpha");
+    existing.class_id = CLASS_ID_NONE;
+    CU_ASSERT_EQUAL(project_add_function(&dest, &existing, NULL), CQ_SUCCESS);
+    ClassInfo gadget = {0};
+    gadget.name_id = string_pool_intern(&dest.string_pool, "Gadget");
+    CU_ASSERT_EQUAL(project_add_class(&dest, &gadget, NULL), CQ_SUCCESS);
+
+    // src has its own string pool, so its IDs differ from dest's
+    CU_ASSERT_EQUAL(project_add_file(&src, "/project/b.c", LANG_C, NULL), CQ_SUCCESS);
+    for (int i = 0; i < 5; i++)
+    {
+        FunctionInfo func = {0};
+        func.name_id = string_pool_intern(&src.string_pool, i == 0 ? "alpha" : "beta");
+        func.return_type_id = string_pool_intern(&src.string_pool, "int");
+        func.complexity = (uint32_t)i + 1;
+        func.class_id = i == 2 ? 0 : CLASS_ID_NONE;
+        CU_ASSERT_EQUAL(project_add_function(&src, &func, NULL), CQ_SUCCESS);
+    }
+
+    uint32_t method = 2;
+    ClassInfo cls = {0};
+    cls.name_id = string_pool_intern(&src.string_pool, "Widget");
+    cls.method_count = 1;
+    cls.method_indices = &method;
+    CU_ASSERT_EQUAL(project_add_class(&src, &cls, NULL), CQ_SUCCESS);
+
+    CallEdge call = {0};
+    call.caller_index = 4;
+    call.callee_name_id = string_pool_intern(&src.string_pool, "gamma");
+    CU_ASSERT_EQUAL(call_edge_array_add(&src.calls, &call), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(symbol_table_add(&src.symbol_table, string_pool_intern(&src.string_pool, "beta"), 0), CQ_SUCCESS);
+
+    uint32_t first_file = 0;
+    CU_ASSERT_EQUAL(project_merge(&dest, &src, &first_file), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(first_file, 1);
+
+    CU_ASSERT_EQUAL(dest.files.count, 2);
+    CU_ASSERT_EQUAL(dest.functions.count, 6);
+    CU_ASSERT_EQUAL(dest.total_functions, 6);
+    CU_ASSERT_EQUAL(dest.classes.count, 2);
+
+    // File ranges cover exactly the merged entities
+    FileInfo *merged = file_array_get(&dest.files, 1);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&dest.string_pool, merged->filepath_id), "/project/b.c");
+    CU_ASSERT_EQUAL(merged->function_start, 1);
+    CU_ASSERT_EQUAL(merged->function_count, 5);
+    CU_ASSERT_EQUAL(merged->class_start, 1);
+    CU_ASSERT_EQUAL(merged->class_count, 1);
+
+    // Only the method is rebased; free functions stay without a class
+    CU_ASSERT_EQUAL(function_array_get(&dest.functions, 0)->class_id, CLASS_ID_NONE);
+    CU_ASSERT_EQUAL(function_array_get(&dest.functions, 1)->class_id, CLASS_ID_NONE);
+    CU_ASSERT_EQUAL(function_array_get(&dest.functions, 3)->class_id, 1);
+
+    // String IDs resolve through the destination pool
+    FunctionInfo *func = function_array_get(&dest.functions, 1);
+    CU_ASSERT_EQUAL(func->name_id, existing.name_id);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&dest.string_pool, func->return_type_id), "int");
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&dest.string_pool, function_array_get(&dest.functions, 5)->name_id), "beta");
+    CU_ASSERT_EQUAL(func->location.file_id, 1);
+
+    // Method indices are rebased and owned by dest
+    ClassInfo *merged_class = class_array_get(&dest.classes, 1);
+    CU_ASSERT_EQUAL(merged_class->method_indices[0], 3);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&dest.string_pool, merged_class->name_id), "Widget");
+    CU_ASSERT_PTR_NULL(src.classes.classes[0].method_indices);
+
+    // Call edges point at the rebased caller and the remapped callee name
+    CU_ASSERT_EQUAL(dest.calls.count, 1);
+    CallEdge *merged_call = call_edge_array_get(&dest.calls, 0);
+    CU_ASSERT_EQUAL(merged_call->caller_index, 5);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&dest.string_pool, merged_call->callee_name_id), "gamma");
+
+    // Symbols point at the rebased file
+    CU_ASSERT_EQUAL(dest.symbol_table.count, 1);
+    CU_ASSERT_EQUAL(symbol_table_find(&dest.symbol_table, string_pool_intern(&dest.string_pool, "beta")), 1);
+
+    project_destroy(&src);
+    project_destroy(&dest);
+}
+
+/**
+ * @brief Test that sorting files by path carries their records along
+ */
+void test_project_sort_files(void)
+{
+    Project project = {0};
+    CU_ASSERT_EQUAL(project_init(&project, "/project", 4), CQ_SUCCESS);
+
+    // b.c comes first, with two functions, a class and a call
+    CU_ASSERT_EQUAL(project_add_file(&project, "/project/b.c", LANG_C, NULL), CQ_SUCCESS);
+    FunctionInfo func = {0};
+    func.name_id = string_pool_intern(&project.string_pool, "b1");
+    func.class_id = CLASS_ID_NONE;
+    CU_ASSERT_EQUAL(project_add_function(&project, &func, NULL), CQ_SUCCESS);
+    func.name_id = string_pool_intern(&project.string_pool, "b2");
+    func.class_id = 0;
+    CU_ASSERT_EQUAL(project_add_function(&project, &func, NULL), CQ_SUCCESS);
+
+    uint32_t method = 1;
+    ClassInfo cls = {0};
+    cls.name_id = string_pool_intern(&project.string_pool, "Widget");
+    cls.method_count = 1;
+    cls.method_indices = &method;
+    CU_ASSERT_EQUAL(project_add_class(&project, &cls, NULL), CQ_SUCCESS);
+
+    CallEdge call = {0};
+    call.caller_index = 1;
+    CU_ASSERT_EQUAL(call_edge_array_add(&project.calls, &call), CQ_SUCCESS);
+
+    // a.c follows with one function and one variable
+    CU_ASSERT_EQUAL(project_add_file(&project, "/project/a.c", LANG_C, NULL), CQ_SUCCESS);
+    func.name_id = string_pool_intern(&project.string_pool, "a1");
+    func.location.file_id = 1;
+    func.class_id = CLASS_ID_NONE;
+    CU_ASSERT_EQUAL(project_add_function(&project, &func, NULL), CQ_SUCCESS);
+    VariableInfo var = {0};
+    var.location.file_id = 1;
+    CU_ASSERT_EQUAL(project_add_variable(&project, &var, NULL), CQ_SUCCESS);
+
+    CU_ASSERT_EQUAL(project_sort_files(&project), CQ_SUCCESS);
+
+    FileInfo *first = file_array_get(&project.files, 0);
+    FileInfo *second = file_array_get(&project.files, 1);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&project.string_pool, first->filepath_id), "/project/a.c");
+    CU_ASSERT_EQUAL(first->function_start, 0);
+    CU_ASSERT_EQUAL(first->function_count, 1);
+    CU_ASSERT_EQUAL(first->variable_start, 0);
+    CU_ASSERT_EQUAL(second->function_start, 1);
+    CU_ASSERT_EQUAL(second->function_count, 2);
+
+    // Records keep their order within a file and point at the new indices
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&project.string_pool, function_array_get(&project.functions, 0)->name_id), "a1");
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&project.string_pool, function_array_get(&project.functions, 2)->name_id), "b2");
+    CU_ASSERT_EQUAL(function_array_get(&project.functions, 0)->location.file_id, 0);
+    CU_ASSERT_EQUAL(function_array_get(&project.functions, 2)->location.file_id, 1);
+    CU_ASSERT_EQUAL(class_array_get(&project.classes, 0)->file_id, 1);
+    CU_ASSERT_EQUAL(class_array_get(&project.classes, 0)->method_indices[0], 2);
+    CU_ASSERT_EQUAL(function_array_get(&project.functions, 0)->class_id, CLASS_ID_NONE);
+    CU_ASSERT_EQUAL(function_array_get(&project.functions, 2)->class_id, 0);
+    CU_ASSERT_EQUAL(call_edge_array_get(&project.calls, 0)->caller_index, 2);
+    CU_ASSERT_EQUAL(variable_array_get(&project.variables, 0)->location.file_id, 0);
+
+    project_destroy(&project);
+}
+
+/**
+ * @brief Test that the analysis cache restores unchanged files only
+ */
+void test_analysis_cache(void)
+{
+    const char *source_path = "test_analysis_cache_input.c";
+    const char *header_path = "test_analysis_cache_input.h";
+    const char *cache_path = "test_analysis_cache.bin";
+    const char *contents = "int main(void) { return 0; }\n";
+    const char *changed = "int main(void) { return 9; }\n";
+
+    // Per-file project as produced by the parser
+    Project parsed = {0};
+    CU_ASSERT_EQUAL(project_init(&parsed, source_path, 4), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(project_add_file(&parsed, source_path, LANG_C, NULL), CQ_SUCCESS);
+    FunctionInfo func = {0};
+    func.name_id = string_pool_intern(&parsed.string_pool, "main");
+    func.complexity = 3;
+    CU_ASSERT_EQUAL(project_add_function(&parsed, &func, NULL), CQ_SUCCESS);
+    uint32_t method = 0;
+    ClassInfo cls = {0};
+    cls.name_id = string_pool_intern(&parsed.string_pool, "Widget");
+    cls.method_count = 1;
+    cls.method_indices = &method;
+    CU_ASSERT_EQUAL(project_add_class(&parsed, &cls, NULL), CQ_SUCCESS);
+
+    AnalysisCache *cache = analysis_cache_load(cache_path, 0);
+    CU_ASSERT_PTR_NOT_NULL(cache);
+    if (!cache)
+    {
+        return;
+    }
+
+    // The records also came from an included header
+    FILE *header = fopen(header_path, "w");
+    CU_ASSERT_PTR_NOT_NULL(header);
+    if (!header)
+    {
+        analysis_cache_destroy(cache);
+        return;
+    }
+    fputs("int helper(void);\n", header);
+    fclose(header);
+    struct stat st;
+    CU_ASSERT_EQUAL(stat(header_path, &st), 0);
+    AnalysisCacheDependency dependency = {
+        header_path, (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec, (int64_t)st.st_size
+    };
+
+    // Storing needs the hash of the contents that were parsed
+    AnalysisCacheKey key;
+    analysis_cache_key_init(&key, 1000000001, strlen(contents));
+    CU_ASSERT_EQUAL(analysis_cache_store(cache, source_path, &key, &parsed, &dependency, 1),
+                    CQ_ERROR_INVALID_ARGUMENT);
+    analysis_cache_key_hash(&key, contents);
+    CU_ASSERT_TRUE(key.has_hash);
+    CU_ASSERT_EQUAL(analysis_cache_store(cache, source_path, &key, &parsed, &dependency, 1), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(analysis_cache_save(cache, cache_path), CQ_SUCCESS);
+    analysis_cache_destroy(cache);
+    project_destroy(&parsed);
+
+    // Unchanged file: records come back with the same string IDs and metrics
+    cache = analysis_cache_load(cache_path, 0);
+    CU_ASSERT_PTR_NOT_NULL(cache);
+    if (!cache)
+    {
+        return;
+    }
+    analysis_cache_key_init(&key, 1000000001, strlen(contents));
+    Project *restored = analysis_cache_lookup(cache, source_path, &key, contents);
+    CU_ASSERT_PTR_NOT_NULL(restored);
+    if (!restored)
+    {
+        return;
+    }
+    CU_ASSERT_FALSE(key.has_hash);
+    CU_ASSERT_EQUAL(restored->files.count, 1);
+    CU_ASSERT_EQUAL(restored->functions.count, 1);
+    CU_ASSERT_EQUAL(file_array_get(&restored->files, 0)->function_count, 1);
+    FunctionInfo *restored_func = function_array_get(&restored->functions, 0);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&restored->string_pool, restored_func->name_id), "main");
+    CU_ASSERT_EQUAL(restored_func->complexity, 3);
+    ClassInfo *restored_class = class_array_get(&restored->classes, 0);
+    CU_ASSERT_STRING_EQUAL(string_pool_get(&restored->string_pool, restored_class->name_id), "Widget");
+    CU_ASSERT_EQUAL(restored_class->method_indices[0], 0);
+    project_destroy(restored);
+    free(restored);
+
+    // Touched within the same second but unchanged: hit through the content hash
+    analysis_cache_key_init(&key, 1000000002, strlen(contents));
+    restored = analysis_cache_lookup(cache, source_path, &key, contents);
+    CU_ASSERT_PTR_NOT_NULL(restored);
+    CU_ASSERT_TRUE(key.has_hash);
+    if (restored)
+    {
+        project_destroy(restored);
+        free(restored);
+    }
+
+    // Changed contents of the same size: miss
+    analysis_cache_key_init(&key, 1000000003, strlen(changed));
+    CU_ASSERT_PTR_NULL(analysis_cache_lookup(cache, source_path, &key, changed));
+
+    // Unchanged file with a changed header: miss once the cache is loaded again
+    header = fopen(header_path, "a");
+    if (header)
+    {
+        fputs("int other(void);\n", header);
+        fclose(header);
+    }
+    analysis_cache_destroy(cache);
+    cache = analysis_cache_load(cache_path, 0);
+    CU_ASSERT_PTR_NOT_NULL(cache);
+    if (!cache)
+    {
+        remove(header_path);
+        return;
+    }
+    analysis_cache_key_init(&key, 1000000001, strlen(contents));
+    CU_ASSERT_PTR_NULL(analysis_cache_lookup(cache, source_path, &key, contents));
+
+    // Entries neither stored nor retained are dropped on save
+    CU_ASSERT_EQUAL(analysis_cache_save(cache, cache_path), CQ_SUCCESS);
+    analysis_cache_destroy(cache);
+    cache = analysis_cache_load(cache_path, 0);
+    CU_ASSERT_PTR_NOT_NULL(cache);
+    if (!cache)
+    {
+        return;
+    }
+    CU_ASSERT_EQUAL(analysis_cache_retain(cache, source_path, NULL), CQ_ERROR_INVALID_ARGUMENT);
+    analysis_cache_destroy(cache);
+
+    remove(header_path);
+    remove(cache_path);
+}
+
 /**
  * @brief Add data tests to suite
  */
 void add_data_tests(CU_pSuite suite)
 {
     CU_add_test(suite, "Data Store Test", test_data_store);
+    CU_add_test(suite, "Data Store Columns Test", test_data_store_columns);
     CU_add_test(suite, "Metric Aggregator Test", test_metric_aggregator);
     CU_add_test(suite, "Serialization Test", test_serialization);
     CU_add_test(suite, "Benchmark Data Processing", benchmark_data_processing);
     CU_add_test(suite, "Batch Processing Test", test_batch_processing);
+    CU_add_test(suite, "String Pool Test", test_string_pool);
+    CU_add_test(suite, "Concurrent String Pool Test", test_string_pool_concurrent);
+    CU_add_test(suite, "Function Columns Test", test_function_columns);
+    CU_add_test(suite, "Project Merge Test", test_project_merge);
+    CU_add_test(suite, "Project Sort Files Test", test_project_sort_files);
+    CU_add_test(suite, "Analysis Cache Test", test_analysis_cache);
 }
@@ -1,13 +1,24 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "parser/file_scanner.h"
+#include "parser/file_prefetch.h"
+#include "parser/path_filter.h"
 #include "parser/ast_parser.h"
 #include "parser/language_support.h"
 #include "parser/preprocessor.h"
 #include "parser/generic_parser.h"
+#include "parser/pch_cache.h"
+#include "parser/compile_database.h"
+#include "utils/config.h"
 
 /**
  * @brief Test file scanning
@@ -68,14 +79,470 @@ void test_file_scanner_invalid_params(void)
 }
 
 /**
- * @brief Test AST parsing
+ * @brief Test the parallel scanner on a small tree with a tiny output buffer
+ */
+void test_file_scan_parallel(void)
+{
+    const char *dirs[] = {"test_scan_tree", "test_scan_tree/a", "test_scan_tree/b", "test_scan_tree/b/c"};
+    const char *sources[] = {"test_scan_tree/main.c", "test_scan_tree/a/x.h", "test_scan_tree/a/y.py",
+                             "test_scan_tree/b/z.cpp", "test_scan_tree/b/c/w.java", "test_scan_tree/b/c/v.c"};
+    const char *other = "test_scan_tree/b/notes.txt";
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++)
+    {
+        mkdir(dirs[i], 0755);
+    }
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+    {
+        FILE *file = fopen(sources[i], "w");
+        if (file)
+        {
+            fputs("x\n", file);
+            fclose(file);
+        }
+    }
+    FILE *file = fopen(other, "w");
+    if (file)
+    {
+        fclose(file);
+    }
+
+    // Scanners block on the two-slot buffer until files are consumed
+    FileScan *scan = file_scan_start("test_scan_tree", 4, 2, true, NULL);
+    CU_ASSERT_PTR_NOT_NULL(scan);
+    if (scan)
+    {
+        int found = 0;
+        char *path;
+        long long size = 0;
+        while (file_scan_next(scan, &path, &size))
+        {
+            CU_ASSERT_EQUAL(size, 2);
+            free(path);
+            found++;
+        }
+        CU_ASSERT_EQUAL(found, 6);
+
+        // The pre-pass may still be running; the total is exact either way
+        FileScanProgress progress;
+        file_scan_progress(scan, &progress);
+        CU_ASSERT(progress.finished);
+        CU_ASSERT_EQUAL(progress.dirs_scanned, 4);
+        CU_ASSERT_EQUAL(progress.dirs_total, 4);
+        CU_ASSERT_EQUAL(progress.files_found, 6);
+        CU_ASSERT_EQUAL(progress.files_estimate, 6);
+        CU_ASSERT_EQUAL(file_scan_finish(scan), 6);
+    }
+
+    // The array interface returns the same files sorted by path
+    char *files[10];
+    int count = scan_directory("test_scan_tree", files, 10);
+    CU_ASSERT_EQUAL(count, 6);
+    for (int i = 1; i < count; i++)
+    {
+        CU_ASSERT(strcmp(files[i - 1], files[i]) < 0);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        free(files[i]);
+    }
+
+    // Stopping early is safe while scanners are blocked on a full buffer
+    scan = file_scan_start("test_scan_tree", 2, 2, true, NULL);
+    CU_ASSERT_PTR_NOT_NULL(scan);
+    CU_ASSERT_EQUAL(file_scan_finish(scan), 0);
+
+    remove(other);
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+    {
+        remove(sources[i]);
+    }
+    for (size_t i = sizeof(dirs) / sizeof(dirs[0]); i > 0; i--)
+    {
+        rmdir(dirs[i - 1]);
+    }
+}
+
+/**
+ * @brief Count the files a filtered scan of test_filter_tree finds
+ */
+static int count_filtered_files(const PathFilter *filter)
+{
+    FileScan *scan = file_scan_start("test_filter_tree", 2, 4, true, filter);
+    CU_ASSERT_PTR_NOT_NULL(scan);
+    if (!scan)
+    {
+        return -1;
+    }
+
+    char *path;
+    while (file_scan_next(scan, &path, NULL))
+    {
+        free(path);
+    }
+    return file_scan_finish(scan);
+}
+
+/**
+ * @brief Test glob, .gitignore and depth exclusion in the scanner
+ */
+void test_scan_exclusion(void)
+{
+    PathFilter *filter = path_filter_create("build/, *.gen.c, docs/**/*.c, !keep.gen.c", false, 0);
+    CU_ASSERT_PTR_NOT_NULL(filter);
+    if (!filter)
+    {
+        return;
+    }
+    CU_ASSERT_TRUE(path_filter_excludes(filter, NULL, "build", true));
+    CU_ASSERT_TRUE(path_filter_excludes(filter, NULL, "src/build", true));
+    CU_ASSERT_FALSE(path_filter_excludes(filter, NULL, "build", false));
+    CU_ASSERT_TRUE(path_filter_excludes(filter, NULL, "src/x.gen.c", false));
+    CU_ASSERT_FALSE(path_filter_excludes(filter, NULL, "src/keep.gen.c", false));
+    CU_ASSERT_TRUE(path_filter_excludes(filter, NULL, "docs/x.c", false));
+    CU_ASSERT_TRUE(path_filter_excludes(filter, NULL, "docs/a/b/x.c", false));
+    CU_ASSERT_FALSE(path_filter_excludes(filter, NULL, "src/docs/x.c", false));
+    CU_ASSERT_FALSE(path_filter_excludes(filter, NULL, "docs/x.h", false));
+    CU_ASSERT_TRUE(path_filter_allows_depth(filter, 100));
+    path_filter_destroy(filter);
+
+    // The nested .gitignore re-includes a file ignored by the root one
+    const char *dirs[] = {"test_filter_tree", "test_filter_tree/generated", "test_filter_tree/sub",
+                          "test_filter_tree/sub/deep"};
+    const char *files[][2] = {{"test_filter_tree/.gitignore", "# build output\ngenerated/\n*.skip.c\n"},
+                              {"test_filter_tree/sub/.gitignore", "!b.skip.c\n"},
+                              {"test_filter_tree/a.c", ""},
+                              {"test_filter_tree/a.skip.c", ""},
+                              {"test_filter_tree/generated/g.c", ""},
+                              {"test_filter_tree/sub/b.skip.c", ""},
+                              {"test_filter_tree/sub/deep/d.c", ""}};
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++)
+    {
+        mkdir(dirs[i], 0755);
+    }
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        FILE *file = fopen(files[i][0], "w");
+        if (file)
+        {
+            fputs(files[i][1], file);
+            fclose(file);
+        }
+    }
+
+    CU_ASSERT_EQUAL(count_filtered_files(NULL), 5);
+
+    filter = path_filter_create(NULL, true, 0);
+    CU_ASSERT_EQUAL(count_filtered_files(filter), 3);
+    path_filter_destroy(filter);
+
+    filter = path_filter_create(NULL, true, 1);
+    CU_ASSERT_EQUAL(count_filtered_files(filter), 2);
+    path_filter_destroy(filter);
+
+    filter = path_filter_create("sub/", false, 0);
+    CU_ASSERT_EQUAL(count_filtered_files(filter), 3);
+    path_filter_destroy(filter);
+
+    for (size_t i = sizeof(files) / sizeof(files[0]); i > 0; i--)
+    {
+        remove(files[i - 1][0]);
+    }
+    for (size_t i = sizeof(dirs) / sizeof(dirs[0]); i > 0; i--)
+    {
+        rmdir(dirs[i - 1]);
+    }
+}
+
+// Files of test_prefetch_tree; f<n>.c holds n declarations
+#define PREFETCH_TEST_FILES 20
+
+static void format_prefetch_contents(int lines, char *buffer, size_t size)
+{
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int i = 0; i < lines && length < size; i++)
+    {
+        length += snprintf(buffer + length, size - length, "int v%d;\n", i);
+    }
+}
+
+/**
+ * @brief Consume a prefetched scan of test_prefetch_tree, checking loaded contents
+ *
+ * @return Number of files returned
+ */
+static int consume_prefetch(size_t memory_budget)
+{
+    FileScan *scan = file_scan_start("test_prefetch_tree", 2, 4, false, NULL);
+    CU_ASSERT_PTR_NOT_NULL(scan);
+    if (!scan)
+    {
+        return -1;
+    }
+    FilePrefetch *prefetch = file_prefetch_start(scan, 2, memory_budget);
+    CU_ASSERT_PTR_NOT_NULL(prefetch);
+
+    int count = 0;
+    PrefetchedFile file;
+    while (file_prefetch_next(prefetch, &file))
+    {
+        // Only files larger than the whole budget are passed on unloaded
+        CU_ASSERT_EQUAL(file.contents != NULL, (unsigned long long)file.size < memory_budget);
+
+        // Those are loaded by the consumer, outside the budget
+        if (!file.contents)
+        {
+            CU_ASSERT_TRUE(file_prefetch_load(&file));
+            CU_ASSERT_FALSE(file.budgeted);
+        }
+        CU_ASSERT_TRUE(file.mtime_ns > 0);
+
+        int lines = -1;
+        const char *name = strrchr(file.path, '/');
+        if (file.contents && name && sscanf(name, "/f%d.c", &lines) == 1)
+        {
+            char expected[512];
+            format_prefetch_contents(lines, expected, sizeof(expected));
+            CU_ASSERT_EQUAL(file.length, strlen(expected));
+            CU_ASSERT_STRING_EQUAL(file.contents, expected);
+        }
+        file_prefetch_release(prefetch, &file);
+        count++;
+    }
+
+    file_prefetch_finish(prefetch);
+    CU_ASSERT_EQUAL(file_scan_finish(scan), count);
+    return count;
+}
+
+/**
+ * @brief Test loading scanned files ahead of their consumers
+ */
+void test_file_prefetch(void)
+{
+    mkdir("test_prefetch_tree", 0755);
+    for (int i = 0; i < PREFETCH_TEST_FILES; i++)
+    {
+        char path[64];
+        char contents[512];
+        snprintf(path, sizeof(path), "test_prefetch_tree/f%d.c", i);
+        format_prefetch_contents(i, contents, sizeof(contents));
+        FILE *file = fopen(path, "w");
+        if (file)
+        {
+            fputs(contents, file);
+            fclose(file);
+        }
+    }
+
+    // Everything fits; a small budget makes readers wait for released files
+    CU_ASSERT_EQUAL(consume_prefetch(1 << 20), PREFETCH_TEST_FILES);
+    CU_ASSERT_EQUAL(consume_prefetch(64), PREFETCH_TEST_FILES);
+    CU_ASSERT_EQUAL(consume_prefetch(0), PREFETCH_TEST_FILES);
+
+    // Finishing early discards files that were loaded but not consumed
+    FileScan *scan = file_scan_start("test_prefetch_tree", 2, 4, false, NULL);
+    FilePrefetch *prefetch = file_prefetch_start(scan, 2, 1 << 20);
+    CU_ASSERT_PTR_NOT_NULL(prefetch);
+    PrefetchedFile file;
+    CU_ASSERT_TRUE(file_prefetch_next(prefetch, &file));
+    file_prefetch_release(prefetch, &file);
+    file_prefetch_finish(prefetch);
+    file_scan_finish(scan);
+
+    // Once the readers have buffered the tree, the largest file comes first
+    scan = file_scan_start("test_prefetch_tree", 2, 4, false, NULL);
+    prefetch = file_prefetch_start(scan, 2, 1 << 20);
+    CU_ASSERT_PTR_NOT_NULL(prefetch);
+    struct timespec delay = {0, 200 * 1000 * 1000};
+    nanosleep(&delay, NULL);
+    CU_ASSERT_TRUE(file_prefetch_next(prefetch, &file));
+    CU_ASSERT_PTR_NOT_NULL(strstr(file.path, "/f19.c"));
+    file_prefetch_release(prefetch, &file);
+    file_prefetch_finish(prefetch);
+    file_scan_finish(scan);
+
+    for (int i = 0; i < PREFETCH_TEST_FILES; i++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "test_prefetch_tree/f%d.c", i);
+        remove(path);
+    }
+    rmdir("test_prefetch_tree");
+}
+
+/**
+ * @brief Write a source file for a parser test
+ */
+static void write_test_file(const char *path, const char *contents)
+{
+    FILE *file = fopen(path, "w");
+    if (file)
+    {
+        fputs(contents, file);
+        fclose(file);
+    }
+}
+
+/**
+ * @brief Test function metrics and call edges extracted from a fixture
  */
 void test_ast_parser(void)
 {
+    const char *source_path = "test_ast_fixture.c";
+    write_test_file(source_path,
+                    "static int helper(int x)\n"               // 1
+                    "{\n"
+                    "    return x * 2;\n"
+                    "}\n"                                     // 4
+                    "\n"
+                    "int classify(int a, int b)\n"            // 6
+                    "{\n"
+                    "    int total = 0;\n"
+                    "    if (a > 0 && b > 0)\n"               // if, &&: depth 1
+                    "    {\n"
+                    "        total = helper(a);\n"            // 11
+                    "    }\n"
+                    "    else if (a < 0 || b < 0)\n"          // if, ||: depth 2, nested in the first if
+                    "    {\n"
+                    "        for (int i = 0; i < a; i++)\n"   // for: depth 3
+                    "        {\n"
+                    "            while (b > i)\n"             // while: depth 4
+                    "            {\n"
+                    "                b--;\n"
+                    "            }\n"
+                    "        }\n"
+                    "    }\n"
+                    "    switch (b)\n"                        // switch
+                    "    {\n"
+                    "        case 0:\n"                       // case
+                    "            total += helper(b);\n"       // 26
+                    "            break;\n"
+                    "        case 1:\n"                       // case
+                    "            break;\n"
+                    "        default:\n"                      // default
+                    "            break;\n"
+                    "    }\n"
+                    "    return total;\n"
+                    "}\n");                                   // 34
+
+    CU_ASSERT_EQUAL(ast_parser_init(), CQ_SUCCESS);
+    ASTData *ast = parse_source_file(source_path);
+    CU_ASSERT_PTR_NOT_NULL(ast);
+    if (!ast)
+    {
+        ast_parser_shutdown();
+        remove(source_path);
+        return;
+    }
+
+    Project *project = ast->project;
+    CU_ASSERT_EQUAL(project->functions.count, 2);
+    if (project->functions.count == 2)
+    {
+        const FunctionInfo *helper = &project->functions.functions[0];
+        CU_ASSERT_STRING_EQUAL(string_pool_get(&project->string_pool, helper->name_id), "helper");
+        CU_ASSERT_EQUAL(helper->location.line, 1);
+        CU_ASSERT_EQUAL(helper->complexity, 1);
+        CU_ASSERT_EQUAL(helper->nesting_depth, 0);
+        CU_ASSERT_EQUAL(helper->lines_of_code, 4);
+        CU_ASSERT_EQUAL(helper->parameter_count, 1);
+
+        // 1 + if, &&, else if, ||, for, while, switch, two cases and default
+        const FunctionInfo *classify = &project->functions.functions[1];
+        CU_ASSERT_STRING_EQUAL(string_pool_get(&project->string_pool, classify->name_id), "classify");
+        CU_ASSERT_EQUAL(classify->location.line, 6);
+        CU_ASSERT_EQUAL(classify->complexity, 11);
+        CU_ASSERT_EQUAL(classify->nesting_depth, 4);
+        CU_ASSERT_EQUAL(classify->lines_of_code, 29);
+        CU_ASSERT_EQUAL(classify->parameter_count, 2);
+    }
+
+    // Both calls are made by classify, in source order
+    CU_ASSERT_EQUAL(project->calls.count, 2);
+    if (project->calls.count == 2)
+    {
+        const unsigned expected_lines[2] = {11, 26};
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            const CallEdge *call = &project->calls.calls[i];
+            CU_ASSERT_EQUAL(call->caller_index, 1);
+            CU_ASSERT_STRING_EQUAL(string_pool_get(&project->string_pool, call->callee_name_id), "helper");
+            CU_ASSERT_EQUAL(call->line, expected_lines[i]);
+        }
+    }
+
+    free_ast_data(ast);
+    ast_parser_shutdown();
+    remove(source_path);
+}
+
+/**
+ * @brief Test that usages are counted on the definition of the exact symbol referenced
+ */
+void test_ast_parser_usages(void)
+{
+    const char *source_path = "test_ast_usages.c";
+    write_test_file(source_path,
+                    "int fib(int n);\n"
+                    "int count;\n"
+                    "\n"
+                    "int first(void)\n"
+                    "{\n"
+                    "    int count = fib(3);\n"
+                    "    return count + count;\n"
+                    "}\n"
+                    "\n"
+                    "int second(void)\n"
+                    "{\n"
+                    "    int count = 1;\n"
+                    "    return count + fib(count);\n"
+                    "}\n"
+                    "\n"
+                    "int fib(int n)\n"
+                    "{\n"
+                    "    count++;\n"
+                    "    return n < 2 ? n : fib(n - 1) + fib(n - 2);\n"
+                    "}\n");
+
     CU_ASSERT_EQUAL(ast_parser_init(), CQ_SUCCESS);
-    // TODO: Implement AST parser tests
+    ASTData *ast = parse_source_file(source_path);
+    CU_ASSERT_PTR_NOT_NULL(ast);
+    if (!ast)
+    {
+        ast_parser_shutdown();
+        remove(source_path);
+        return;
+    }
+
+    // Prototype, first, second and the definition of fib
+    Project *project = ast->project;
+    CU_ASSERT_EQUAL(project->functions.count, 4);
+    if (project->functions.count == 4)
+    {
+        const FunctionInfo *prototype = &project->functions.functions[0];
+        const FunctionInfo *definition = &project->functions.functions[3];
+        CU_ASSERT_STRING_EQUAL(string_pool_get(&project->string_pool, definition->name_id), "fib");
+
+        // Calls from first and second, made before the definition, and the two recursive calls
+        CU_ASSERT_EQUAL(prototype->usage_count, 0);
+        CU_ASSERT_EQUAL(definition->usage_count, 4);
+        CU_ASSERT_EQUAL(project->functions.functions[1].usage_count, 0);
+        CU_ASSERT_EQUAL(project->functions.functions[2].usage_count, 0);
+    }
+
+    // The locals named count shadow the global, which is only used in fib
+    CU_ASSERT_EQUAL(project->variables.count, 1);
+    if (project->variables.count == 1)
+    {
+        const VariableInfo *global = &project->variables.variables[0];
+        CU_ASSERT_STRING_EQUAL(string_pool_get(&project->string_pool, global->name_id), "count");
+        CU_ASSERT_EQUAL(global->usage_count, 1);
+    }
+
+    free_ast_data(ast);
     ast_parser_shutdown();
-    CU_PASS("AST parser test placeholder");
+    remove(source_path);
 }
 
 /**
@@ -148,20 +615,30 @@ void test_preprocessor_extract_macros(void)
         CU_ASSERT(ctx->macro_count >= 3); // Should find at least MAX_SIZE, DEBUG, VERSION
 
         // Check if MAX_SIZE was extracted
-        MacroDefinition *macro = ctx->macros;
         bool found_max_size = false;
-        while (macro)
+        for (uint32_t i = 0; i < ctx->macro_count; i++)
         {
-            if (strcmp(macro->name, "MAX_SIZE") == 0)
+            if (strcmp(ctx->macros[i]->name, "MAX_SIZE") == 0)
             {
                 found_max_size = true;
-                CU_ASSERT_STRING_EQUAL(macro->value, "100");
+                CU_ASSERT_STRING_EQUAL(ctx->macros[i]->value, "100");
+                CU_ASSERT_STRING_EQUAL(ctx->macros[i]->arg, "-DMAX_SIZE=100");
                 break;
             }
-            macro = macro->next;
         }
         CU_ASSERT_TRUE(found_max_size);
 
+        // Contents already in memory give the same macros as the file
+        PreprocessingContext *buffer_ctx = preprocessor_init();
+        CU_ASSERT_PTR_NOT_NULL(buffer_ctx);
+        if (buffer_ctx)
+        {
+            CU_ASSERT_EQUAL(preprocessor_extract_macros_from_buffer(buffer_ctx, test_content, strlen(test_content)),
+                            CQ_SUCCESS);
+            CU_ASSERT_EQUAL(buffer_ctx->macro_count, ctx->macro_count);
+            preprocessor_free(buffer_ctx);
+        }
+
         preprocessor_free(ctx);
 
         // Clean up test file
@@ -169,6 +646,52 @@ void test_preprocessor_extract_macros(void)
     }
 }
 
+/**
+ * @brief Test sharing interned macros between files
+ */
+void test_preprocessor_macro_table(void)
+{
+    MacroTable *table = preprocessor_macro_table_create();
+    CU_ASSERT_PTR_NOT_NULL(table);
+    if (!table)
+    {
+        return;
+    }
+
+    const char *first_source = "#define SHARED 1\n#define ONLY_FIRST\n";
+    const char *second_source = "#define SHARED 1\n#define SHARED 2\n";
+    PreprocessingContext *first = preprocessor_init();
+    PreprocessingContext *second = preprocessor_init();
+    CU_ASSERT_PTR_NOT_NULL(first);
+    CU_ASSERT_PTR_NOT_NULL(second);
+    if (first && second)
+    {
+        CU_ASSERT_EQUAL(preprocessor_use_macro_table(first, table), CQ_SUCCESS);
+        CU_ASSERT_EQUAL(preprocessor_use_macro_table(second, table), CQ_SUCCESS);
+        preprocessor_extract_macros_from_buffer(first, first_source, strlen(first_source));
+        preprocessor_extract_macros_from_buffer(second, second_source, strlen(second_source));
+
+        // Identical definitions are stored once; a different value is a new definition
+        CU_ASSERT_EQUAL(preprocessor_macro_table_count(table), 3);
+        CU_ASSERT_EQUAL(first->macro_count, 2);
+        CU_ASSERT_EQUAL(second->macro_count, 2);
+        if (first->macro_count == 2 && second->macro_count == 2)
+        {
+            CU_ASSERT_PTR_EQUAL(first->macros[0], second->macros[0]);
+            CU_ASSERT_STRING_EQUAL(second->macros[1]->arg, "-DSHARED=2");
+        }
+
+        // Macros must be interned in one table
+        CU_ASSERT_EQUAL(preprocessor_use_macro_table(first, table), CQ_ERROR_INVALID_ARGUMENT);
+    }
+
+    // Definitions outlive the contexts that found them
+    preprocessor_free(first);
+    preprocessor_free(second);
+    CU_ASSERT_EQUAL(preprocessor_macro_table_count(table), 3);
+    preprocessor_macro_table_destroy(table);
+}
+
 /**
  * @brief Test argument building
  */
@@ -184,28 +707,112 @@ void test_preprocessor_build_args(void)
     ctx->include_paths = path;
     ctx->include_count = 1;
 
-    // Add a test macro
-    MacroDefinition *macro = calloc(1, sizeof(MacroDefinition));
-    CU_ASSERT_PTR_NOT_NULL(macro);
-    strcpy(macro->name, "TEST_MACRO");
-    strcpy(macro->value, "42");
-    ctx->macros = macro;
-    ctx->macro_count = 1;
+    // Add test macros
+    const char *source = "#define TEST_MACRO 42\n#define FLAG\n";
+    CU_ASSERT_EQUAL(preprocessor_extract_macros_from_buffer(ctx, source, strlen(source)), CQ_SUCCESS);
 
+    // The arguments are borrowed from the context
     const char *args[10];
     int count = preprocessor_build_args(ctx, args, 10);
 
-    CU_ASSERT(count >= 3); // -I/test/include, -DTEST_MACRO=42, -std=c11
+    CU_ASSERT_EQUAL(count, 4);
+    if (count == 4)
+    {
+        CU_ASSERT_STRING_EQUAL(args[0], "-I/test/include");
+        CU_ASSERT_STRING_EQUAL(args[1], "-DTEST_MACRO=42");
+        CU_ASSERT_STRING_EQUAL(args[2], "-DFLAG");
+        CU_ASSERT_STRING_EQUAL(args[3], "-std=c11");
+    }
 
-    // Free allocated args
-    for (int i = 0; i < count; i++)
+    // Include paths give way to macros when there is no room for both
+    count = preprocessor_build_args(ctx, args, 3);
+    CU_ASSERT_EQUAL(count, 3);
+    if (count == 3)
     {
-        free((void *)args[i]);
+        CU_ASSERT_STRING_EQUAL(args[0], "-DTEST_MACRO=42");
+        CU_ASSERT_STRING_EQUAL(args[1], "-DFLAG");
+        CU_ASSERT_STRING_EQUAL(args[2], "-std=c11");
     }
 
     preprocessor_free(ctx);
 }
 
+/**
+ * @brief Test that include path sets are shared until the directory tree changes
+ */
+void test_preprocessor_include_path_cache(void)
+{
+    const char *root = "test_include_cache";
+    mkdir(root, 0755);
+    mkdir("test_include_cache/include", 0755);
+
+    const IncludePathSet *first = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_NOT_NULL(first);
+    if (!first)
+    {
+        rmdir("test_include_cache/include");
+        rmdir(root);
+        return;
+    }
+    // System paths plus the include directory
+    CU_ASSERT_EQUAL(preprocessor_include_paths_count(first), 3);
+
+    // An unchanged tree is not scanned again
+    const IncludePathSet *second = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_EQUAL(second, first);
+    preprocessor_include_paths_release(second);
+
+    // A directory below the root gets its own set from the same walk
+    const IncludePathSet *nested = preprocessor_include_paths_acquire("test_include_cache/include");
+    CU_ASSERT_PTR_NOT_NULL(nested);
+    CU_ASSERT_TRUE(nested != first);
+    CU_ASSERT_EQUAL(preprocessor_include_paths_count(nested), 2);
+    preprocessor_include_paths_release(nested);
+
+    // Shared paths are emitted as include arguments
+    PreprocessingContext *ctx = preprocessor_init();
+    CU_ASSERT_PTR_NOT_NULL(ctx);
+    if (ctx)
+    {
+        CU_ASSERT_EQUAL(preprocessor_use_include_paths(ctx, first), CQ_SUCCESS);
+        const char *args[10];
+        int count = preprocessor_build_args(ctx, args, 10);
+        CU_ASSERT_EQUAL(count, 4); // three -I paths and -std=c11
+        preprocessor_free(ctx);
+    }
+
+    // A new directory invalidates the set
+    mkdir("test_include_cache/inc", 0755);
+    const IncludePathSet *third = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_NOT_NULL(third);
+    CU_ASSERT_EQUAL(preprocessor_include_paths_count(third), 4);
+    CU_ASSERT_EQUAL(preprocessor_include_paths_count(first), 3);
+
+    // Within a run a set found unchanged is not checked again
+    preprocessor_include_paths_begin_run();
+    const IncludePathSet *in_run = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_EQUAL(in_run, third);
+    preprocessor_include_paths_release(in_run);
+    mkdir("test_include_cache/include_extra", 0755);
+    in_run = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_EQUAL(in_run, third);
+    preprocessor_include_paths_release(in_run);
+    preprocessor_include_paths_end_run();
+
+    const IncludePathSet *after_run = preprocessor_include_paths_acquire(root);
+    CU_ASSERT_PTR_NOT_NULL(after_run);
+    CU_ASSERT_EQUAL(preprocessor_include_paths_count(after_run), 5);
+    preprocessor_include_paths_release(after_run);
+
+    preprocessor_include_paths_release(third);
+    preprocessor_include_paths_release(first);
+    preprocessor_include_paths_clear_cache();
+    rmdir("test_include_cache/include_extra");
+    rmdir("test_include_cache/inc");
+    rmdir("test_include_cache/include");
+    rmdir(root);
+}
+
 /**
  * @brief Test project parsing with progress
  */
@@ -227,6 +834,283 @@ void test_parse_project(void)
     shutdown_language_parsers();
 }
 
+/**
+ * @brief Test project parsing with a multi-threaded worker pool
+ */
+void test_parse_project_parallel(void)
+{
+    CU_ASSERT_EQUAL(config_init(), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(config_set("thread_count", "4"), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(initialize_language_parsers(), CQ_SUCCESS);
+
+    ASTData *parallel_ast = parse_project(".", 50, NULL);
+    CU_ASSERT_PTR_NOT_NULL(parallel_ast);
+
+    CU_ASSERT_EQUAL(config_set("thread_count", "1"), CQ_SUCCESS);
+    ASTData *serial_ast = parse_project(".", 50, NULL);
+    CU_ASSERT_PTR_NOT_NULL(serial_ast);
+
+    // Merge order must not depend on thread scheduling
+    if (parallel_ast && serial_ast)
+    {
+        Project *a = parallel_ast->project;
+        Project *b = serial_ast->project;
+        CU_ASSERT_EQUAL(a->files.count, b->files.count);
+        for (uint32_t i = 0; i < a->files.count && i < b->files.count; i++)
+        {
+            CU_ASSERT_STRING_EQUAL(string_pool_get(&a->string_pool, a->files.files[i].filepath_id),
+                                   string_pool_get(&b->string_pool, b->files.files[i].filepath_id));
+        }
+    }
+
+    free_ast_data(parallel_ast);
+    free_ast_data(serial_ast);
+
+    shutdown_language_parsers();
+    config_shutdown();
+}
+
+/**
+ * @brief Name of the first function of a parsed project, or "" if there is none
+ */
+static const char *first_function_name(const ASTData *project_ast)
+{
+    if (!project_ast || !project_ast->project || project_ast->project->functions.count == 0)
+    {
+        return "";
+    }
+    const Project *project = project_ast->project;
+    return string_pool_get(&project->string_pool, project->functions.functions[0].name_id);
+}
+
+/**
+ * @brief Test that the analysis cache notices a rewrite of the same size within one second
+ */
+void test_parse_project_cache(void)
+{
+    const char *source_path = "test_cache_tree/a.c";
+    const char *cache_path = "test_cache_tree.bin";
+
+    CU_ASSERT_EQUAL(config_init(), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(config_set("enable_parse_cache", "true"), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(config_set("parse_cache_path", cache_path), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(initialize_language_parsers(), CQ_SUCCESS);
+
+    mkdir("test_cache_tree", 0755);
+    write_test_file(source_path, "int alpha(void) { return 0; }\n");
+    struct stat before;
+    CU_ASSERT_EQUAL(stat(source_path, &before), 0);
+
+    ASTData *first = parse_project("test_cache_tree", 10, NULL);
+    CU_ASSERT_PTR_NOT_NULL(first);
+    CU_ASSERT_STRING_EQUAL(first_function_name(first), "alpha");
+    free_ast_data(first);
+
+    // Same size, and the same modification second; only the nanoseconds differ
+    write_test_file(source_path, "int gamma(void) { return 0; }\n");
+    struct timespec times[2] = {before.st_atim, before.st_mtim};
+    times[1].tv_nsec = (times[1].tv_nsec + 1) % 1000000000;
+    CU_ASSERT_EQUAL(utimensat(AT_FDCWD, source_path, times, 0), 0);
+
+    ASTData *second = parse_project("test_cache_tree", 10, NULL);
+    CU_ASSERT_PTR_NOT_NULL(second);
+    CU_ASSERT_STRING_EQUAL(first_function_name(second), "gamma");
+    free_ast_data(second);
+
+    // Unchanged: restored from the cache with the same records
+    ASTData *third = parse_project("test_cache_tree", 10, NULL);
+    CU_ASSERT_PTR_NOT_NULL(third);
+    CU_ASSERT_STRING_EQUAL(first_function_name(third), "gamma");
+    free_ast_data(third);
+
+    // Declarations from an included header are cached with the header's version
+    mkdir("test_cache_include", 0755);
+    write_test_file("test_cache_include/dep.h", "int shared_value;\n");
+    struct timespec past[2] = {{before.st_atim.tv_sec - 10, 0}, {before.st_mtim.tv_sec - 10, 0}};
+    CU_ASSERT_EQUAL(utimensat(AT_FDCWD, "test_cache_include/dep.h", past, 0), 0);
+    write_test_file(source_path, "#include \"../test_cache_include/dep.h\"\nint gamma(void) { return 0; }\n");
+    ASTData *fourth = parse_project("test_cache_tree", 10, NULL);
+    CU_ASSERT_PTR_NOT_NULL(fourth);
+    if (fourth)
+    {
+        CU_ASSERT_EQUAL(fourth->project->variables.count, 1);
+        free_ast_data(fourth);
+    }
+
+    // Changing only the header invalidates the file that includes it
+    write_test_file("test_cache_include/dep.h", "int shared_value;\nint other_value;\n");
+    ASTData *fifth = parse_project("test_cache_tree", 10, NULL);
+    CU_ASSERT_PTR_NOT_NULL(fifth);
+    if (fifth)
+    {
+        CU_ASSERT_EQUAL(fifth->project->variables.count, 2);
+        free_ast_data(fifth);
+    }
+
+    CU_ASSERT_EQUAL(config_set("enable_parse_cache", "false"), CQ_SUCCESS);
+    remove("test_cache_include/dep.h");
+    rmdir("test_cache_include");
+    remove(source_path);
+    rmdir("test_cache_tree");
+    remove(cache_path);
+
+    shutdown_language_parsers();
+    config_shutdown();
+}
+
+/**
+ * @brief Test that shared preambles are precompiled once reused
+ */
+void test_pch_cache(void)
+{
+    const char *with_preamble = "test_pch_preamble.c";
+    const char *without_preamble = "test_pch_plain.c";
+    const char *args[] = {"-std=c11"};
+    const char *preamble_source =
+        "/* header comment */\n#include <stddef.h>\n#include <limits.h>\n\nint f(void) { return 0; }\n";
+
+    FILE *file = fopen(with_preamble, "w");
+    if (file)
+    {
+        fputs(preamble_source, file);
+        fclose(file);
+    }
+    file = fopen(without_preamble, "w");
+    if (file)
+    {
+        fputs("int g(void) { return 1; }\n", file);
+        fclose(file);
+    }
+
+    void *index = ast_parser_create_index();
+    PchCache *cache = pch_cache_create(2);
+    CU_ASSERT_PTR_NOT_NULL(cache);
+    if (cache && index)
+    {
+        // No system includes at the top: nothing to precompile
+        CU_ASSERT_PTR_NULL(pch_cache_acquire(cache, index, without_preamble, NULL, 0, args, 1));
+        CU_ASSERT_PTR_NULL(pch_cache_acquire(cache, index, without_preamble, NULL, 0, args, 1));
+
+        // The PCH is built on the second use and shared afterwards
+        CU_ASSERT_PTR_NULL(pch_cache_acquire(cache, index, with_preamble, NULL, 0, args, 1));
+        const char *pch_path = pch_cache_acquire(cache, index, with_preamble, NULL, 0, args, 1);
+        CU_ASSERT_PTR_NOT_NULL(pch_path);
+        if (pch_path)
+        {
+            CU_ASSERT_EQUAL(access(pch_path, R_OK), 0);
+            CU_ASSERT_PTR_EQUAL(pch_cache_acquire(cache, index, with_preamble, NULL, 0, args, 1), pch_path);
+
+            // Loaded contents are scanned instead of the file on disk
+            CU_ASSERT_PTR_EQUAL(pch_cache_acquire(cache, index, without_preamble, preamble_source,
+                                                  strlen(preamble_source), args, 1),
+                                pch_path);
+        }
+
+        // Different arguments need a different PCH
+        const char *other_args[] = {"-std=c11", "-DOTHER"};
+        CU_ASSERT_PTR_NULL(pch_cache_acquire(cache, index, with_preamble, NULL, 0, other_args, 2));
+    }
+
+    pch_cache_destroy(cache);
+    ast_parser_dispose_index(index);
+    remove(with_preamble);
+    remove(without_preamble);
+}
+
+/**
+ * @brief Test reading per-file arguments from compile_commands.json
+ */
+void test_compile_database(void)
+{
+    char cwd[MAX_PATH_LENGTH];
+    char directory[MAX_PATH_LENGTH + 32];
+    CU_ASSERT_PTR_NOT_NULL(getcwd(cwd, sizeof(cwd)));
+    snprintf(directory, sizeof(directory), "%s/test_compile_db", cwd);
+    mkdir("test_compile_db", 0755);
+    mkdir("test_compile_db/src", 0755);
+
+    FILE *file = fopen("test_compile_db/src/a.c", "w");
+    if (file)
+    {
+        fputs("int a(void) { return FOO; }\n", file);
+        fclose(file);
+    }
+    file = fopen("test_compile_db/compile_commands.json", "w");
+    if (file)
+    {
+        // The second command for the same file is ignored
+        fprintf(file,
+                "[\n"
+                "  {\"directory\": \"%s\", \"command\": \"cc -Iinc -DFOO=1 -MD -MF a.d -c ./src/a.c -o a.o\","
+                " \"file\": \"src/a.c\"},\n"
+                "  {\"directory\": \"%s\", \"command\": \"cc -DOTHER -c src/a.c\", \"file\": \"src/a.c\"}\n"
+                "]\n",
+                directory, directory);
+        fclose(file);
+    }
+
+    CompileDatabase *database = compile_database_load("test_compile_db");
+    CU_ASSERT_PTR_NOT_NULL(database);
+    if (database)
+    {
+        CU_ASSERT_EQUAL(compile_database_file_count(database), 1);
+
+        // Build-only options, the compiler and the input file, however spelled, are dropped
+        const CompileCommandArgs *command = compile_database_lookup(database, "test_compile_db/src/a.c");
+        CU_ASSERT_PTR_NOT_NULL(command);
+        if (command)
+        {
+            CU_ASSERT_EQUAL(command->arg_count, 4);
+            if (command->arg_count == 4)
+            {
+                CU_ASSERT_STRING_EQUAL(command->args[0], "-working-directory");
+                CU_ASSERT_STRING_EQUAL(command->args[1], directory);
+                CU_ASSERT_STRING_EQUAL(command->args[2], "-Iinc");
+                CU_ASSERT_STRING_EQUAL(command->args[3], "-DFOO=1");
+            }
+        }
+
+        CU_ASSERT_PTR_NULL(compile_database_lookup(database, "test_compile_db/src/b.c"));
+    }
+
+    // The fingerprint follows the commands, so cached results of other flags are not reused
+    CompileDatabase *reloaded = compile_database_load("test_compile_db");
+    CU_ASSERT_PTR_NOT_NULL(reloaded);
+    CU_ASSERT_EQUAL(compile_database_fingerprint(reloaded), compile_database_fingerprint(database));
+    compile_database_destroy(reloaded);
+
+    file = fopen("test_compile_db/compile_commands.json", "w");
+    if (file)
+    {
+        fprintf(file,
+                "[{\"directory\": \"%s\", \"command\": \"cc -Iinc -DFOO=2 -c ../test_compile_db/src/a.c\","
+                " \"file\": \"src/a.c\"}]\n",
+                directory);
+        fclose(file);
+    }
+    reloaded = compile_database_load("test_compile_db");
+    CU_ASSERT_PTR_NOT_NULL(reloaded);
+    CU_ASSERT_NOT_EQUAL(compile_database_fingerprint(reloaded), compile_database_fingerprint(database));
+    const CompileCommandArgs *changed = compile_database_lookup(reloaded, "test_compile_db/src/a.c");
+    CU_ASSERT_PTR_NOT_NULL(changed);
+    if (changed)
+    {
+        CU_ASSERT_EQUAL(changed->arg_count, 4);
+    }
+    compile_database_destroy(reloaded);
+    compile_database_destroy(database);
+    CU_ASSERT_EQUAL(compile_database_fingerprint(NULL), 0);
+
+    // A directory without a database has no arguments
+    CU_ASSERT_PTR_NULL(compile_database_load("test_compile_db/src"));
+    CU_ASSERT_PTR_NULL(compile_database_lookup(NULL, "test_compile_db/src/a.c"));
+
+    remove("test_compile_db/compile_commands.json");
+    remove("test_compile_db/src/a.c");
+    rmdir("test_compile_db/src");
+    rmdir("test_compile_db");
+}
+
 /**
  * @brief Test project parsing with invalid parameters
  */
@@ -373,13 +1257,23 @@ void add_parser_tests(CU_pSuite suite)
     CU_add_test(suite, "File Scanner Invalid Params Test", test_file_scanner_invalid_params);
     CU_add_test(suite, "Scan Inaccessible Directory Test", test_scan_inaccessible_directory);
     CU_add_test(suite, "File Accessibility Test", test_file_accessibility);
+    CU_add_test(suite, "Parallel File Scan Test", test_file_scan_parallel);
+    CU_add_test(suite, "Scan Exclusion Test", test_scan_exclusion);
+    CU_add_test(suite, "File Prefetch Test", test_file_prefetch);
     CU_add_test(suite, "AST Parser Test", test_ast_parser);
+    CU_add_test(suite, "AST Parser Usage Test", test_ast_parser_usages);
     CU_add_test(suite, "Language Support Test", test_language_support);
     CU_add_test(suite, "Preprocessor Init Test", test_preprocessor_init);
     CU_add_test(suite, "Preprocessor Scan Includes Test", test_preprocessor_scan_includes);
     CU_add_test(suite, "Preprocessor Extract Macros Test", test_preprocessor_extract_macros);
+    CU_add_test(suite, "Preprocessor Macro Table Test", test_preprocessor_macro_table);
     CU_add_test(suite, "Preprocessor Build Args Test", test_preprocessor_build_args);
+    CU_add_test(suite, "Preprocessor Include Path Cache Test", test_preprocessor_include_path_cache);
     CU_add_test(suite, "Parse Project Test", test_parse_project);
+    CU_add_test(suite, "Parse Project Parallel Test", test_parse_project_parallel);
+    CU_add_test(suite, "Parse Project Cache Test", test_parse_project_cache);
+    CU_add_test(suite, "PCH Cache Test", test_pch_cache);
+    CU_add_test(suite, "Compile Database Test", test_compile_database);
     CU_add_test(suite, "Parse Project Invalid Params Test", test_parse_project_invalid_params);
     CU_add_test(suite, "Parse Inaccessible Files Test", test_parse_inaccessible_files);
     CU_add_test(suite, "Large File Handling Test", test_large_file_handling);
@@ -1,10 +1,15 @@
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #include "utils/logger.h"
 #include "utils/config.h"
 #include "utils/memory.h"
+#include "utils/hash.h"
+#include "utils/mapped_file.h"
 #include "utils/string_utils.h"
 #include "utils/bmp_writer.h"
 #include "utils/localization.h"
@@ -54,6 +59,59 @@ void test_config(void)
     config_shutdown();
 }
 
+/**
+ * @brief Test resolution of the parser analysis profile
+ */
+void test_analysis_profile(void)
+{
+    CU_ASSERT_EQUAL(config_init(), CQ_SUCCESS);
+
+    // Default metrics include complexity, which needs function bodies
+    CU_ASSERT_EQUAL(config_resolve_analysis_profile(config_get()), ANALYSIS_PROFILE_FULL);
+
+    // Each metric on its own: only complexity and maintainability need bodies
+    static const struct
+    {
+        const char *key;
+        AnalysisProfile profile;
+    } metrics[] = {
+        {"metric_cyclomatic_complexity_enabled", ANALYSIS_PROFILE_FULL},
+        {"metric_lines_of_code_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_halstead_volume_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_halstead_difficulty_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_halstead_effort_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_halstead_time_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_halstead_bugs_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_maintainability_index_enabled", ANALYSIS_PROFILE_FULL},
+        {"metric_comment_density_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_class_cohesion_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+        {"metric_class_coupling_enabled", ANALYSIS_PROFILE_DECLARATIONS},
+    };
+    size_t metric_count = sizeof(metrics) / sizeof(metrics[0]);
+
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        CU_ASSERT_EQUAL(config_set(metrics[i].key, "false"), CQ_SUCCESS);
+    }
+    CU_ASSERT_EQUAL(config_resolve_analysis_profile(config_get()), ANALYSIS_PROFILE_DECLARATIONS);
+
+    for (size_t i = 0; i < metric_count; i++)
+    {
+        CU_ASSERT_EQUAL(config_set(metrics[i].key, "true"), CQ_SUCCESS);
+        CU_ASSERT_EQUAL(config_resolve_analysis_profile(config_get()), metrics[i].profile);
+        CU_ASSERT_EQUAL(config_set(metrics[i].key, "false"), CQ_SUCCESS);
+    }
+
+    // An explicit profile wins over the metric selection
+    CU_ASSERT_EQUAL(config_set("analysis_profile", "full"), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(config_resolve_analysis_profile(config_get()), ANALYSIS_PROFILE_FULL);
+    CU_ASSERT_EQUAL(config_set("analysis_profile", "bodies"), CQ_ERROR_INVALID_ARGUMENT);
+
+    CU_ASSERT_EQUAL(config_resolve_analysis_profile(NULL), ANALYSIS_PROFILE_FULL);
+
+    config_shutdown();
+}
+
 /**
  * @brief Test memory utilities
  */
@@ -67,6 +125,75 @@ void test_memory(void)
     CU_ASSERT_PTR_NOT_NULL(str);
     CU_ASSERT_STRING_EQUAL(str, "test");
     cq_free(str);
+
+    // Arena allocations are aligned and survive new blocks
+    MemoryArena arena;
+    memory_arena_init(&arena, 64);
+    char *first = memory_arena_strndup(&arena, "first string", 5);
+    CU_ASSERT_PTR_NOT_NULL(first);
+    if (first)
+    {
+        CU_ASSERT_STRING_EQUAL(first, "first");
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        void *block = memory_arena_alloc(&arena, (size_t)(i % 7) + 1);
+        CU_ASSERT_PTR_NOT_NULL(block);
+        CU_ASSERT_EQUAL((uintptr_t)block % _Alignof(max_align_t), 0);
+    }
+    char *large = memory_arena_alloc(&arena, 1000);
+    CU_ASSERT_PTR_NOT_NULL(large);
+    if (large)
+    {
+        memset(large, 'x', 1000);
+    }
+    char *after = memory_arena_strndup(&arena, "after", 5);
+    CU_ASSERT_PTR_NOT_NULL(after);
+    if (first && after)
+    {
+        CU_ASSERT_STRING_EQUAL(first, "first");
+        CU_ASSERT_STRING_EQUAL(after, "after");
+    }
+    CU_ASSERT_PTR_NULL(memory_arena_alloc(&arena, 0));
+    memory_arena_destroy(&arena);
+    CU_ASSERT_PTR_NULL(arena.blocks);
+}
+
+/**
+ * @brief Test whole-file mapping, including empty and missing files
+ */
+void test_mapped_file(void)
+{
+    const char *path = "test_mapped_file.txt";
+    FILE *file = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL(file);
+    if (!file)
+    {
+        return;
+    }
+    fputs("line one\nline two", file);
+    fclose(file);
+
+    MappedFile mapped;
+    CU_ASSERT_EQUAL(mapped_file_open(path, &mapped), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(mapped.size, 17);
+    CU_ASSERT(mapped.data && memcmp(mapped.data, "line one\nline two", 17) == 0);
+    mapped_file_close(&mapped);
+    CU_ASSERT_PTR_NULL(mapped.data);
+
+    file = fopen(path, "w");
+    if (file)
+    {
+        fclose(file);
+    }
+    CU_ASSERT_EQUAL(mapped_file_open(path, &mapped), CQ_SUCCESS);
+    CU_ASSERT_EQUAL(mapped.size, 0);
+    CU_ASSERT_PTR_NOT_NULL(mapped.data);
+    mapped_file_close(&mapped);
+    remove(path);
+
+    CU_ASSERT_EQUAL(mapped_file_open("non_existent_file.txt", &mapped), CQ_ERROR_FILE_NOT_FOUND);
+    CU_ASSERT_EQUAL(mapped_file_open(NULL, &mapped), CQ_ERROR_INVALID_ARGUMENT);
 }
 
 /**
@@ -86,6 +213,127 @@ void test_string_utils(void)
     CU_ASSERT(!cq_ends_with("hello world", "hello"));
 }
 
+/**
+ * @brief Test that hashes depend on every byte and agree between entry points
+ */
+void test_hash(void)
+{
+    CU_ASSERT_EQUAL(cq_hash_string(""), cq_hash_bytes(NULL, 0));
+    CU_ASSERT_EQUAL(cq_hash_string("project_add_function"), cq_hash_bytes("project_add_function", 20));
+    CU_ASSERT_EQUAL(cq_hash_string("src/data/ast_types.c"), cq_hash_string("src/data/ast_types.c"));
+
+    // Flipping any single byte of keys of every length class changes the hash
+    char key[100];
+    bool all_differ = true;
+    for (size_t length = 1; length < sizeof(key); length++)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            key[i] = (char)('a' + i % 26);
+        }
+        uint64_t base = cq_hash_bytes(key, length);
+        CU_ASSERT_NOT_EQUAL(base, cq_hash_bytes(key, length - 1));
+        for (size_t i = 0; i < length; i++)
+        {
+            key[i] ^= 1;
+            all_differ = all_differ && cq_hash_bytes(key, length) != base;
+            key[i] ^= 1;
+        }
+    }
+    CU_ASSERT_TRUE(all_differ);
+
+    // Compound keys depend on the order and the boundaries of their parts
+    uint64_t ab = cq_hash_combine(cq_hash_string("AB"), cq_hash_string("C"));
+    CU_ASSERT_NOT_EQUAL(ab, cq_hash_combine(cq_hash_string("A"), cq_hash_string("BC")));
+    CU_ASSERT_NOT_EQUAL(ab, cq_hash_combine(cq_hash_string("C"), cq_hash_string("AB")));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Hashes are stored in cache files, so the function must not drift
+    CU_ASSERT_EQUAL(cq_hash_string("src/parser/ast_parser.c"), 0x73e2aa231cf7770bULL);
+#endif
+}
+
+/**
+ * @brief Average probes per insert into a half-full linear-probing table
+ */
+static double hash_probes(const char **keys, int count)
+{
+    uint32_t size = 1;
+    while (size < (uint32_t)count * 2)
+    {
+        size *= 2;
+    }
+    bool *used = calloc(size, sizeof(bool));
+    if (!used)
+    {
+        return 0.0;
+    }
+
+    long probes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t bucket = (uint32_t)cq_hash_string(keys[i]) & (size - 1);
+        for (probes++; used[bucket]; probes++)
+        {
+            bucket = (bucket + 1) & (size - 1);
+        }
+        used[bucket] = true;
+    }
+    free(used);
+    return (double)probes / count;
+}
+
+/**
+ * @brief Test that similar identifier and path keys spread over a table
+ */
+void test_hash_distribution(void)
+{
+    enum { KEY_COUNT = 1 << 15 };
+    static const char *const words[] = {"project", "file", "function", "class", "parse", "get", "set",
+                                        "init", "destroy", "string", "pool", "array", "add", "count",
+                                        "index", "node", "cursor", "metric", "value", "buffer"};
+    const char **keys = calloc(KEY_COUNT, sizeof(char *));
+    CU_ASSERT_PTR_NOT_NULL(keys);
+    if (!keys)
+    {
+        return;
+    }
+
+    for (int corpus = 0; corpus < 2; corpus++)
+    {
+        MemoryArena arena;
+        memory_arena_init(&arena, 0);
+
+        // Identifiers are joined from common words; paths share long directory prefixes
+        char key[128];
+        for (int i = 0; i < KEY_COUNT; i++)
+        {
+            if (corpus == 0)
+            {
+                snprintf(key, sizeof(key), "%s_%s_%s%d", words[i % 20], words[i / 20 % 20], words[i / 400 % 20],
+                         i / 8000);
+            }
+            else
+            {
+                snprintf(key, sizeof(key), "src/module_%02d/component_%d/file_%d.c", i % 64, i / 64 % 32, i);
+            }
+            keys[i] = memory_arena_strndup(&arena, key, strlen(key));
+        }
+        CU_ASSERT_PTR_NOT_NULL(keys[KEY_COUNT - 1]);
+        if (!keys[KEY_COUNT - 1])
+        {
+            memory_arena_destroy(&arena);
+            break;
+        }
+
+        // A uniform hash needs about 1.5 probes per insert at half load
+        CU_ASSERT(hash_probes(keys, KEY_COUNT) < 2.0);
+        memory_arena_destroy(&arena);
+    }
+
+    free(keys);
+}
+
 /**
  * @brief Test configuration file operations
  */
@@ -296,9 +544,13 @@ void add_utils_tests(CU_pSuite suite)
 {
     CU_add_test(suite, "Logger Test", test_logger);
     CU_add_test(suite, "Config Test", test_config);
+    CU_add_test(suite, "Analysis Profile Test", test_analysis_profile);
     CU_add_test(suite, "Config File Operations Test", test_config_file_operations);
     CU_add_test(suite, "Memory Test", test_memory);
+    CU_add_test(suite, "Mapped File Test", test_mapped_file);
     CU_add_test(suite, "String Utils Test", test_string_utils);
+    CU_add_test(suite, "Hash Test", test_hash);
+    CU_add_test(suite, "Hash Distribution Test", test_hash_distribution);
     CU_add_test(suite, "BMP Writer Test", test_bmp_writer);
     CU_add_test(suite, "Screenshot Functionality Test", test_screenshot_functionality);
     CU_add_test(suite, "Video Recording Functionality Test", test_video_recording_functionality);